@@ -0,0 +1,81 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+
+namespace MScenary
+{
+	void Benchmark_Runner::add_result(const std::string& name, double items, const char* unit, size_t iterations, vector<double>& times)
+	{
+		std::sort(times.begin(), times.end());
+
+		Benchmark_Result result;
+
+		result.name = name;
+		result.unit = unit;
+		result.items = items;
+		result.iterations = iterations;
+		result.samples = unsigned(times.size());
+		result.min_ns = times.front();
+		result.median_ns = times[times.size() / 2];
+		result.mean_ns = std::accumulate(times.begin(), times.end(), 0.) / double(times.size());
+
+		results.push_back(result);
+
+		std::fprintf(stderr, "%-48s %14.1f ns %14.4g %s/s\n", name.c_str(), result.median_ns, items * 1e9 / result.median_ns, unit);
+	}
+
+	void Benchmark_Runner::write_json(std::ostream& stream) const
+	{
+		char line[512];
+
+		stream << "{\n\t\"format\": \"mscenary-benchmark\",\n\t\"version\": 1,\n";
+
+		#if defined(_MSC_VER)
+		std::snprintf(line, sizeof(line), "\t\"compiler\": \"msvc %d\",\n", _MSC_VER);
+		#elif defined(__clang__)
+		std::snprintf(line, sizeof(line), "\t\"compiler\": \"clang %d.%d\",\n", __clang_major__, __clang_minor__);
+		#elif defined(__GNUC__)
+		std::snprintf(line, sizeof(line), "\t\"compiler\": \"gcc %d.%d\",\n", __GNUC__, __GNUC_MINOR__);
+		#else
+		std::snprintf(line, sizeof(line), "\t\"compiler\": \"unknown\",\n");
+		#endif
+
+		stream << line;
+
+		#ifdef NDEBUG
+		stream << "\t\"build\": \"release\",\n";
+		#else
+		stream << "\t\"build\": \"debug\",\n";
+		#endif
+
+		stream << "\t\"results\":\n\t[\n";
+
+		// The names and units are plain identifiers made in the benchmark, nothing in them needs escaping.
+
+		for (size_t index = 0; index < results.size(); index++)
+		{
+			const Benchmark_Result& result = results[index];
+
+			std::snprintf
+			(
+				line, sizeof(line),
+				"\t\t{ \"name\": \"%s\", \"unit\": \"%s\", \"items\": %.0f, \"iterations\": %zu, \"samples\": %u, \"min_ns\": %.1f, \"median_ns\": %.1f, \"mean_ns\": %.1f, \"items_per_second\": %.1f }%s\n",
+				result.name.c_str(), result.unit.c_str(), result.items, result.iterations, result.samples,
+				result.min_ns, result.median_ns, result.mean_ns, result.items * 1e9 / result.median_ns,
+				index + 1 < results.size() ? "," : ""
+			);
+
+			stream << line;
+		}
+
+		stream << "\t]\n}\n";
+	}
+}
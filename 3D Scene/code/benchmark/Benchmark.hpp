@@ -0,0 +1,172 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Keeps the compiler from optimizing away a value a benchmark computes and never uses.
+	 *
+	 * @param value The value.
+	 */
+	template< typename TYPE >
+	inline void keep_value(const TYPE& value)
+	{
+		#ifdef _MSC_VER
+		const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+		(void)*sink;
+		_ReadWriteBarrier();
+		#else
+		asm volatile("" : : "r"(&value) : "memory");
+		#endif
+	}
+
+	/**
+	 * @brief Timings of a benchmark case, every time per iteration of the case.
+	 */
+	struct Benchmark_Result
+	{
+		std::string name;				///< Name of the case, its group first, like "rasterizer/flat/small/square".
+		std::string unit;				///< What an iteration processes, like "triangles" or "pixels".
+		double      items;				///< Units processed in every iteration.
+		size_t      iterations;			///< Iterations timed in every sample.
+		unsigned    samples;			///< Samples taken.
+		double      min_ns;				///< Fastest sample.
+		double      median_ns;			///< Median of the samples, the one to compare between runs.
+		double      mean_ns;			///< Mean of the samples.
+	};
+
+	/**
+	 * @brief Runs the benchmark cases and keeps their timings to write them as JSON, so runs of different versions can be compared.
+	 *
+	 * Every case is run until a sample takes long enough to be timed reliably, and then timed over several samples. The median
+	 * is what should be compared, the slowest samples are usually the ones another process got in the way of.
+	 */
+	class Benchmark_Runner
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		std::string              filter;			///< Only the cases whose name contains it are run, all of them if it's empty.
+		double                   sample_time;		///< Least time in seconds of every sample.
+		unsigned                 sample_count;		///< Samples taken of every case.
+		vector<Benchmark_Result> results;			///< Timings of the cases run so far.
+
+	public:
+
+		/**
+		 * @brief Creates a runner.
+		 *
+		 * @param filter Text the names of the cases to run must contain, empty to run them all.
+		 * @param sample_time Least time in seconds of every sample.
+		 * @param sample_count Samples taken of every case.
+		 */
+		Benchmark_Runner(const std::string& filter = std::string(), double sample_time = 0.05, unsigned sample_count = 9)
+			:
+			filter(filter),
+			sample_time(sample_time),
+			sample_count(sample_count > 0 ? sample_count : 1)
+		{
+		}
+
+		/**
+		 * @brief Checks if a case would be run, to skip preparing it otherwise.
+		 *
+		 * @param name The name of the case.
+		 * @return True if the name passes the filter.
+		 */
+		bool is_selected(const std::string& name) const
+		{
+			return filter.empty() || name.find(filter) != std::string::npos;
+		}
+
+		/**
+		 * @brief Times a case, if it passes the filter.
+		 *
+		 * @param name The name of the case.
+		 * @param items The units processed in every iteration.
+		 * @param unit What the units are.
+		 * @param iteration The work of an iteration, called many times in a row.
+		 */
+		template< typename FUNCTION >
+		void run(const std::string& name, double items, const char* unit, FUNCTION iteration)
+		{
+			if (!is_selected(name)) return;
+
+			// The first call warms the caches and whatever the case allocates on first use, it isn't timed.
+
+			iteration();
+
+			// The iterations of a sample double until it takes long enough.
+
+			size_t iterations = 1;
+
+			while (time_iterations(iteration, iterations) < sample_time && iterations < (size_t(1) << 30))
+			{
+				iterations *= 2;
+			}
+
+			vector<double> times(sample_count);
+
+			for (double& time : times)
+			{
+				time = time_iterations(iteration, iterations) * 1e9 / double(iterations);
+			}
+
+			add_result(name, items, unit, iterations, times);
+		}
+
+		const vector<Benchmark_Result>& get_results() const
+		{
+			return results;
+		}
+
+		/**
+		 * @brief Writes the timings as a JSON document, with a case per line so the files of two runs can also be diffed.
+		 *
+		 * @param stream Where to write it.
+		 */
+		void write_json(std::ostream& stream) const;
+
+	private:
+
+		template< typename FUNCTION >
+		double time_iterations(FUNCTION& iteration, size_t iterations)
+		{
+			Clock::time_point start = Clock::now();
+
+			for (size_t index = 0; index < iterations; index++)
+			{
+				iteration();
+			}
+
+			return std::chrono::duration<double>(Clock::now() - start).count();
+		}
+
+		/**
+		 * @brief Keeps the timings of a case and prints them in a readable line on the standard error.
+		 *
+		 * @param name The name of the case.
+		 * @param items The units processed in every iteration.
+		 * @param unit What the units are.
+		 * @param iterations The iterations of every sample.
+		 * @param times The time per iteration of every sample in nanoseconds.
+		 */
+		void add_result(const std::string& name, double items, const char* unit, size_t iterations, vector<double>& times);
+	};
+}
@@ -0,0 +1,231 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "../header/math.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief The flat and z-buffered fills of the Rasterizer as they were before it took its modes as policies, with the same edge
+	 * walk and the same rounding, so the verify case can check that the policy version still writes the same pixels and depths.
+	 *
+	 * It draws into a color buffer and a z-buffer of its own, without scissor, statistics or any mode but the two fills.
+	 */
+	template< class COLOR_BUFFER >
+	class Reference_Rasterizer
+	{
+	public:
+
+		typedef typename COLOR_BUFFER::Color Color;
+
+	private:
+
+		COLOR_BUFFER& color_buffer;
+		Color         color;
+		vector<int>   offset_cache0;		///< Offsets of the left edges of the scanlines, going counterclockwise.
+		vector<int>   offset_cache1;		///< Offsets of the right edges of the scanlines, going clockwise.
+		vector<int>   z_cache0;				///< Depth of the left edges of the scanlines.
+		vector<int>   z_cache1;				///< Depth of the right edges of the scanlines.
+		vector<int>   z_buffer;
+
+	public:
+
+		Reference_Rasterizer(COLOR_BUFFER& target)
+			:
+			color_buffer(target),
+			offset_cache0(target.get_height() + 2),
+			offset_cache1(target.get_height() + 2),
+			z_cache0(target.get_height() + 2),
+			z_cache1(target.get_height() + 2),
+			z_buffer(target.get_width() * target.get_height())
+		{
+		}
+
+		const vector<int>& get_z_buffer() const
+		{
+			return z_buffer;
+		}
+
+		void set_color(float r, float g, float b)
+		{
+			color.set(r, g, b);
+		}
+
+		void clear()
+		{
+			color_buffer.clear({ 0, 0.6f, 0.8f });
+
+			for (int& z : z_buffer) z = std::numeric_limits<int>::max();
+		}
+
+		void fill_convex_polygon(const Point4i* const vertices, const int* const indices_begin, const int* const indices_end)
+		{
+			fill<false>(vertices, indices_begin, indices_end);
+		}
+
+		void fill_convex_polygon_z_buffer(const Point4i* const vertices, const int* const indices_begin, const int* const indices_end)
+		{
+			fill<true>(vertices, indices_begin, indices_end);
+		}
+
+	private:
+
+		template< bool DEPTH >
+		void fill(const Point4i* const vertices, const int* const indices_begin, const int* const indices_end)
+		{
+			int        pitch = int(color_buffer.get_width());
+			Color*     pixels = color_buffer.pixels();
+			const int* indices_back = indices_end - 1;
+
+			// The start vertex is the one with the least Y and the end vertex the one with the greatest Y.
+
+			const int* start_index = indices_begin;
+			int        start_y = vertices[*start_index][1];
+			const int* end_index = indices_begin;
+			int        end_y = start_y;
+
+			for (const int* index_iterator = start_index; ++index_iterator < indices_end; )
+			{
+				int current_y = vertices[*index_iterator][1];
+
+				if (current_y < start_y)
+				{
+					start_y = current_y;
+					start_index = index_iterator;
+				}
+				else if (current_y > end_y)
+				{
+					end_y = current_y;
+					end_index = index_iterator;
+				}
+			}
+
+			// The edges from the start vertex to the end one counterclockwise.
+
+			const int* current_index = start_index;
+			const int* next_index = start_index > indices_begin ? start_index - 1 : indices_back;
+
+			int y0 = vertices[*current_index][1];
+			int y1 = vertices[*next_index][1];
+			int z0 = vertices[*current_index][2];
+			int z1 = vertices[*next_index][2];
+			int o0 = vertices[*current_index][0] + y0 * pitch;
+			int o1 = vertices[*next_index][0] + y1 * pitch;
+
+			for (;;)
+			{
+				interpolate<int64_t, 32>(offset_cache0.data(), o0, o1, y0, y1);
+				if (DEPTH) interpolate<int32_t, 0>(z_cache0.data(), z0, z1, y0, y1);
+
+				if (current_index == indices_begin) current_index = indices_back; else current_index--;
+				if (current_index == end_index) break;
+				if (next_index == indices_begin) next_index = indices_back; else next_index--;
+
+				y0 = y1;
+				y1 = vertices[*next_index][1];
+				z0 = z1;
+				z1 = vertices[*next_index][2];
+				o0 = o1;
+				o1 = vertices[*next_index][0] + y1 * pitch;
+			}
+
+			int end_offset = o1;
+
+			// And clockwise.
+
+			current_index = start_index;
+			next_index = start_index < indices_back ? start_index + 1 : indices_begin;
+
+			y0 = vertices[*current_index][1];
+			y1 = vertices[*next_index][1];
+			z0 = vertices[*current_index][2];
+			z1 = vertices[*next_index][2];
+			o0 = vertices[*current_index][0] + y0 * pitch;
+			o1 = vertices[*next_index][0] + y1 * pitch;
+
+			for (;;)
+			{
+				interpolate<int64_t, 32>(offset_cache1.data(), o0, o1, y0, y1);
+				if (DEPTH) interpolate<int32_t, 0>(z_cache1.data(), z0, z1, y0, y1);
+
+				if (current_index == indices_back) current_index = indices_begin; else current_index++;
+				if (current_index == end_index) break;
+				if (next_index == indices_back) next_index = indices_begin; else next_index++;
+
+				y0 = y1;
+				y1 = vertices[*next_index][1];
+				z0 = z1;
+				z1 = vertices[*next_index][2];
+				o0 = o1;
+				o1 = vertices[*next_index][0] + y1 * pitch;
+			}
+
+			if (o1 > end_offset) end_offset = o1;
+
+			// The scanlines from the least Y to the greatest one, each from the edge with the lesser offset.
+
+			for (int y = start_y; y < end_y; y++)
+			{
+				o0 = offset_cache0[y];
+				o1 = offset_cache1[y];
+				z0 = DEPTH ? z_cache0[y] : 0;
+				z1 = DEPTH ? z_cache1[y] : 0;
+
+				if (o1 < o0)
+				{
+					std::swap(o0, o1);
+					std::swap(z0, z1);
+				}
+
+				if (o0 == o1) continue;
+
+				int z_step = DEPTH ? (z1 - z0) / (o1 - o0) : 0;
+
+				for (; o0 < o1; o0++, z0 += z_step)
+				{
+					if (!DEPTH)
+					{
+						pixels[o0] = color;
+					}
+					else if (z0 < z_buffer[o0])
+					{
+						pixels[o0] = color;
+						z_buffer[o0] = z0;
+					}
+				}
+
+				if (o0 > end_offset) break;
+			}
+		}
+
+		template< typename VALUE_TYPE, size_t SHIFT >
+		static void interpolate(int* cache, int v0, int v1, int y_min, int y_max)
+		{
+			if (y_max > y_min)
+			{
+				VALUE_TYPE value = (VALUE_TYPE(v0) << SHIFT);
+				VALUE_TYPE step = (VALUE_TYPE(v1 - v0) << SHIFT) / (y_max - y_min);
+
+				for (int* iterator = cache + y_min, *end = cache + y_max; iterator <= end; )
+				{
+					*iterator++ = int(value >> SHIFT);
+					value += step;
+					*iterator++ = int(value >> SHIFT);
+					value += step;
+				}
+			}
+		}
+	};
+}
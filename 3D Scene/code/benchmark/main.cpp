@@ -0,0 +1,629 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+  /* Microbenchmarks of the hot loops of the renderer, written as JSON to the standard output or to a file:
+
+         benchmark [--filter text] [--output file] [--assets directory] [--quick]
+
+     The filter runs only the cases whose name contains the text, like "rasterizer/" or "/rgb565". The readable timings are
+     printed on the standard error as the cases run. Keep the JSON of every release to compare the medians of the next one.
+
+     The verify cases run before any timing and check that an optimized path still draws exactly what the code it replaced
+     did. If one finds any difference nothing is timed and the benchmark fails. */
+
+#include "Benchmark.hpp"
+#include "Reference_Rasterizer.hpp"
+#include "../header/Color.hpp"
+#include "../header/Color_Buffer.hpp"
+#include "../header/Color_Conversion.hpp"
+#include "../header/Frame_Arena.hpp"
+#include "../header/Image_Scaler.hpp"
+#include "../header/Light.hpp"
+#include "../header/Light_Grid.hpp"
+#include "../header/Mesh.hpp"
+#include "../header/Model.hpp"
+#include "../header/Rasterizer.hpp"
+#include "../header/Transform.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace MScenary;
+
+namespace
+{
+	typedef argb::Color_Buffer< Rgb888 > Rgb888_Buffer;
+
+	constexpr unsigned target_width = 1280;
+	constexpr unsigned target_height = 720;
+
+	/**
+	 * @brief Small and deterministic random numbers, so every run draws the same triangles.
+	 */
+	class Random
+	{
+		uint32_t state;
+
+	public:
+
+		Random(uint32_t seed) : state(seed) {}
+
+		/**
+		 * @brief Gets the next number.
+		 *
+		 * @return A number from 0 to 1.
+		 */
+		float next()
+		{
+			state = state * 1664525u + 1013904223u;
+			return float(state >> 8) / float(1u << 24);
+		}
+	};
+
+	/**
+	 * @brief Makes triangles spread over the target with a given size and shape.
+	 *
+	 * @param count The number of triangles.
+	 * @param size The width of their bounding box in pixels.
+	 * @param aspect How many times wider than tall they are.
+	 * @param layers How many triangles cover every spot, one on top of the other at growing depths.
+	 * @param vertices Where the vertices are left, three per triangle.
+	 */
+	void make_triangles(unsigned count, float size, float aspect, unsigned layers, vector<Point4i>& vertices)
+	{
+		float width = size;
+		float height = size / aspect;
+
+		vertices.clear();
+
+		for (unsigned index = 0; index < count; index++)
+		{
+			// Every group of layers shares its place, the first one is the farthest.
+
+			unsigned layer = index % layers;
+
+			Random place(uint32_t(index / layers) * 2654435761u + unsigned(size));
+
+			int left = int(place.next() * (float(target_width) - width - 2.f)) + 1;
+			int top = int(place.next() * (float(target_height) - height - 2.f)) + 1;
+			int z = 1000000 - int(layer) * 1000;
+
+			vertices.push_back(Point4i(left, top, z, 1));
+			vertices.push_back(Point4i(left + int(width), top + int(height * 0.3f), z, 1));
+			vertices.push_back(Point4i(left + int(width * 0.4f), top + int(height), z, 1));
+		}
+	}
+
+	void benchmark_rasterizer(Benchmark_Runner& runner)
+	{
+		struct Triangle_Case
+		{
+			const char* name;
+			unsigned    count;
+			float       size;
+			float       aspect;
+			unsigned    layers;
+		};
+
+		// From triangles smaller than the edge setup to ones covering a good part of the screen, square and sliver shaped,
+		// and piled up to see the cost of the depth test.
+
+		static const Triangle_Case cases[] =
+		{
+			{ "tiny/square",      4096,   4.f,  1.f, 1 },
+			{ "small/square",     4096,  16.f,  1.f, 1 },
+			{ "small/sliver",     4096,  64.f, 16.f, 1 },
+			{ "medium/square",    1024,  64.f,  1.f, 1 },
+			{ "medium/sliver",    1024, 256.f, 16.f, 1 },
+			{ "large/square",       64, 512.f,  1.f, 1 },
+			{ "medium/depth_8",   1024,  64.f,  1.f, 8 },
+		};
+
+		Rgb888_Buffer color_buffer(target_width, target_height);
+
+		std::unique_ptr< Rasterizer< Rgb888_Buffer > > rasterizer(new Rasterizer< Rgb888_Buffer >(color_buffer));
+
+		rasterizer->set_color(0.9f, 0.5f, 0.1f);
+
+		runner.run("rasterizer/clear", double(target_width * target_height), "pixels", [&]() { rasterizer->clear(); });
+
+		vector<Point4i> vertices;
+
+		static const int indices[] = { 0, 1, 2 };
+
+		for (const Triangle_Case& triangles : cases)
+		{
+			std::string flat_name = std::string("rasterizer/flat/") + triangles.name;
+			std::string depth_name = std::string("rasterizer/z_buffer/") + triangles.name;
+			std::string reversed_name = depth_name + "/front_to_back";
+
+			if (!runner.is_selected(flat_name) && !runner.is_selected(depth_name) && !runner.is_selected(reversed_name)) continue;
+
+			make_triangles(triangles.count, triangles.size, triangles.aspect, triangles.layers, vertices);
+
+			const Point4i* data = vertices.data();
+
+			runner.run(flat_name, double(triangles.count), "triangles", [&]()
+			{
+				for (size_t first = 0; first < vertices.size(); first += 3)
+				{
+					rasterizer->fill_convex_polygon(data + first, indices, indices + 3);
+				}
+			});
+
+			// The z-buffer is cleared once per iteration, so the farthest triangles drawn first pass the test every time.
+			// rasterizer/clear tells what that adds.
+
+			runner.run(depth_name, double(triangles.count), "triangles", [&]()
+			{
+				rasterizer->clear();
+
+				for (size_t first = 0; first < vertices.size(); first += 3)
+				{
+					rasterizer->fill_convex_polygon_z_buffer(data + first, indices, indices + 3);
+				}
+			});
+
+			if (triangles.layers > 1)
+			{
+				// Drawn from the nearest, every layer but the first fails the depth test.
+
+				runner.run(reversed_name, double(triangles.count), "triangles", [&]()
+				{
+					rasterizer->clear();
+
+					for (size_t first = vertices.size(); first > 0; first -= 3)
+					{
+						rasterizer->fill_convex_polygon_z_buffer(data + first - 3, indices, indices + 3);
+					}
+				});
+			}
+		}
+
+		keep_value(color_buffer.pixels()[0]);
+	}
+
+	/**
+	 * @brief Makes convex polygons of 3 to 6 vertices spread over the target, from slivers to a good part of it, with a
+	 * different depth in every vertex and wound both ways.
+	 *
+	 * @param count The number of polygons.
+	 * @param vertices Where the vertices are left.
+	 * @param polygons Where the index of the first vertex of every polygon is left, with the end of the last one after it.
+	 */
+	void make_polygons(unsigned count, vector<Point4i>& vertices, vector<int>& polygons)
+	{
+		Random random(12345);
+
+		vertices.clear();
+		polygons.assign(1, 0);
+
+		for (unsigned index = 0; index < count; index++)
+		{
+			unsigned sides = 3 + unsigned(random.next() * 3.99f);
+			float    radius_x = 2.f + random.next() * random.next() * 300.f;
+			float    radius_y = 2.f + random.next() * random.next() * 300.f;
+			float    center_x = radius_x + 1.f + random.next() * (float(target_width) - 2.f * radius_x - 2.f);
+			float    center_y = radius_y + 1.f + random.next() * (float(target_height) - 2.f * radius_y - 2.f);
+			float    angle = random.next() * 6.2831853f;
+			float    direction = random.next() < 0.5f ? 1.f : -1.f;
+
+			// Vertices taken in order around an ellipse always make a convex polygon.
+
+			for (unsigned side = 0; side < sides; side++, angle += direction * 6.2831853f / float(sides))
+			{
+				int x = int(center_x + radius_x * std::cos(angle));
+				int y = int(center_y + radius_y * std::sin(angle));
+				int z = 1000 + int(random.next() * 1000000.f);
+
+				vertices.push_back(Point4i(x, y, z, 1));
+			}
+
+			polygons.push_back(int(vertices.size()));
+		}
+	}
+
+	/**
+	 * @brief Checks that the Rasterizer fills the same pixels with the same depths as the code it replaced, drawing a few
+	 * thousand polygons through both into their own targets and comparing them.
+	 *
+	 * @return True if there isn't a single difference.
+	 */
+	bool verify_rasterizer()
+	{
+		Rgb888_Buffer color_buffer(target_width, target_height);
+		Rgb888_Buffer reference_buffer(target_width, target_height);
+
+		std::unique_ptr< Rasterizer< Rgb888_Buffer > >           rasterizer(new Rasterizer< Rgb888_Buffer >(color_buffer));
+		std::unique_ptr< Reference_Rasterizer< Rgb888_Buffer > > reference(new Reference_Rasterizer< Rgb888_Buffer >(reference_buffer));
+
+		vector<Point4i> vertices;
+		vector<int>     polygons;
+		vector<int>     indices;
+
+		make_polygons(4096, vertices, polygons);
+
+		for (int index = 0; index < int(vertices.size()); index++) indices.push_back(index);
+
+		bool passed = true;
+
+		for (unsigned depth = 0; depth < 2; depth++)
+		{
+			rasterizer->clear();
+			reference->clear();
+
+			for (size_t polygon = 0; polygon + 1 < polygons.size(); polygon++)
+			{
+				// Every polygon of its own color, so one drawn over the wrong one shows.
+
+				float shade = float(polygon % 251) / 250.f;
+
+				rasterizer->set_color(shade, 1.f - shade, 0.5f);
+				reference->set_color(shade, 1.f - shade, 0.5f);
+
+				const int* begin = indices.data() + polygons[polygon];
+				const int* end = indices.data() + polygons[polygon + 1];
+
+				if (depth)
+				{
+					rasterizer->fill_convex_polygon_z_buffer(vertices.data(), begin, end);
+					reference->fill_convex_polygon_z_buffer(vertices.data(), begin, end);
+				}
+				else
+				{
+					rasterizer->fill_convex_polygon(vertices.data(), begin, end);
+					reference->fill_convex_polygon(vertices.data(), begin, end);
+				}
+			}
+
+			size_t different_pixels = 0;
+			size_t different_depths = 0;
+
+			for (size_t offset = 0; offset < color_buffer.get_size(); offset++)
+			{
+				if (std::memcmp(color_buffer.pixels() + offset, reference_buffer.pixels() + offset, sizeof(argb::Rgb888)) != 0) different_pixels++;
+				if (rasterizer->get_z_buffer()[offset] != reference->get_z_buffer()[offset]) different_depths++;
+			}
+
+			const char* name = depth ? "verify/rasterizer/z_buffer" : "verify/rasterizer/flat";
+
+			std::fprintf(stderr, "%-48s %zu different pixels, %zu different depths\n", name, different_pixels, different_depths);
+
+			if (different_pixels > 0 || different_depths > 0) passed = false;
+		}
+
+		return passed;
+	}
+
+	/**
+	 * @brief Times clearing a target of a pixel format and blitting an image of it into another.
+	 *
+	 * @param runner The runner.
+	 * @param format The name of the format in the case names.
+	 */
+	template< typename COLOR >
+	void benchmark_color_buffer(Benchmark_Runner& runner, const char* format)
+	{
+		typedef argb::Color_Buffer< COLOR > Buffer;
+
+		std::string clear_name = std::string("color_buffer/clear/") + format;
+		std::string blit_name = std::string("color_buffer/blit/") + format;
+
+		if (!runner.is_selected(clear_name) && !runner.is_selected(blit_name)) return;
+
+		Buffer target(target_width, target_height);
+		Buffer image(256, 256);
+
+		const COLOR background(0.f, 0.6f, 0.8f);
+
+		image.clear(COLOR(1.f, 0.5f, 0.f));
+
+		runner.run(clear_name, double(target.get_size()), "pixels", [&]()
+		{
+			target.clear(background);
+			keep_value(target.pixels()[0]);
+		});
+
+		runner.run(blit_name, double(image.get_size()), "pixels", [&]()
+		{
+			target.blit(image, 320, 200);
+			keep_value(target.pixels()[0]);
+		});
+	}
+
+	/**
+	 * @brief Times converting a whole target from a pixel format to another, with and without dithering.
+	 *
+	 * @param runner The runner.
+	 * @param formats The names of both formats in the case names, like "rgb888_to_rgb565".
+	 */
+	template< typename SOURCE, typename TARGET >
+	void benchmark_conversion(Benchmark_Runner& runner, const char* formats)
+	{
+		std::string name = std::string("color_buffer/convert/") + formats;
+		std::string dithered_name = name + "/dithered";
+
+		if (!runner.is_selected(name) && !runner.is_selected(dithered_name)) return;
+
+		argb::Color_Buffer< SOURCE > source(target_width, target_height);
+		argb::Color_Buffer< TARGET > target(target_width, target_height);
+
+		// A gradient, so the dithering has something to do.
+
+		for (unsigned y = 0; y < target_height; y++)
+		{
+			for (unsigned x = 0; x < target_width; x++)
+			{
+				source.set_pixel(x, y, SOURCE(float(x) / float(target_width), float(y) / float(target_height), 0.5f));
+			}
+		}
+
+		runner.run(name, double(target.get_size()), "pixels", [&]()
+		{
+			convert_pixels(source, target);
+			keep_value(target.pixels()[0]);
+		});
+
+		runner.run(dithered_name, double(target.get_size()), "pixels", [&]()
+		{
+			convert_pixels(source, target, ORDERED_DITHERING);
+			keep_value(target.pixels()[0]);
+		});
+	}
+
+	/**
+	 * @brief Times blitting a frame into a target of the same format scaled up with both filters, into a rectangle that goes past
+	 * its right side, and blitting it converted to another format.
+	 *
+	 * @param runner The runner.
+	 */
+	void benchmark_blits(Benchmark_Runner& runner)
+	{
+		static const Scale_Filter filters[] = { NEAREST_FILTER, BILINEAR_FILTER };
+		static const char* const  filter_names[] = { "nearest", "bilinear" };
+
+		argb::Color_Buffer< argb::Rgb888 > image(target_width / 2, target_height / 2);
+		argb::Color_Buffer< argb::Rgb888 > target(target_width, target_height);
+		Image_Scaler                       scaler;
+
+		for (unsigned y = 0; y < image.get_height(); y++)
+		{
+			for (unsigned x = 0; x < image.get_width(); x++)
+			{
+				image.set_pixel(x, y, argb::Rgb888(float(x) / float(image.get_width()), float(y) / float(image.get_height()), 0.5f));
+			}
+		}
+
+		// A quarter of the rectangle falls outside, its pixels aren't counted.
+
+		Screen_Rect destination;
+
+		destination.left = int(target_width) / 4;
+		destination.top = 0;
+		destination.right = destination.left + int(target_width);
+		destination.bottom = int(target_height);
+
+		for (unsigned index = 0; index < 2; index++)
+		{
+			std::string name = std::string("color_buffer/blit_scaled/") + filter_names[index];
+
+			if (!runner.is_selected(name)) continue;
+
+			runner.run(name, double(target.get_size()) * 0.75, "pixels", [&]()
+			{
+				scaler.blit(image, target, destination, filters[index]);
+				keep_value(target.pixels()[0]);
+			});
+		}
+
+		if (runner.is_selected("color_buffer/blit_converted/rgb888_to_rgb565"))
+		{
+			argb::Color_Buffer< argb::Rgb565 > converted(target_width, target_height);
+
+			runner.run("color_buffer/blit_converted/rgb888_to_rgb565", double(image.get_size()), "pixels", [&]()
+			{
+				blit_converted(image, converted, 320, 200, ORDERED_DITHERING);
+				keep_value(converted.pixels()[0]);
+			});
+		}
+	}
+
+	void benchmark_transforms(Benchmark_Runner& runner)
+	{
+		// Chains as deep as a node under a few levels of parents and as deep as a skeleton.
+
+		static const unsigned depths[] = { 1, 4, 16 };
+
+		for (unsigned depth : depths)
+		{
+			std::string name = "transform/chain_" + std::to_string(depth);
+
+			if (!runner.is_selected(name)) continue;
+
+			vector<std::unique_ptr<Transform>> chain;
+
+			for (unsigned level = 0; level < depth; level++)
+			{
+				chain.emplace_back(new Transform());
+
+				Transform& transform = *chain.back();
+
+				transform.set_position(float(level) * 0.5f, 1.f, -2.f);
+				transform.set_rotation(0.1f * float(level), 0.3f, 0.05f);
+				transform.set_scale(1.01f);
+
+				if (level > 0) transform.set_transform_parent(chain[level - 1].get());
+			}
+
+			Transform& leaf = *chain.back();
+
+			runner.run(name, double(depth), "transforms", [&]()
+			{
+				Matrix44 matrix = leaf.get_transform_matrix();
+				keep_value(matrix);
+			});
+		}
+	}
+
+	/**
+	 * @brief Times the render of every mesh of the bundled assets, framed to fill most of the target and lit by a single light.
+	 *
+	 * @param runner The runner.
+	 * @param assets The directory of the assets, ending in a slash.
+	 */
+	void benchmark_meshes(Benchmark_Runner& runner, const std::string& assets)
+	{
+		static const char* const files[] = { "cloud", "ext_plat", "main_island", "ship", "sphere", "stanford-bunny" };
+
+		Rgb888_Buffer color_buffer(target_width, target_height);
+
+		std::unique_ptr< Rasterizer< Rgb888_Buffer > > rasterizer(new Rasterizer< Rgb888_Buffer >(color_buffer));
+
+		Light light(nullptr, 4.f, 0.3f);
+
+		light.get_transform()->set_position(2.f, 4.f, 3.f);
+		light.update_world_matrix();
+		light.update_world_position();
+
+		vector<Light*> lights(1, &light);
+		Light_Grid     light_grid;
+
+		for (const char* file : files)
+		{
+			std::string name = std::string("mesh/render/") + file;
+
+			if (!runner.is_selected(name)) continue;
+
+			Model model(nullptr, (assets + file + ".obj").c_str());
+
+			if (model.get_meshes().empty())
+			{
+				std::cerr << "Can't load " << assets << file << ".obj, skipping it" << std::endl;
+				continue;
+			}
+
+			for (size_t index = 0; index < model.get_meshes().size(); index++)
+			{
+				const Mesh& mesh = *model.get_meshes()[index];
+
+				// The camera looks at the mesh from far enough for its bounding sphere to fit the view.
+
+				const Point3f& center = mesh.get_bounding_center();
+				float          radius = mesh.get_bounding_radius();
+
+				Matrix44 view_matrix = translate(Matrix44(1), Vector3f(0.f, 0.f, -2.5f * radius) - Vector3f(center));
+				Matrix44 projection_matrix = perspective(0.9f, 0.1f * radius, 10.f * radius, float(target_width) / float(target_height)) * view_matrix;
+
+				light_grid.build(lights, view_matrix, projection_matrix, target_width, target_height);
+
+				std::string mesh_name = model.get_meshes().size() > 1 ? name + "/" + std::to_string(index) : name;
+
+				// Every iteration clears the target like a frame does, rasterizer/clear tells what that adds.
+
+				runner.run(mesh_name, double(mesh.get_vertex_count()), "vertices", [&]()
+				{
+					Frame_Arena::local().reset();
+
+					rasterizer->clear();
+					mesh.render(*rasterizer, projection_matrix, view_matrix, light_grid, 0);
+				});
+			}
+		}
+
+		keep_value(color_buffer.pixels()[0]);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filter;
+	std::string output;
+	std::string assets = "../../assets/";
+	bool        quick = false;
+
+	for (int index = 1; index < argc; index++)
+	{
+		std::string argument = argv[index];
+
+		if (argument == "--quick")
+		{
+			quick = true;
+		}
+		else if (index + 1 < argc && argument == "--filter")
+		{
+			filter = argv[++index];
+		}
+		else if (index + 1 < argc && argument == "--output")
+		{
+			output = argv[++index];
+		}
+		else if (index + 1 < argc && argument == "--assets")
+		{
+			assets = argv[++index];
+
+			if (!assets.empty() && assets.back() != '/' && assets.back() != '\\') assets += '/';
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--filter text] [--output file] [--assets directory] [--quick]" << std::endl;
+			return 1;
+		}
+	}
+
+	// A quick run is only good to check that every case works, its timings are too noisy to compare.
+
+	Benchmark_Runner runner(filter, quick ? 0.005 : 0.05, quick ? 3 : 9);
+
+	if (runner.is_selected("verify/rasterizer") && !verify_rasterizer())
+	{
+		std::cerr << "The rasterizer doesn't draw what the reference does" << std::endl;
+		return 1;
+	}
+
+	benchmark_rasterizer(runner);
+
+	benchmark_color_buffer< argb::Rgb332   >(runner, "rgb332");
+	benchmark_color_buffer< argb::Rgb565   >(runner, "rgb565");
+	benchmark_color_buffer< argb::Rgb888   >(runner, "rgb888");
+	benchmark_color_buffer< argb::Rgba8888 >(runner, "rgba8888");
+	benchmark_color_buffer< argb::Rgbaf    >(runner, "rgbaf");
+
+	benchmark_conversion< argb::Rgb888,   argb::Rgb565   >(runner, "rgb888_to_rgb565");
+	benchmark_conversion< argb::Rgb888,   argb::Rgb332   >(runner, "rgb888_to_rgb332");
+	benchmark_conversion< argb::Rgb888,   argb::Rgba8888 >(runner, "rgb888_to_rgba8888");
+	benchmark_conversion< argb::Rgb888,   argb::Rgbf     >(runner, "rgb888_to_rgbf");
+	benchmark_conversion< argb::Rgbf,     argb::Rgb888   >(runner, "rgbf_to_rgb888");
+	benchmark_conversion< argb::Rgb888,   argb::Argb4444 >(runner, "rgb888_to_argb4444");
+
+	benchmark_blits(runner);
+
+	benchmark_transforms(runner);
+	benchmark_meshes(runner, assets);
+
+	if (output.empty())
+	{
+		runner.write_json(std::cout);
+		return 0;
+	}
+
+	std::ofstream file(output);
+
+	if (!file)
+	{
+		std::cerr << "Can't write " << output << std::endl;
+		return 1;
+	}
+
+	runner.write_json(file);
+
+	return file ? 0 : 1;
+}
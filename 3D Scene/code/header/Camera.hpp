@@ -63,6 +63,16 @@ namespace MScenary
 		 */
 		Matrix44 get_projection_matrix();
 
+		/**
+		 * @brief Gets the perspective of the camera alone, without the view matrix.
+		 *
+		 * @return The perspective matrix.
+		 */
+		const Matrix44& get_perspective_matrix() const
+		{
+			return perspective_matrix;
+		}
+
 		/**
 		 * @brief Gets the inverse of the trasnform of the camera matrix
 		 *
@@ -162,7 +162,7 @@
             static constexpr auto  bits = sizeof(Type) * 8;
 
             static Type scale (const float   & value) { return value; }
-            static Type scale (const uint8_t & value) { return value * (1.f / 255.f); }     // USAR UNA TABLA? (256*4=1KB)
+            static Type scale (const uint8_t & value) { return value * (1.f / 255.f); }     // Para buffers enteros convert_pixels() usa una tabla
         };
 
         /*template< >
@@ -62,8 +62,8 @@
 
         public:
 
-                  Color_Format * pixels ()  { return buffer.data (); }
-            const Color_Format * pixels () const { return buffer.data (); }
+                  Color_Format * pixels ()  { return start; }
+            const Color_Format * pixels () const { return start; }
 
                   Iterator       begin  ()       { return start; }
             const Iterator       begin  () const { return start; }
@@ -86,32 +86,48 @@
                 return size;
             }
 
+            // Memoria propia del buffer, que sigue reservada aunque se dibuje en memoria ajena:
+
+            size_t get_allocated_bytes () const
+            {
+                return buffer.capacity () * sizeof(Color_Format);
+            }
+
+            // Hace que el buffer use memoria ajena del mismo tamaño en lugar de la suya, como la de una región compartida con
+            // otro proceso, de modo que lo que se dibuje en él acabe ahí sin copiarlo. Con nullptr vuelve a usar la suya.
+
+            void set_memory (Color_Format * memory)
+            {
+                start  = memory ? memory : buffer.data ();
+                ending = start + size;
+            }
+
         public:
 
             void clear (const Color & color)
             {
-                std::fill_n (buffer.data (), size, color);
+                std::fill_n (start, size, color);
             }
 
             Color get_pixel(unsigned x, unsigned y) const
             {
                 assert(x < width && y < height);
 
-                return buffer[y * width + x];
+                return start[y * width + x];
             }
 
             void set_pixel (unsigned x, unsigned y, const Color & color)
             {
                 assert(x < width && y < height);
 
-                buffer[y * width + x] = color;
+                start[y * width + x] = color;
             }
 
             void set_pixel (unsigned offset, const Color & color)
             {
-                assert(offset < buffer.size ());
+                assert(offset < size);
 
-                buffer[offset] = color;
+                start[offset] = color;
             }
 
             explicit operator Color_Format * ()
@@ -126,7 +142,10 @@
 
             void blit_to_window () const;
 
-            void blit(const Color_Buffer& source, Color_Buffer& target, int x, int y);
+            // Copia otra imagen con su esquina superior izquierda en (x, y), recortando lo que quede fuera del buffer. Cada fila
+            // se copia de una vez:
+
+            void blit (const Color_Buffer & source, int x, int y);
         };
 
         template< >
@@ -134,7 +153,7 @@
         {
             glRasterPos2f (-1.f, +1.f);
             glPixelZoom   (+1.f, -1.f);
-            glDrawPixels  (int(width), int(height), GL_RGB, /*GL_UNSIGNED_BYTE_3_3_2*/0x8032, buffer.data ());
+            glDrawPixels  (int(width), int(height), GL_RGB, /*GL_UNSIGNED_BYTE_3_3_2*/0x8032, start);
         }
 
         template< >
@@ -142,7 +161,7 @@
         {
             glRasterPos2f (-1.f, +1.f);
             glPixelZoom   (+1.f, -1.f);
-            glDrawPixels  (int(width), int(height), GL_RGB, /*GL_UNSIGNED_SHORT_5_6_5*/0x8363, buffer.data ());
+            glDrawPixels  (int(width), int(height), GL_RGB, /*GL_UNSIGNED_SHORT_5_6_5*/0x8363, start);
         }
 
         template< >
@@ -150,32 +169,25 @@
         {
             glRasterPos2f (-1.f, +1.f);
             glPixelZoom   (+1.f, -1.f);
-            glDrawPixels  (int(width), int(height), GL_RGB, GL_UNSIGNED_BYTE, buffer.data ());
+            glDrawPixels  (int(width), int(height), GL_RGB, GL_UNSIGNED_BYTE, start);
         }
 
-        template<class COLOR>
-        void Color_Buffer<COLOR>::blit(const Color_Buffer<COLOR> & source, Color_Buffer<COLOR> & target, int x, int y)
+        template< class COLOR >
+        void Color_Buffer< COLOR >::blit (const Color_Buffer & source, int x, int y)
         {
-            unsigned image_height = source.get_height();
-            unsigned image_width  = source.get_width();
+            int left   = std::max (x, 0);
+            int top    = std::max (y, 0);
+            int right  = std::min (x + int(source.get_width ()), int(width ));
+            int bottom = std::min (y + int(source.get_height()), int(height));
 
-            const Color * source_iterator = source.pixels();
-            Color* target_iterator = target.pixels() + y * target.get_width() + x;
+            if (left >= right || top >= bottom) return;
 
-            unsigned delta = target.get_width() - image_width;
-
-            while (--image_height)
+            for (int row = top; row < bottom; ++row)
             {
-                auto end = source_iterator + image_width;
-
-                while (source_iterator < end)
-                {
-                    *target_iterator++ = *source_iterator++;
-                }
+                const Color * source_row = source.pixels () + size_t(row - y) * source.get_width () + (left - x);
 
-                target_iterator += delta;
+                std::copy (source_row, source_row + (right - left), start + size_t(row) * width + left);
             }
-
         }
 
     }
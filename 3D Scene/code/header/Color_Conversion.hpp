@@ -0,0 +1,275 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+namespace MScenary
+{
+	using argb::Color_Buffer;
+	using argb::Rgb332;
+	using argb::Rgb565;
+	using argb::Rgb888;
+	using argb::Rgba8888;
+	using argb::Rgbf;
+	using argb::Rgbaf;
+
+	/**
+	 * @brief How the colors are quantized when the target format has fewer levels than the source.
+	 */
+	enum Dithering
+	{
+		NO_DITHERING,		///< Every channel is rounded to the nearest level, which shows bands in smooth gradients.
+		ORDERED_DITHERING,	///< Every channel is rounded up or down following a 4x4 Bayer matrix, so the bands become a fine pattern.
+	};
+
+	namespace color_conversion
+	{
+		/**
+		 * @brief Offset added to every channel before truncating it with ordered dithering, by pixel of a 4x4 tile. The offsets
+		 * are the ones of the Bayer matrix plus a half, so on average a channel is rounded to the nearest level.
+		 *
+		 * @param x The column of the pixel.
+		 * @param y The row of the pixel.
+		 * @return The offset, between 0 and 1.
+		 */
+		inline float bayer_offset(unsigned x, unsigned y)
+		{
+			static const unsigned char matrix[4][4] =
+			{
+				{  0,  8,  2, 10 },
+				{ 12,  4, 14,  6 },
+				{  3, 11,  1,  9 },
+				{ 15,  7, 13,  5 },
+			};
+
+			return (float(matrix[y & 3][x & 3]) + 0.5f) / 16.f;
+		}
+
+		/**
+		 * @brief Reads and writes the channels of a color as numbers from 0 to the largest level of each, whatever the format.
+		 */
+		template< class COLOR, bool PACKED = std::is_void< typename COLOR::Component_Type >::value >
+		struct Channels
+		{
+			static constexpr bool is_float = COLOR::Component_Type_Traits::is_float;
+
+			template< unsigned CHANNEL >
+			static constexpr float max()
+			{
+				return COLOR::Component_Type_Traits::maxf;
+			}
+
+			template< unsigned CHANNEL >
+			static float get(const COLOR& color)
+			{
+				return float(color.components[CHANNEL]);
+			}
+
+			template< unsigned CHANNEL, typename VALUE >
+			static void set(COLOR& color, VALUE value)
+			{
+				color.components[CHANNEL] = typename COLOR::Component_Type(value);
+			}
+		};
+
+		template< class COLOR >
+		struct Channels< COLOR, true >
+		{
+			template< unsigned CHANNEL >
+			using Traits = typename COLOR::Component_Layout::template Component_Traits< CHANNEL >;
+
+			static constexpr bool is_float = false;
+
+			template< unsigned CHANNEL >
+			static constexpr float max()
+			{
+				return Traits< CHANNEL >::maxf;
+			}
+
+			template< unsigned CHANNEL >
+			static float get(const COLOR& color)
+			{
+				return float((color.value >> Traits< CHANNEL >::shift) & Traits< CHANNEL >::mask);
+			}
+
+			/** The value of the color has to be 0 before the first channel is set, they're added to it. */
+			template< unsigned CHANNEL, typename VALUE >
+			static void set(COLOR& color, VALUE value)
+			{
+				color.value |= typename COLOR::Composite_Type(value) << Traits< CHANNEL >::shift;
+			}
+		};
+
+		template< class COLOR >
+		struct Has_Alpha
+		{
+			template< class TYPE > static std::true_type  test(decltype(TYPE::ALPHA)*);
+			template< class TYPE > static std::false_type test(...);
+
+			static constexpr bool value = decltype(test< COLOR >(nullptr))::value;
+		};
+
+		template< class COLOR >
+		void set_opaque(COLOR&, std::false_type)
+		{
+		}
+
+		template< class COLOR >
+		void set_opaque(COLOR& color, std::true_type)
+		{
+			Channels< COLOR >::template set< COLOR::ALPHA >(color, Channels< COLOR >::template max< COLOR::ALPHA >());
+		}
+
+		/**
+		 * @brief Converts a channel. Between integer formats the level is scaled and rounded, or dithered when the offset isn't a half
+		 * and the target has fewer levels. Float channels are clamped to [0, 1] when converted to an integer format.
+		 *
+		 * The fast kernels of convert_pixels() use exactly the same operations, so every path gives the same pixels.
+		 */
+		template< class SOURCE, class TARGET, unsigned SOURCE_CHANNEL, unsigned TARGET_CHANNEL >
+		void convert_channel(const SOURCE& source, TARGET& target, float offset)
+		{
+			typedef Channels< SOURCE > Source;
+			typedef Channels< TARGET > Target;
+
+			const float target_max = Target::template max< TARGET_CHANNEL >();
+			const float scale = target_max / Source::template max< SOURCE_CHANNEL >();
+
+			float value = Source::template get< SOURCE_CHANNEL >(source);
+
+			// Dithering only helps where levels are lost, otherwise the channel is just rounded.
+
+			if (!Source::is_float && target_max >= Source::template max< SOURCE_CHANNEL >()) offset = 0.5f;
+
+			if (Target::is_float)
+			{
+				Target::template set< TARGET_CHANNEL >(target, value * scale);
+				return;
+			}
+
+			if (Source::is_float) value = std::min(std::max(value, 0.f), 1.f);
+
+			Target::template set< TARGET_CHANNEL >(target, std::min(unsigned(value * scale + offset), unsigned(target_max)));
+		}
+
+		template< class SOURCE, class TARGET >
+		void convert_pixel(const SOURCE& source, TARGET& target, float offset)
+		{
+			target = TARGET();
+
+			convert_channel< SOURCE, TARGET, SOURCE::RED,   TARGET::RED   >(source, target, offset);
+			convert_channel< SOURCE, TARGET, SOURCE::GREEN, TARGET::GREEN >(source, target, offset);
+			convert_channel< SOURCE, TARGET, SOURCE::BLUE,  TARGET::BLUE  >(source, target, offset);
+
+			set_opaque(target, std::integral_constant< bool, Has_Alpha< TARGET >::value >());
+		}
+	}
+
+	/**
+	 * @brief Converts a run of pixels of a row to another color format.
+	 *
+	 * Integer channels are scaled to the levels of the target and rounded to the nearest one, or dithered, float channels are
+	 * clamped to [0, 1] before being converted to integers. Formats with alpha get it opaque, the alpha of the source is dropped.
+	 *
+	 * This is the generic version, a pixel at a time through floats. The conversions from the format the scene draws in, and
+	 * back, have overloads below with faster kernels that give the same pixels.
+	 *
+	 * @param source The first pixel to convert.
+	 * @param target Where to write the first pixel.
+	 * @param count The number of pixels.
+	 * @param x The column of the first pixel in the target, which picks the dithering pattern.
+	 * @param y The row in the target.
+	 * @param dithering How to quantize the channels when the target has fewer levels than the source.
+	 */
+	template< class SOURCE, class TARGET >
+	void convert_row(const SOURCE* source, TARGET* target, unsigned count, unsigned x, unsigned y, Dithering dithering)
+	{
+		for (unsigned index = 0; index < count; index++)
+		{
+			float offset = dithering == ORDERED_DITHERING ? color_conversion::bayer_offset(x + index, y) : 0.5f;
+
+			color_conversion::convert_pixel(source[index], target[index], offset);
+		}
+	}
+
+	/** Vectorized, 4 pixels at a time. */
+	void convert_row(const Rgb888* source, Rgb565* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Vectorized, 4 pixels at a time. */
+	void convert_row(const Rgb888* source, Rgb332* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Moves the bytes 4 pixels at a time, there's nothing to quantize. */
+	void convert_row(const Rgb888* source, Rgba8888* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Moves the bytes 4 pixels at a time, there's nothing to quantize. */
+	void convert_row(const Rgba8888* source, Rgb888* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Through a table of the 256 levels, there's nothing to quantize. */
+	void convert_row(const Rgb888* source, Rgbf* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Through a table of the 256 levels, there's nothing to quantize. */
+	void convert_row(const Rgb888* source, Rgbaf* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Vectorized, 4 pixels at a time. */
+	void convert_row(const Rgbf* source, Rgb888* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/** Through tables of the 32 and 64 levels, there's nothing to dither. */
+	void convert_row(const Rgb565* source, Rgb888* target, unsigned count, unsigned x, unsigned y, Dithering dithering);
+
+	/**
+	 * @brief Converts a whole buffer to another color format, like the frame to the format of the output, a row at a time with
+	 * the fastest convert_row() there is for both formats.
+	 *
+	 * @param source The buffer to convert.
+	 * @param target The buffer the pixels are written into, of the same size.
+	 * @param dithering How to quantize the channels when the target has fewer levels than the source.
+	 */
+	template< class SOURCE, class TARGET >
+	void convert_pixels(const Color_Buffer< SOURCE >& source, Color_Buffer< TARGET >& target, Dithering dithering = NO_DITHERING)
+	{
+		assert(source.get_width() == target.get_width() && source.get_height() == target.get_height());
+
+		unsigned width = source.get_width();
+
+		for (unsigned y = 0, height = source.get_height(); y < height; y++)
+		{
+			convert_row(source.pixels() + size_t(y) * width, target.pixels() + size_t(y) * width, width, 0, y, dithering);
+		}
+	}
+
+	/**
+	 * @brief Copies an image of another color format into a buffer, like Color_Buffer::blit(), converting the pixels on the way.
+	 * Whatever falls outside the target is left out, and the dithering pattern stays fixed to the target wherever the image goes.
+	 *
+	 * @param source The image.
+	 * @param target The buffer it's copied into.
+	 * @param x The column of the target the left column of the image goes to, it can be negative.
+	 * @param y The row of the target the top row of the image goes to, it can be negative.
+	 * @param dithering How to quantize the channels when the target has fewer levels than the source.
+	 */
+	template< class SOURCE, class TARGET >
+	void blit_converted(const Color_Buffer< SOURCE >& source, Color_Buffer< TARGET >& target, int x, int y, Dithering dithering = NO_DITHERING)
+	{
+		int left = std::max(x, 0);
+		int top = std::max(y, 0);
+		int right = std::min(x + int(source.get_width()), int(target.get_width()));
+		int bottom = std::min(y + int(source.get_height()), int(target.get_height()));
+
+		for (int row = top; row < bottom && left < right; row++)
+		{
+			const SOURCE* source_row = source.pixels() + size_t(row - y) * source.get_width() + (left - x);
+			TARGET*       target_row = target.pixels() + size_t(row) * target.get_width() + left;
+
+			convert_row(source_row, target_row, unsigned(right - left), unsigned(left), unsigned(row), dithering);
+		}
+	}
+}
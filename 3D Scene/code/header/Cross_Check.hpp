@@ -0,0 +1,189 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Scene_View.hpp"
+#include "Dirty_Region.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Tile of an image with pixels that didn't match the reference.
+	 */
+	struct Mismatch_Region
+	{
+		Screen_Rect bounds;		///< Pixels covered by the tile.
+		size_t      pixels;		///< Pixels of the tile whose color or depth didn't match.
+	};
+
+	/**
+	 * @brief What was found comparing an image drawn through the optimized paths with the same image drawn through the reference ones.
+	 */
+	struct Cross_Check_Result
+	{
+		uint64_t                image = 0;				///< Number of the image among all the ones checked, from 0.
+		size_t                  color_mismatches = 0;	///< Pixels with any channel further from the reference than the tolerance.
+		size_t                  depth_mismatches = 0;	///< Pixels with a depth further from the reference than the tolerance.
+		int                     max_color_error = 0;	///< Largest difference of a channel, within the tolerance or not.
+		int64_t                 max_depth_error = 0;	///< Largest difference of depth, within the tolerance or not.
+		Screen_Rect             bounds;					///< Rectangle around every pixel that didn't match, empty if all did.
+		vector<Mismatch_Region> regions;				///< Tiles with pixels that didn't match, in rows from the top left.
+
+		bool passed() const
+		{
+			return color_mismatches == 0 && depth_mismatches == 0;
+		}
+	};
+
+	/**
+	 * @brief Checks that the optimized paths of the renderer draw the same images as the reference ones.
+	 *
+	 * The scene draws every view as usual, and then again into a reference view of the same size and camera through the
+	 * reference paths: on a single thread, with the plain loops instead of the vectorized kernels, whole instead of only
+	 * what changed and without occlusion culling. Both images are compared pixel by pixel, the color and the depth, and
+	 * what didn't match is reported by tiles.
+	 *
+	 * The shadow maps and the lights are shared by both images, they're the same for every view of a frame. With anti-aliasing the
+	 * depth stays in the multisampled target, so only the color is compared.
+	 */
+	class Cross_Check
+	{
+	public:
+
+		typedef Scene_View::Color_Buffer Color_Buffer;	///< Alias for 24 bit color buffer type.
+
+	private:
+
+		int                                 color_tolerance;	///< Largest difference of a channel still taken as a match.
+		int                                 depth_tolerance;	///< Largest difference of depth still taken as a match.
+		unsigned                            tile_size;			///< Width and height of the tiles the mismatches are reported by.
+		std::unique_ptr<Scene_View>         reference;			///< View every reference is drawn into, one after another.
+		vector<Scene_View::Lod_Map>         frame_lods;			///< Levels of detail every view of the frame started from, by position.
+		vector<Cross_Check_Result>          results;			///< Results of the views of the last frame checked.
+		std::ostream*                       log;				///< Where the images that fail are reported as they're checked, if anywhere.
+		std::string                         difference_path;	///< Start of the names of the difference images of the failed images, none if empty.
+		uint64_t                            images_checked;		///< Images compared so far.
+		uint64_t                            images_failed;		///< Images compared so far that didn't match.
+
+	public:
+
+		/**
+		 * @brief Creates a cross-check.
+		 *
+		 * @param color_tolerance Largest difference of a channel from 0 to 255 still taken as a match. The plain loops round the
+		 * colors like the kernels, so any difference is an error.
+		 * @param depth_tolerance Largest difference of the depth in the z-buffer still taken as a match.
+		 * @param tile_size Width and height in pixels of the tiles the mismatches are reported by.
+		 */
+		Cross_Check(int color_tolerance = 0, int depth_tolerance = 0, unsigned tile_size = 16);
+
+		/**
+		 * @brief Reports every image that fails as it's checked, with its mismatches and the tiles where they are.
+		 *
+		 * @param stream Where to write the reports, or null to not write them.
+		 */
+		void set_log(std::ostream* stream)
+		{
+			log = stream;
+		}
+
+		/**
+		 * @brief Writes a difference image of every image that fails: the reference in gray, with the pixels whose color didn't match
+		 * in red, the ones whose depth didn't in blue and the ones where neither did in magenta.
+		 *
+		 * @param path The start of the names of the images, which end in the number of the image of 5 digits and ".ppm", empty to not write them.
+		 */
+		void set_difference_path(const std::string& path)
+		{
+			difference_path = path;
+		}
+
+		/**
+		 * @brief Forgets the results of the last frame, before checking the views of a new one.
+		 */
+		void begin_frame()
+		{
+			results.clear();
+		}
+
+		/**
+		 * @brief Keeps the levels of detail a view of the frame starts from, before it's drawn, so its reference picks the same ones.
+		 *
+		 * @param index The position of the view among the ones of the frame.
+		 * @param view The view.
+		 */
+		void keep_lods(size_t index, const Scene_View& view);
+
+		/**
+		 * @brief Gets the reference view ready to draw a view of the frame: with its size, camera, anti-aliasing and the levels of
+		 * detail it picked, but drawn whole and without occlusion culling. There's a single reference view, so every reference
+		 * has to be compared before the next one is prepared.
+		 *
+		 * @param index The position of the view among the ones of the frame, whose levels of detail were kept.
+		 * @param view The view.
+		 * @return The reference view.
+		 */
+		Scene_View& prepare_reference(size_t index, const Scene_View& view);
+
+		/**
+		 * @brief Compares a view with its reference, both already drawn, and keeps the result.
+		 *
+		 * @param view The view drawn through the optimized paths.
+		 * @param reference The view drawn through the reference paths.
+		 * @return The result.
+		 */
+		const Cross_Check_Result& compare(const Scene_View& view, const Scene_View& reference);
+
+		/**
+		 * @brief Gets the results of the views of the last frame checked.
+		 *
+		 * @return The results, in the order of the views.
+		 */
+		const vector<Cross_Check_Result>& get_results() const
+		{
+			return results;
+		}
+
+		uint64_t get_images_checked() const
+		{
+			return images_checked;
+		}
+
+		uint64_t get_images_failed() const
+		{
+			return images_failed;
+		}
+
+		/**
+		 * @brief Writes a result in a line, followed by a line per tile with mismatches.
+		 *
+		 * @param stream Where to write it.
+		 * @param result The result.
+		 */
+		static void write_result(std::ostream& stream, const Cross_Check_Result& result);
+
+	private:
+
+		/**
+		 * @brief Writes the difference image of a failed image.
+		 *
+		 * @param result The result of the image.
+		 * @param view The view drawn through the optimized paths.
+		 * @param reference The view drawn through the reference paths.
+		 * @return False if the file couldn't be written.
+		 */
+		bool write_difference_image(const Cross_Check_Result& result, const Scene_View& view, const Scene_View& reference) const;
+	};
+}
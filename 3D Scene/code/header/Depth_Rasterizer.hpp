@@ -0,0 +1,288 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Depth_Target.hpp"
+#include "Rasterizer.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace MScenary
+{
+	/**
+	 * @brief Depth only Rasterizer, for the passes that only need the depth of what is drawn: occlusion, shadows or a depth pre-pass.
+	 *
+	 * It has no color at all. The edges of the polygons are walked like in the general Rasterizer, but the scanlines only test and
+	 * write the depth of the target, four pixels at a time. The edge caches belong to every instance and are sized to its target,
+	 * so it works at any resolution.
+	 */
+	template< >
+	class Rasterizer< Depth_Target >
+	{
+		Depth_Target& target;				///< Target whose depth is written.
+
+		std::vector< int > offset_cache0;	///< Offsets of the left edges of every scanline.
+		std::vector< int > offset_cache1;	///< Offsets of the right edges of every scanline.
+		std::vector< int > z_cache0;		///< Depth at the left edges of every scanline.
+		std::vector< int > z_cache1;		///< Depth at the right edges of every scanline.
+
+	public:
+
+		/**
+		 * @brief Creates a rasterizer that draws into the given target.
+		 *
+		 * @param target The depth target.
+		 */
+		Rasterizer(Depth_Target& target)
+			:
+			target(target),
+			offset_cache0(target.get_height() + 2),
+			offset_cache1(target.get_height() + 2),
+			z_cache0(target.get_height() + 2),
+			z_cache1(target.get_height() + 2)
+		{
+		}
+
+		const Depth_Target& get_target() const
+		{
+			return target;
+		}
+
+		/**
+		 * @brief Gets the memory of the edge caches, the target not included.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return (offset_cache0.capacity() + offset_cache1.capacity() + z_cache0.capacity() + z_cache1.capacity()) * sizeof(int);
+		}
+
+		const std::vector< int >& get_z_buffer() const
+		{
+			return target.get_buffer();
+		}
+
+		/**
+		 * @brief Sets the depth of every pixel to the farthest possible.
+		 */
+		void clear()
+		{
+			std::fill(target.get_buffer().begin(), target.get_buffer().end(), std::numeric_limits< int >::max());
+		}
+
+		/**
+		 * @brief Draws the depth of a convex polygon, keeping the nearest depth of every pixel.
+		 *
+		 * @param vertices The vertices in display coordinates, all of them inside the target.
+		 * @param indices_begin The first index of the polygon.
+		 * @param indices_end The end of the indices of the polygon.
+		 */
+		void fill_convex_polygon_z_buffer
+		(
+			const Point4i* const vertices,
+			const int* const indices_begin,
+			const int* const indices_end
+		);
+
+	private:
+
+		template< typename VALUE_TYPE, size_t SHIFT >
+		static void interpolate(int* cache, int v0, int v1, int y_min, int y_max);
+
+		/**
+		 * @brief Tests and writes the depth of a run of pixels.
+		 *
+		 * @param depth The depth of the first pixel of the run in the target.
+		 * @param count The number of pixels.
+		 * @param z The depth of the polygon at the first pixel.
+		 * @param z_step The depth increment from one pixel to the next.
+		 * @param vectorized Whether to use the vectorized kernel, simd::enabled() read once per polygon.
+		 */
+		static void fill_span(int* depth, int count, int z, int z_step, bool vectorized);
+	};
+
+	inline void Rasterizer< Depth_Target >::fill_convex_polygon_z_buffer
+	(
+		const Point4i* const vertices,
+		const int* const indices_begin,
+		const int* const indices_end
+	)
+	{
+		int  pitch = int(target.get_width());
+		int* depth = target.get_buffer().data();
+		int* offset_cache0 = this->offset_cache0.data();
+		int* offset_cache1 = this->offset_cache1.data();
+		int* z_cache0 = this->z_cache0.data();
+		int* z_cache1 = this->z_cache1.data();
+		const int* indices_back = indices_end - 1;
+
+		// Find the starting vertex (lowest y) and the ending one (highest y).
+
+		const int* start_index = indices_begin;
+		int  start_y = vertices[*start_index][1];
+		const int* end_index = indices_begin;
+		int  end_y = start_y;
+
+		for (const int* index_iterator = start_index; ++index_iterator < indices_end; )
+		{
+			int current_y = vertices[*index_iterator][1];
+
+			if (current_y < start_y)
+			{
+				start_y = current_y;
+				start_index = index_iterator;
+			}
+			else if (current_y > end_y)
+			{
+				end_y = current_y;
+				end_index = index_iterator;
+			}
+		}
+
+		// Cache the offsets and depths of the edges that go from the lowest to the highest y counterclockwise.
+
+		const int* current_index = start_index;
+		const int* next_index = start_index > indices_begin ? start_index - 1 : indices_back;
+
+		int y0 = vertices[*current_index][1];
+		int y1 = vertices[*next_index][1];
+		int z0 = vertices[*current_index][2];
+		int z1 = vertices[*next_index][2];
+		int o0 = vertices[*current_index][0] + y0 * pitch;
+		int o1 = vertices[*next_index][0] + y1 * pitch;
+
+		while (true)
+		{
+			interpolate< int64_t, 32 >(offset_cache0, o0, o1, y0, y1);
+			interpolate< int32_t, 0 >(z_cache0, z0, z1, y0, y1);
+
+			if (current_index == indices_begin) current_index = indices_back; else current_index--;
+			if (current_index == end_index) break;
+			if (next_index == indices_begin) next_index = indices_back; else next_index--;
+
+			y0 = y1;
+			y1 = vertices[*next_index][1];
+			z0 = z1;
+			z1 = vertices[*next_index][2];
+			o0 = o1;
+			o1 = vertices[*next_index][0] + y1 * pitch;
+		}
+
+		int end_offset = o1;
+
+		// And the ones that go clockwise.
+
+		current_index = start_index;
+		next_index = start_index < indices_back ? start_index + 1 : indices_begin;
+
+		y0 = vertices[*current_index][1];
+		y1 = vertices[*next_index][1];
+		z0 = vertices[*current_index][2];
+		z1 = vertices[*next_index][2];
+		o0 = vertices[*current_index][0] + y0 * pitch;
+		o1 = vertices[*next_index][0] + y1 * pitch;
+
+		while (true)
+		{
+			interpolate< int64_t, 32 >(offset_cache1, o0, o1, y0, y1);
+			interpolate< int32_t, 0 >(z_cache1, z0, z1, y0, y1);
+
+			if (current_index == indices_back) current_index = indices_begin; else current_index++;
+			if (current_index == end_index) break;
+			if (next_index == indices_back) next_index = indices_begin; else next_index++;
+
+			y0 = y1;
+			y1 = vertices[*next_index][1];
+			z0 = z1;
+			z1 = vertices[*next_index][2];
+			o0 = o1;
+			o1 = vertices[*next_index][0] + y1 * pitch;
+		}
+
+		if (o1 > end_offset) end_offset = o1;
+
+		// Fill the scanlines from the lowest to the highest y, with the same depth steps as the general Rasterizer.
+
+		const bool vectorized = simd::enabled();
+
+		for (int y = start_y; y < end_y; y++)
+		{
+			o0 = offset_cache0[y];
+			o1 = offset_cache1[y];
+			z0 = z_cache0[y];
+			z1 = z_cache1[y];
+
+			if (o0 < o1)
+			{
+				fill_span(depth + o0, o1 - o0, z0, (z1 - z0) / (o1 - o0), vectorized);
+
+				if (o1 > end_offset) break;
+			}
+			else if (o1 < o0)
+			{
+				fill_span(depth + o1, o0 - o1, z1, (z0 - z1) / (o0 - o1), vectorized);
+
+				if (o0 > end_offset) break;
+			}
+		}
+	}
+
+	template< typename VALUE_TYPE, size_t SHIFT >
+	inline void Rasterizer< Depth_Target >::interpolate(int* cache, int v0, int v1, int y_min, int y_max)
+	{
+		if (y_max > y_min)
+		{
+			VALUE_TYPE value = (VALUE_TYPE(v0) << SHIFT);
+			VALUE_TYPE step = (VALUE_TYPE(v1 - v0) << SHIFT) / (y_max - y_min);
+
+			for (int* iterator = cache + y_min, *end = cache + y_max; iterator <= end; )
+			{
+				*iterator++ = int(value >> SHIFT);
+				value += step;
+				*iterator++ = int(value >> SHIFT);
+				value += step;
+			}
+		}
+	}
+
+	inline void Rasterizer< Depth_Target >::fill_span(int* depth, int count, int z, int z_step, bool vectorized)
+	{
+		int index = 0;
+
+	#if MSCENARY_SSE2
+
+		// Writing the depth where it's nearer is keeping the minimum, done with a compare and a select since SSE2 has no 32 bit integer min.
+
+		__m128i z_values = _mm_setr_epi32(z, z + z_step, z + z_step * 2, z + z_step * 3);
+		__m128i z_steps = _mm_set1_epi32(z_step * 4);
+
+		for (; vectorized && index + 4 <= count; index += 4)
+		{
+			__m128i* pixels = reinterpret_cast<__m128i*>(depth + index);
+			__m128i  current = _mm_loadu_si128(pixels);
+			__m128i  nearer = _mm_cmplt_epi32(z_values, current);
+
+			_mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(nearer, z_values), _mm_andnot_si128(nearer, current)));
+
+			z_values = _mm_add_epi32(z_values, z_steps);
+		}
+
+		z += z_step * index;
+
+	#endif
+
+		for (; index < count; index++, z += z_step)
+		{
+			if (z < depth[index]) depth[index] = z;
+		}
+	}
+}
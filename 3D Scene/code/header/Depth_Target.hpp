@@ -0,0 +1,64 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace MScenary
+{
+	/**
+	 * @brief Render target that only has depth, for the passes that don't need any color. It's drawn with the depth only
+	 * specialization of the Rasterizer (see Depth_Rasterizer.hpp), which writes straight into its buffer.
+	 */
+	class Depth_Target
+	{
+		unsigned width;				 ///< Width of the target in pixels.
+		unsigned height;			 ///< Height of the target in pixels.
+		std::vector<int> depth;		 ///< Depth of every pixel, row after row, in the same units as the z-buffer of the Rasterizer.
+
+	public:
+
+		/**
+		 * @brief Creates a depth target of the given size.
+		 *
+		 * @param width The width in pixels.
+		 * @param height The height in pixels.
+		 */
+		Depth_Target(unsigned width, unsigned height) : width(width), height(height), depth(std::size_t(width) * height) {}
+
+		unsigned get_width() const
+		{
+			return width;
+		}
+
+		unsigned get_height() const
+		{
+			return height;
+		}
+
+		unsigned get_size() const
+		{
+			return width * height;
+		}
+
+		size_t get_allocated_bytes() const
+		{
+			return depth.capacity() * sizeof(int);
+		}
+
+		std::vector<int>& get_buffer()
+		{
+			return depth;
+		}
+
+		const std::vector<int>& get_buffer() const
+		{
+			return depth;
+		}
+	};
+}
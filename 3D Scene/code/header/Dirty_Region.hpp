@@ -0,0 +1,176 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Render_Queue.hpp"
+#include "math.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+namespace MScenary
+{
+	/**
+	 * @brief Rectangle of pixels, without the right column and the bottom row.
+	 */
+	struct Screen_Rect
+	{
+		int left = 0;
+		int top = 0;
+		int right = 0;
+		int bottom = 0;
+
+		bool is_empty() const
+		{
+			return left >= right || top >= bottom;
+		}
+
+		bool intersects(const Screen_Rect& other) const
+		{
+			return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+		}
+
+		/**
+		 * @brief Grows the rectangle to also cover another one.
+		 *
+		 * @param other The rectangle to add, ignored when empty.
+		 */
+		void merge(const Screen_Rect& other)
+		{
+			if (other.is_empty()) return;
+
+			if (is_empty())
+			{
+				*this = other;
+				return;
+			}
+
+			left = std::min(left, other.left);
+			top = std::min(top, other.top);
+			right = std::max(right, other.right);
+			bottom = std::max(bottom, other.bottom);
+		}
+	};
+
+	/**
+	 * @brief Finds the part of the screen that has to be drawn again when most of the scene stays still from one frame to the next.
+	 *
+	 * The rectangle covered by every mesh drawn is kept along with everything its pixels depend on. When a mesh comes back with any
+	 * of them changed, or stops being drawn, or is drawn for the first time, both the rectangle it covered and the one it covers now
+	 * are added to the region. Only the region is cleared and rasterized, the pixels outside keep the last frame.
+	 *
+	 * What changes the whole image, like the camera or the lights, can't be told from the meshes, so whoever sees it invalidates
+	 * the whole screen.
+	 */
+	class Dirty_Region
+	{
+		/**
+		 * @brief What a mesh was drawn with in the last frame it was drawn.
+		 */
+		struct Drawn_Mesh
+		{
+			Matrix44    transform_matrix;	///< Matrix from model coordinates to projection coordinates.
+			float       opacity;			///< Opacity it was drawn with.
+			size_t      lod;				///< Level of detail it was drawn with.
+			Screen_Rect bounds;				///< Pixels it covered.
+			uint32_t    frame;				///< Frame it was last drawn in.
+		};
+
+		std::unordered_map<const Mesh*, Drawn_Mesh> drawn_meshes;	///< Every mesh drawn in the last frame.
+
+		Screen_Rect bounds;			///< Pixels to draw in the current frame.
+		unsigned    width;			///< Width of the target.
+		unsigned    height;			///< Height of the target.
+		uint32_t    frame;			///< Counter of frames, compared against the ones the meshes were drawn in.
+		bool        full_redraw;	///< Whether the whole screen has to be drawn in the current frame.
+
+	public:
+
+		Dirty_Region();
+
+		/**
+		 * @brief Starts the region of a new frame, empty unless the size of the target has changed.
+		 *
+		 * @param width The width of the target.
+		 * @param height The height of the target.
+		 */
+		void begin_frame(unsigned width, unsigned height);
+
+		/**
+		 * @brief Gets an estimate of the memory of the meshes drawn in the last frame, the nodes and the buckets of the map.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return drawn_meshes.size() * (sizeof(std::pair<const Mesh* const, Drawn_Mesh>) + 2 * sizeof(void*)) + drawn_meshes.bucket_count() * sizeof(void*);
+		}
+
+		/**
+		 * @brief Makes the current frame draw the whole screen.
+		 */
+		void invalidate()
+		{
+			full_redraw = true;
+		}
+
+		/**
+		 * @brief Adds a mesh that is going to be drawn in the current frame, comparing it against how it was drawn in the last one.
+		 *
+		 * @param item The mesh with its matrices and opacity.
+		 */
+		void add_item(const Draw_Item& item);
+
+		/**
+		 * @brief Adds the rectangles of the meshes drawn in the last frame that aren't drawn in this one. Called after the last item.
+		 */
+		void end_frame();
+
+		/**
+		 * @brief Gets the pixels to draw in the current frame.
+		 *
+		 * @return The rectangle, empty when nothing has changed.
+		 */
+		const Screen_Rect& get_bounds() const
+		{
+			return bounds;
+		}
+
+		/**
+		 * @brief Checks whether an item added in the current frame has any pixel inside the region.
+		 *
+		 * @param item The item.
+		 * @return True if the item has to be drawn.
+		 */
+		bool intersects(const Draw_Item& item) const;
+
+		/**
+		 * @brief Finds the pixels a bounding sphere can cover, from the box around it.
+		 *
+		 * @param center Center of the sphere in model coordinates.
+		 * @param radius Radius of the sphere in model coordinates.
+		 * @param transform_matrix Matrix from model coordinates to projection coordinates.
+		 * @param width The width of the target.
+		 * @param height The height of the target.
+		 * @return The rectangle, the whole screen when the box reaches the camera plane.
+		 */
+		static Screen_Rect project_bounds(const Point3f& center, float radius, const Matrix44& transform_matrix, unsigned width, unsigned height);
+
+	private:
+
+		Screen_Rect whole_screen() const
+		{
+			Screen_Rect screen;
+
+			screen.right = int(width);
+			screen.bottom = int(height);
+
+			return screen;
+		}
+	};
+}
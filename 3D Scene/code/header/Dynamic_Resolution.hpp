@@ -0,0 +1,132 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+#include "Image_Scaler.hpp"
+
+namespace MScenary
+{
+	using argb::Rgb888;
+
+	/**
+	 * @brief Picks the resolution the scene is rendered at from the time the last frames took, so the frame rate holds when the load spikes,
+	 * and scales the rendered image up to the size of the window.
+	 *
+	 * The scale goes in sixteenths of the window size. The cost of a frame is taken as proportional to its pixels, so when the average
+	 * of the last frames goes over the budget the scale drops straight to the one expected to fit it. It only grows back one step at a
+	 * time and while there's plenty of time left, so it doesn't keep bouncing between two sizes. After every change the history starts
+	 * again, the frames rendered at the old size say nothing about the new one.
+	 */
+	class Dynamic_Resolution
+	{
+		typedef argb::Color_Buffer<Rgb888> Color_Buffer;	///< Alias for 24 bit color buffer type.
+
+		static constexpr unsigned scale_steps  = 16;	///< Steps between no size and the full size.
+		static constexpr unsigned history_size = 12;	///< Frames averaged before deciding.
+		static constexpr float    headroom     = 0.9f;	///< Fraction of the budget aimed at when dropping, so the next frames don't fall right on the limit.
+		static constexpr float    grow_margin  = 0.65f;	///< Fraction of the budget the frames have to stay under to grow a step.
+
+		unsigned full_width;		///< Width of the window.
+		unsigned full_height;		///< Height of the window.
+		unsigned min_step;			///< Smallest scale allowed, in sixteenths.
+		unsigned step;				///< Current scale, in sixteenths.
+		float    frame_budget;		///< Time a frame should take, in seconds.
+
+		float    frame_times[history_size];		///< Times of the last frames rendered at the current scale.
+		unsigned frame_count;					///< Number of frames in the history.
+
+		Image_Scaler scaler;		///< Filters the rendered image up to the window size.
+
+	public:
+
+		/**
+		 * @brief Creates the governor for a window of the given size, starting at full size.
+		 *
+		 * @param width The width of the window.
+		 * @param height The height of the window.
+		 * @param frame_budget The time a frame should take, in seconds.
+		 * @param min_scale The smallest fraction of the window size the scene can be rendered at.
+		 */
+		Dynamic_Resolution(unsigned width, unsigned height, float frame_budget = 1.f / 60.f, float min_scale = 0.5f);
+
+		/**
+		 * @brief Gets the memory of the tables and rows of the upscaling filter.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return scaler.get_allocated_bytes();
+		}
+
+		/**
+		 * @brief Adds the time of the last frame and picks the scale for the next ones.
+		 *
+		 * @param seconds The time the frame took to render.
+		 * @return True if the size to render at has changed.
+		 */
+		bool record_frame(float seconds);
+
+		/**
+		 * @brief Gets the width to render at.
+		 *
+		 * @return The width in pixels.
+		 */
+		unsigned get_width() const
+		{
+			return scale(full_width);
+		}
+
+		/**
+		 * @brief Gets the height to render at.
+		 *
+		 * @return The height in pixels.
+		 */
+		unsigned get_height() const
+		{
+			return scale(full_height);
+		}
+
+		/**
+		 * @brief Gets the current scale.
+		 *
+		 * @return The fraction of the window size rendered.
+		 */
+		float get_scale() const
+		{
+			return float(step) / float(scale_steps);
+		}
+
+		/**
+		 * @brief Changes the time a frame should take.
+		 *
+		 * @param seconds The budget in seconds.
+		 */
+		void set_frame_budget(float seconds)
+		{
+			frame_budget = seconds;
+		}
+
+		/**
+		 * @brief Scales an image up to the size of another with bilinear filtering.
+		 *
+		 * @param source The rendered image.
+		 * @param target The image shown in the window, at least as big as the source.
+		 */
+		void upscale(const Color_Buffer& source, Color_Buffer& target);
+
+	private:
+
+		unsigned scale(unsigned size) const
+		{
+			unsigned scaled = size * step / scale_steps;
+
+			return scaled > 0 ? scaled : 1;
+		}
+	};
+}
@@ -0,0 +1,192 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace MScenary
+{
+	/**
+	 * @brief Linear allocator for the scratch data of the pipeline, which only lives while a mesh is being rendered.
+	 *
+	 * Allocating just moves an offset forward, and a Scope moves it back when the render call that opened it returns, so the
+	 * memory in use at any time is the one of the mesh being rendered and not the sum of every mesh. Nothing is freed one by one
+	 * and no destructors are run, so only trivially destructible types can be allocated.
+	 *
+	 * When a render needs more than the arena has, another block is chained instead of moving the memory already handed out.
+	 * The next reset() merges the chain into a single block of the same total size, so once the biggest frame has been seen
+	 * the arena never touches the heap again.
+	 *
+	 * Every thread has its own arena, returned by local(), unless a Binding hands it another one for a while.
+	 */
+	class Frame_Arena
+	{
+	public:
+
+		/**
+		 * @brief Position of the arena, to go back to it later.
+		 */
+		struct Marker
+		{
+			size_t block;	///< Block in use.
+			size_t offset;	///< Bytes used in that block.
+		};
+
+		/**
+		 * @brief Gives back everything allocated from an arena during its lifetime when it goes out of scope.
+		 */
+		class Scope
+		{
+			Frame_Arena& arena;		///< Arena the allocations come from.
+			Marker       marker;	///< Position of the arena when the scope was opened.
+
+		public:
+
+			explicit Scope(Frame_Arena& arena)
+				:
+				arena(arena),
+				marker(arena.get_marker())
+			{
+			}
+
+			~Scope()
+			{
+				arena.release(marker);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator = (const Scope&) = delete;
+		};
+
+		/**
+		 * @brief Makes local() return another arena on the calling thread while it is in scope. Work that runs on a different thread
+		 * every frame keeps the memory it grew into this way, instead of starting again from the empty arena of a new thread.
+		 */
+		class Binding
+		{
+			Frame_Arena* previous;	///< Arena bound before, bound again when the binding goes out of scope.
+
+		public:
+
+			explicit Binding(Frame_Arena& arena);
+
+			~Binding();
+
+			Binding(const Binding&) = delete;
+			Binding& operator = (const Binding&) = delete;
+		};
+
+	private:
+
+		static constexpr size_t alignment      = 16;		///< Least alignment of every allocation, enough for the SSE loads.
+		static constexpr size_t min_block_size = 1 << 20;	///< Size of the first block, and the least size of the chained ones.
+
+		/**
+		 * @brief Chunk of memory the allocations are taken from.
+		 */
+		struct Block
+		{
+			std::unique_ptr<uint8_t[]> memory;	///< The memory.
+			size_t                     size;	///< Size of the memory in bytes.
+			size_t                     start;	///< Bytes in all the blocks before this one.
+		};
+
+		std::vector<Block> blocks;			///< Chain of blocks, a single one in the steady state.
+		size_t             current_block;	///< Block the next allocation is taken from.
+		size_t             offset;			///< Bytes used in the current block.
+		size_t             high_water;		///< Most bytes ever in use at once, padding included.
+
+	public:
+
+		Frame_Arena();
+
+		Frame_Arena(const Frame_Arena&) = delete;
+		Frame_Arena& operator = (const Frame_Arena&) = delete;
+
+		/**
+		 * @brief Gets the arena of the calling thread, the bound one if there is any.
+		 *
+		 * @return The arena.
+		 */
+		static Frame_Arena& local();
+
+		/**
+		 * @brief Allocates room for some objects, without constructing them.
+		 *
+		 * @param count The number of objects.
+		 * @return The first object, aligned to at least 16 bytes.
+		 */
+		template< typename TYPE >
+		TYPE* allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible< TYPE >::value, "The arena never runs destructors");
+
+			return static_cast<TYPE*>(allocate_bytes(count * sizeof(TYPE), alignof(TYPE) > alignment ? alignof(TYPE) : alignment));
+		}
+
+		/**
+		 * @brief Gets the current position of the arena.
+		 *
+		 * @return The marker to release back to.
+		 */
+		Marker get_marker() const
+		{
+			return { current_block, offset };
+		}
+
+		/**
+		 * @brief Gives back everything allocated after a marker was taken.
+		 *
+		 * @param marker The marker.
+		 */
+		void release(const Marker& marker)
+		{
+			current_block = marker.block;
+			offset = marker.offset;
+		}
+
+		/**
+		 * @brief Gives back everything at the start of a frame, merging the blocks chained during the last one.
+		 */
+		void reset();
+
+		/**
+		 * @brief Gets the memory owned by the arena.
+		 *
+		 * @return The size of all the blocks in bytes.
+		 */
+		size_t get_capacity() const
+		{
+			return blocks.empty() ? 0 : blocks.back().start + blocks.back().size;
+		}
+
+		/**
+		 * @brief Gets the most memory ever in use at once.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_high_water() const
+		{
+			return high_water;
+		}
+
+	private:
+
+		/**
+		 * @brief Takes the next aligned bytes of the current block, moving on to the next one, or chaining a new one, when they don't fit.
+		 *
+		 * @param size The number of bytes.
+		 * @param align The alignment, a power of two.
+		 * @return The first byte.
+		 */
+		void* allocate_bytes(size_t size, size_t align);
+	};
+}
@@ -0,0 +1,146 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace MScenary
+{
+	using argb::Rgb888;
+
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The indices of the ring are shared with other processes, they can't hide a lock");
+
+	/**
+	 * @brief Start of the shared memory of a Frame_Ring, the only part other processes need to know to read the frames.
+	 *
+	 * It's followed by slot_count Frame_Ring_Slot, and the pixels of the slots start at slot_offset bytes from the header,
+	 * one slot every slot_size bytes. The pixels are rows of width Rgb888, three bytes in R, G, B order, top row first.
+	 *
+	 * The indices only grow. The frames from read_index to write_index are ready, the next one is in the slot
+	 * read_index % slot_count. A reader loads write_index with acquire order, reads the frame in place, and then stores
+	 * read_index + 1 with release order to give the slot back. There's a single reader and a single writer.
+	 */
+	struct Frame_Ring_Header
+	{
+		static constexpr uint32_t magic_value = 0x5246534D;	///< "MSFR" in little endian.
+		static constexpr uint32_t version_value = 1;		///< Version of the layout.
+
+		uint32_t magic;			///< Always magic_value, written last when the ring is created.
+		uint32_t version;		///< Always version_value.
+		uint32_t slot_count;	///< Number of frames in the ring.
+		uint32_t width;			///< Width of the frames.
+		uint32_t height;		///< Height of the frames.
+		uint32_t stride;		///< Bytes from a row of a frame to the next one.
+		uint64_t slot_offset;	///< Bytes from the header to the pixels of the first slot.
+		uint64_t slot_size;		///< Bytes from the pixels of a slot to the ones of the next one.
+
+		alignas(64) std::atomic<uint64_t> write_index;		///< Frames published by the renderer, only written by it.
+		alignas(64) std::atomic<uint64_t> read_index;		///< Frames given back by the reader, only written by it.
+		alignas(64) std::atomic<uint64_t> dropped_frames;	///< Frames the renderer couldn't publish because the ring was full.
+	};
+
+	/**
+	 * @brief Metadata of the frame in a slot, valid from the moment its index is published until the reader gives it back.
+	 */
+	struct Frame_Ring_Slot
+	{
+		uint64_t frame_number;	///< Number of the frame since the ring was created, the missing numbers are the dropped frames.
+		uint64_t timestamp;		///< Time the frame was published, in nanoseconds of a monotonic clock.
+	};
+
+	/**
+	 * @brief Ring of frames in shared memory, so other processes on the same machine, like encoders or viewers, can take the
+	 * frames of the renderer without any copy.
+	 *
+	 * The frame is rendered straight into a slot: acquire_slot() returns the memory of the next free slot, the color buffer
+	 * is pointed to it, and publish() makes the frame visible once it's finished. If the reader falls behind and every slot
+	 * is still in use, the frame is dropped from the ring and the renderer doesn't wait.
+	 *
+	 * It's a POSIX shared memory object, or a named file mapping on Windows, removed when the ring is destroyed.
+	 */
+	class Frame_Ring
+	{
+		Frame_Ring_Header* header;		///< Start of the mapped memory, null if the ring couldn't be created.
+		Frame_Ring_Slot*   slots;		///< Metadata of the slots, right after the header.
+		uint8_t*           pixels;		///< Pixels of the first slot.
+		size_t             mapped_size;	///< Size of the mapping in bytes.
+		std::string        name;		///< Name of the shared memory object.
+		uint64_t           frame_number;	///< Frames offered to the ring, published or dropped.
+		bool               acquired;	///< Whether a slot has been acquired and not published yet.
+
+		#ifdef _WIN32
+		void*              mapping;		///< Handle of the file mapping.
+		#else
+		int                descriptor;	///< Descriptor of the shared memory object.
+		#endif
+
+	public:
+
+		/**
+		 * @brief Creates the shared memory of a ring, replacing any with the same name.
+		 *
+		 * @param name The name of the shared memory, starting with a slash like "/mscenary_frames". On Windows it's a local
+		 * name without the slash.
+		 * @param width The width of the frames.
+		 * @param height The height of the frames.
+		 * @param slot_count The number of frames in the ring, 3 lets a reader take one while the next one is being rendered.
+		 */
+		Frame_Ring(const std::string& name, unsigned width, unsigned height, unsigned slot_count = 3);
+
+		/**
+		 * @brief Unmaps and removes the shared memory. The readers that still have it mapped can go on reading it.
+		 */
+		~Frame_Ring();
+
+		Frame_Ring(const Frame_Ring&) = delete;
+		Frame_Ring& operator = (const Frame_Ring&) = delete;
+
+		/**
+		 * @brief Checks whether the shared memory could be created and mapped.
+		 *
+		 * @return False if the ring can't be used.
+		 */
+		bool is_open() const
+		{
+			return header != nullptr;
+		}
+
+		unsigned get_width() const
+		{
+			return header ? header->width : 0;
+		}
+
+		unsigned get_height() const
+		{
+			return header ? header->height : 0;
+		}
+
+		/**
+		 * @brief Takes the next free slot to render a frame into.
+		 *
+		 * @return The pixels of the slot, or null if the reader still has every slot and the frame has to be dropped.
+		 */
+		Rgb888* acquire_slot();
+
+		/**
+		 * @brief Makes the frame rendered into the acquired slot visible to the reader.
+		 */
+		void publish();
+
+	private:
+
+		/**
+		 * @brief Unmaps and closes whatever was created.
+		 */
+		void close();
+	};
+}
@@ -0,0 +1,71 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Post_Process.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Fast approximate anti-aliasing: softens the edges found in the finished image, a much cheaper alternative to supersampling.
+	 *
+	 * The luma of the image is compared against its four neighbours sixteen pixels at a time, and only the pixels with enough contrast
+	 * go on to find the direction of their edge, walk along it to its ends and blend with the neighbour across it.
+	 */
+	class Fxaa : public Post_Process
+	{
+		static constexpr unsigned search_steps = 8;		///< Pixels walked in each direction looking for the ends of an edge.
+
+		vector<uint8_t> luma;		///< Luma of every pixel of the image being processed.
+		vector<Rgb888>  source;		///< Copy of the image being processed, read while the result is written.
+
+		uint8_t contrast_threshold;			///< Smallest contrast with the neighbours that is taken as an edge.
+		uint8_t relative_shift;				///< The contrast also has to reach the brightest neighbour shifted right by this many bits.
+		float   subpixel_quality;			///< How much the pixels thinner than an edge are blended, from 0 to 1.
+
+	public:
+
+		/**
+		 * @brief Creates the pass with the usual settings of the quality presets.
+		 *
+		 * @param contrast_threshold Smallest contrast in luma, from 0 to 255, that is taken as an edge.
+		 * @param subpixel_quality How much the details thinner than a pixel are blended, from 0 to 1.
+		 */
+		Fxaa(uint8_t contrast_threshold = 16, float subpixel_quality = 0.75f);
+
+		void apply(Color_Buffer& color_buffer) override;
+
+		size_t get_allocated_bytes() const override
+		{
+			return luma.capacity() * sizeof(uint8_t) + source.capacity() * sizeof(Rgb888);
+		}
+
+	private:
+
+		/**
+		 * @brief Finds the edges of a band of rows and blends the pixels on them.
+		 *
+		 * @param color_buffer The image written to.
+		 * @param first_row The first row of the band.
+		 * @param end_row The end of the band.
+		 */
+		void process_band(Color_Buffer& color_buffer, unsigned first_row, unsigned end_row) const;
+
+		/**
+		 * @brief Blends a pixel with enough contrast along its edge.
+		 *
+		 * @param color_buffer The image written to.
+		 * @param x, y The pixel.
+		 */
+		void process_pixel(Color_Buffer& color_buffer, unsigned x, unsigned y) const;
+	};
+}
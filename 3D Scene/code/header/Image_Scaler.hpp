@@ -0,0 +1,99 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+#include "Dirty_Region.hpp"
+#include "Memory_Report.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+	using argb::Rgb888;
+
+	/**
+	 * @brief How an image is sampled when it's scaled.
+	 */
+	enum Scale_Filter
+	{
+		NEAREST_FILTER,		///< Every pixel takes the source pixel under its center, sharp but blocky.
+		BILINEAR_FILTER,	///< Every pixel blends the 4 source pixels around its center.
+	};
+
+	/**
+	 * @brief Copies images into a rectangle of another one scaled to its size, like the frames of several views into the tiles of a
+	 * mosaic, or a view into a corner of another one.
+	 *
+	 * Which source pixels every column takes depends only on the widths, so the tables are kept while the rectangles keep their
+	 * width and the part of them inside the target. With bilinear filtering every source row is filtered horizontally only once
+	 * and kept while the target rows need it, then every target row blends two of them eight channels at a time.
+	 */
+	class Image_Scaler
+	{
+		typedef argb::Color_Buffer<Rgb888> Color_Buffer;	///< Alias for 24 bit color buffer type.
+
+		vector<uint32_t> column_offsets;	///< Byte offset in the source row of the left pixel of every column drawn, and of the right one after it.
+		vector<int16_t>  column_weights;	///< Weight of the right pixel of every column drawn, from 0 to 128.
+		vector<int16_t>  filtered_rows[2];	///< Source rows already filtered horizontally to the columns drawn.
+		int              filtered_sources[2];	///< Source row held by every filtered row, -1 when none.
+		unsigned         table_source;		///< Source width the column tables were built for.
+		unsigned         table_width;		///< Width of the rectangle the column tables were built for.
+		unsigned         table_begin;		///< First column drawn the tables were built for, from the left of the rectangle.
+		unsigned         table_end;			///< Column after the last one drawn the tables were built for.
+		Scale_Filter     table_filter;		///< Filter the tables were built for.
+
+	public:
+
+		Image_Scaler();
+
+		/**
+		 * @brief Gets the memory of the tables and rows of the filter.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(column_offsets) + MScenary::get_allocated_bytes(column_weights)
+				+ MScenary::get_allocated_bytes(filtered_rows[0]) + MScenary::get_allocated_bytes(filtered_rows[1]);
+		}
+
+		/**
+		 * @brief Copies an image into a rectangle of another one, scaled to its size. Whatever falls outside the target is left out.
+		 * At the same size the rows are copied as they are, like Color_Buffer::blit().
+		 *
+		 * @param source The image.
+		 * @param target The image it's copied into.
+		 * @param destination The rectangle of the target it fills, which can go past its sides.
+		 * @param filter How the source is sampled.
+		 */
+		void blit(const Color_Buffer& source, Color_Buffer& target, const Screen_Rect& destination, Scale_Filter filter = BILINEAR_FILTER);
+
+	private:
+
+		/**
+		 * @brief Builds the tables of the source pixels of the columns drawn, unless they're already built for them.
+		 *
+		 * @param source_width The width of the source.
+		 * @param width The width of the rectangle.
+		 * @param begin The first column drawn, from the left of the rectangle.
+		 * @param end The column after the last one drawn.
+		 * @param filter The filter.
+		 */
+		void build_columns(unsigned source_width, unsigned width, unsigned begin, unsigned end, Scale_Filter filter);
+
+		/**
+		 * @brief Filters a source row horizontally to the columns drawn.
+		 *
+		 * @param source The first byte of the source row.
+		 * @param filtered Where the filtered channels are written.
+		 */
+		void filter_row(const uint8_t* source, int16_t* filtered) const;
+	};
+}
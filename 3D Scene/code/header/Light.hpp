@@ -7,16 +7,47 @@
 #pragma once
 
 #include "Node.hpp"
+#include "Shadow_Map.hpp"
+
+#include <memory>
 
 namespace MScenary
 {
 	/**
-	 * @brief Represents a light source in the scene.
+	 * @brief Represents a light source in the scene. It can be a point light, that reaches up to a given range from its
+	 * position (or everything if the range is 0), or a directional light that reaches everything from the same direction.
 	 */
 	class Light : public Node
 	{
+	public:
+
+		/**
+		 * @brief Kinds of light.
+		 */
+		enum Type
+		{
+			POINT,
+			DIRECTIONAL,
+		};
+
+	private:
+
+		Type  type;				 ///< Kind of light.
 		float intensity;		 ///< The diffuse intensity of the light, based on the Fong model.
 		float ambient_intensity; ///< The minimum intensity a color is going to get if their normals dont face the light.
+		float range;			 ///< Distance at which a point light fades out completely, 0 for no limit.
+
+		Vector3f direction;		 ///< Direction the light travels in for directional lights, in world coords.
+
+		Vector3f world_position; ///< Position of the light in scene coords, updated by update_world_position() and apply_view_transform().
+		Vector3f view_position;	 ///< Position of the light in camera coords, updated by apply_view_transform().
+		Vector3f view_direction; ///< Direction of the light in camera coords, updated by apply_view_transform().
+
+		bool  animated;			  ///< Whether update() moves the light up and down.
+		float movement_aux;		  ///< Current height of the up and down movement.
+		int   movement_direction; ///< Direction of the up and down movement.
+
+		std::unique_ptr<Shadow_Map> shadow_map; ///< Depth of the shadow casters seen from the light, null if the light casts no shadows.
 
 	public:
 
@@ -26,33 +57,177 @@ namespace MScenary
 		 * @param given_scene Pointer to the parent scene.
 		 * @param given_intensity The intensity of the light.
 		 * @param given_ambient_light The ambient intensity of the light (default is 0.2f).
+		 * @param given_type The kind of light (default is a point light).
+		 * @param given_range The range of a point light, 0 for no limit (default is 0).
 		 */
-		Light(Scene* given_scene, float given_intensity, float given_ambient_light = 0.2f)
+		Light(Scene* given_scene, float given_intensity, float given_ambient_light = 0.2f, Type given_type = POINT, float given_range = 0.f)
 			:
+			Node(given_scene),
+			type(given_type),
 			intensity(given_intensity),
 			ambient_intensity(given_ambient_light),
-			Node(given_scene)
+			range(given_range),
+			direction(0.f, 1.f, 0.f),
+			world_position(0.f),
+			view_position(0.f),
+			view_direction(0.f, 1.f, 0.f),
+			animated(false),
+			movement_aux(0.f),
+			movement_direction(1)
 		{}
 
 		/**
-		 * @brief Moves the light up and down in a ping-pong movement, just for debug/visual purpouses.
+		 * @brief Moves the light up and down in a ping-pong movement if it's animated, just for debug/visual purpouses.
 		 */
 		void update() override;
 
 		/**
-		 * @brief Applies a view transform to the light.
+		 * @brief Enables or disables the up and down movement of update().
+		 *
+		 * @param state True to move the light every update.
+		 */
+		void set_animated(bool state)
+		{
+			animated = state;
+		}
+
+		/**
+		 * @brief Takes the position and direction of the light to camera coords, where the lighting is calculated.
 		 *
 		 * @param view_matrix The view matrix to apply.
 		 */
 		void apply_view_transform(const Matrix44& view_matrix);
 
 		/**
-		 * @brief Calculates the intensity of the light at a given point with a given normal based on the Lambert model, using the dot product between the position and the normal vector
+		 * @brief Takes the position of the light from the world matrix of the frame. Unlike apply_view_transform(), nothing of a
+		 * camera is stored in the light, every view gets its coords from calculate_view_position() and calculate_view_direction().
+		 */
+		void update_world_position()
+		{
+			world_position = Vector3f(world_matrix[3]);
+		}
+
+		/**
+		 * @brief Calculates the position of the light in the coords of a camera.
+		 *
+		 * @param view_matrix The view matrix of the camera.
+		 * @return The position in camera coords.
+		 */
+		Vector3f calculate_view_position(const Matrix44& view_matrix) const
+		{
+			return Vector3f(view_matrix * Vector4f(world_position, 1.f));
+		}
+
+		/**
+		 * @brief Calculates the direction of the light in the coords of a camera.
+		 *
+		 * @param view_matrix The view matrix of the camera.
+		 * @return The normalized direction in camera coords.
+		 */
+		Vector3f calculate_view_direction(const Matrix44& view_matrix) const
+		{
+			return glm::normalize(Vector3f(view_matrix * Vector4f(direction, 0.f)));
+		}
+
+		/**
+		 * @brief Calculates the intensity this light adds at a given point with a given normal based on the Lambert model, using the dot
+		 * product between the direction to the light and the normal vector, faded out towards the end of the range.
+		 *
+		 * @param point The point at which to calculate the light intensity, in camera coords.
+		 * @param normal The normal vector at the point, in camera coords.
+		 * @return The diffuse intensity the vertex is going to receive from this light, without the ambient intensity.
+		 */
+		float calculate_light_intensity(const Vector3f& point, const Vector3f& normal) const;
+
+		/**
+		 * @brief Sets the direction a directional light travels in.
+		 *
+		 * @param x, y, z The direction in world coords, it doesn't need to be normalized.
+		 */
+		void set_direction(float x, float y, float z)
+		{
+			direction = glm::normalize(Vector3f(x, y, z));
+		}
+
+		/**
+		 * @brief Makes the light cast shadows, from the meshes of the models set as shadow casters.
 		 *
-		 * @param point The point at which to calculate the light intensity.
-		 * @param normal The normal vector at the point.
-		 * @return The final light intensity the normal of the vertex is going to receive.
+		 * @param resolution The width and height of the shadow map in texels.
 		 */
-		float calculate_light_intensity(const Vector3f& point, const Vector3f& normal);
+		void enable_shadows(unsigned resolution = 512)
+		{
+			shadow_map.reset(new Shadow_Map(resolution));
+		}
+
+		/**
+		 * @brief Gets the shadow map of the light.
+		 *
+		 * @return Pointer to the shadow map, null if the light casts no shadows.
+		 */
+		Shadow_Map* get_shadow_map() const
+		{
+			return shadow_map.get();
+		}
+
+		/**
+		 * @brief Adds the memory of the light to a report, with its shadow map as a render target.
+		 *
+		 * @param report The report.
+		 * @param name The name the light is listed with.
+		 */
+		void report_memory(Memory_Report& report, const std::string& name) const override
+		{
+			report.add(name, sizeof(Light) + sizeof(Transform), shadow_map ? sizeof(Shadow_Map) + shadow_map->get_allocated_bytes() : 0);
+		}
+
+		Type get_type() const
+		{
+			return type;
+		}
+
+		float get_intensity() const
+		{
+			return intensity;
+		}
+
+		float get_ambient_intensity() const
+		{
+			return ambient_intensity;
+		}
+
+		float get_range() const
+		{
+			return range;
+		}
+
+		/**
+		 * @brief Checks whether the light reaches everything in the scene, in which case it can't be culled.
+		 *
+		 * @return True for directional lights and point lights without range.
+		 */
+		bool is_unbounded() const
+		{
+			return type == DIRECTIONAL || range <= 0.f;
+		}
+
+		const Vector3f& get_direction() const
+		{
+			return direction;
+		}
+
+		const Vector3f& get_world_position() const
+		{
+			return world_position;
+		}
+
+		const Vector3f& get_view_position() const
+		{
+			return view_position;
+		}
+
+		const Vector3f& get_view_direction() const
+		{
+			return view_direction;
+		}
 	};
-}
\ No newline at end of file
+}
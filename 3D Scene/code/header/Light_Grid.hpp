@@ -0,0 +1,183 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "math.hpp"
+#include "Memory_Report.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	class Light;
+	class Shadow_Map;
+
+	/**
+	 * @brief Splits the screen in square tiles and keeps, for every tile, the lights that can reach something drawn in it,
+	 * so every vertex only evaluates the lights of the tile it lands on instead of every light in the scene.
+	 *
+	 * It's rebuilt every frame for every camera, taking the lights to its coords. Point lights with a range are added to the tiles
+	 * covered by the projection of their sphere, directional lights and point lights without range to every tile.
+	 * The lights of every tile are stored in packs of four with one array per component, so a vertex is lit by four
+	 * lights at once. The lights with a shadow map scale what they add by the visibility of the vertex, looked up
+	 * beforehand for every shadowed light.
+	 */
+	class Light_Grid
+	{
+	public:
+
+		static constexpr unsigned tile_size = 32;	///< Width and height of a tile in pixels.
+
+		/**
+		 * @brief Four lights with their components split, ready to be loaded in SIMD registers.
+		 * The unused lanes of the last pack of a tile have no intensity.
+		 */
+		struct alignas(16) Light_Pack
+		{
+			float x[4];						 ///< Position of point lights or direction towards directional lights, in camera coords.
+			float y[4];
+			float z[4];
+			float point[4];					 ///< 1 for point lights and 0 for directional lights, whose direction doesn't depend on the vertex.
+			float intensity[4];				 ///< Diffuse intensity.
+			float inverse_range_squared[4];	 ///< 1 / range^2, 0 for lights without range.
+			int32_t shadow[4];				 ///< Index of the shadow map of the light, -1 for lights without shadows.
+		};
+
+	private:
+
+		unsigned columns;			///< Number of tiles across.
+		unsigned rows;				///< Number of tiles down.
+		float    ambient_intensity;	///< Intensity every vertex gets, the highest ambient intensity of the lights.
+
+		vector<Light_Pack> packs;				///< Packs of every tile, one tile after another.
+		vector<uint32_t>   tile_offsets;		///< First pack of every tile, with an extra one at the end.
+		vector<uint32_t>   tile_light_counts;	///< Lights added to every tile while building.
+		vector<unsigned>   light_bounds;		///< First and last column and row of the tiles every light reaches, while building.
+		vector<const Shadow_Map*> shadow_maps;	///< Shadow maps of the lights that reach any tile.
+		vector<Matrix44>   shadow_lookups;		///< Matrix from camera coords to every shadow map.
+		vector<Vector3f>   light_positions;		///< Position of point lights or direction towards directional lights in camera coords, while building.
+
+	public:
+
+		Light_Grid() : columns(0), rows(0), ambient_intensity(0.f) {}
+
+		/**
+		 * @brief Assigns the lights to the tiles for a new frame.
+		 *
+		 * @param lights The lights of the scene, with their world position already updated.
+		 * @param view_matrix The view matrix of the camera.
+		 * @param projection_matrix The projection matrix of the camera, already multiplied by the view matrix.
+		 * @param width The width of the target in pixels.
+		 * @param height The height of the target in pixels.
+		 */
+		void build(const vector<Light*>& lights, const Matrix44& view_matrix, const Matrix44& projection_matrix, unsigned width, unsigned height);
+
+		/**
+		 * @brief Gets the tile a display position falls on. Positions out of the screen get the nearest tile, which still
+		 * holds every light that reaches them.
+		 *
+		 * @param x, y The display position.
+		 * @return The index of the tile.
+		 */
+		uint32_t get_tile(int x, int y) const
+		{
+			int column = x < 0 ? 0 : x / int(tile_size);
+			int row = y < 0 ? 0 : y / int(tile_size);
+
+			if (column >= int(columns)) column = int(columns) - 1;
+			if (row >= int(rows)) row = int(rows) - 1;
+
+			return uint32_t(row) * columns + uint32_t(column);
+		}
+
+		/**
+		 * @brief Gets the number of lights that reach a tile.
+		 *
+		 * @param tile The index of the tile.
+		 * @return The number of lights.
+		 */
+		uint32_t get_light_count(uint32_t tile) const
+		{
+			return tile_light_counts[tile];
+		}
+
+		/**
+		 * @brief Gets the memory of the tiles and of the lists used while building them.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(packs) + MScenary::get_allocated_bytes(tile_offsets) + MScenary::get_allocated_bytes(tile_light_counts)
+				+ MScenary::get_allocated_bytes(light_bounds) + MScenary::get_allocated_bytes(shadow_maps) + MScenary::get_allocated_bytes(shadow_lookups)
+				+ MScenary::get_allocated_bytes(light_positions);
+		}
+
+		/**
+		 * @brief Gets the number of shadow maps used by the lights of the frame.
+		 *
+		 * @return The number of shadow maps.
+		 */
+		size_t get_shadow_map_count() const
+		{
+			return shadow_maps.size();
+		}
+
+		/**
+		 * @brief Looks up a batch of points in every shadow map, with every component in its own array.
+		 *
+		 * @param x, y, z Components of the points in camera coords.
+		 * @param visibility Where the visibility is written, count values per shadow map one map after another.
+		 * @param count Number of points.
+		 */
+		void calculate_shadow_visibility(const float* x, const float* y, const float* z, float* visibility, size_t count) const;
+
+		/**
+		 * @brief Calculates the intensity of the light at a batch of points, with every component in its own array.
+		 * It's the ambient intensity plus what every light of the tile of the point adds, clamped to 1.
+		 *
+		 * @param tiles Tile every point falls on.
+		 * @param x, y, z Components of the points in camera coords.
+		 * @param normal_x, normal_y, normal_z Components of the normals at the points in camera coords.
+		 * @param visibility Visibility of the points in every shadow map, as written by calculate_shadow_visibility().
+		 * @param intensities Where the intensity of every point is written.
+		 * @param count Number of points.
+		 */
+		void calculate_light_intensities
+		(
+			const uint32_t* tiles,
+			const float* x,
+			const float* y,
+			const float* z,
+			const float* normal_x,
+			const float* normal_y,
+			const float* normal_z,
+			const float* visibility,
+			float* intensities,
+			size_t count
+		) const;
+
+	private:
+
+		/**
+		 * @brief Finds the tiles covered by the sphere of a point light.
+		 *
+		 * @param center The position of the light in scene coords.
+		 * @param depth The z of the light in camera coords.
+		 * @param radius The range of the light.
+		 * @param projection_matrix The projection matrix of the camera, already multiplied by the view matrix.
+		 * @param width The width of the target in pixels.
+		 * @param height The height of the target in pixels.
+		 * @param bounds Where the first and last column and row are written.
+		 * @return False if the sphere can't be seen at all.
+		 */
+		bool get_tile_bounds(const Vector3f& center, float depth, float radius, const Matrix44& projection_matrix, unsigned width, unsigned height, unsigned bounds[4]) const;
+	};
+}
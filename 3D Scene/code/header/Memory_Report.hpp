@@ -0,0 +1,136 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Gets the heap memory of a vector, what it has reserved and not only what it uses.
+	 *
+	 * @param buffer The vector.
+	 * @return The size in bytes.
+	 */
+	template< typename TYPE >
+	size_t get_allocated_bytes(const vector<TYPE>& buffer)
+	{
+		return buffer.capacity() * sizeof(TYPE);
+	}
+
+	/**
+	 * @brief Breakdown of the memory of a scene, a tree of named entries that can be dumped as a table.
+	 *
+	 * Every entry splits its bytes in three:
+	 *   - Source: what the scene is made of and lives as long as it, like the vertices of the meshes.
+	 *   - Transient: what the frames are drawn with and is only sized by the resolution and the load, like the render targets.
+	 *   - Scratch: what a mesh takes from the frame arena of a view while it's being drawn. The arenas are counted once as transient
+	 *     in their views, so the scratch of the meshes is left out of the totals, it only tells which mesh decides the size of the arenas.
+	 */
+	class Memory_Report
+	{
+	public:
+
+		/**
+		 * @brief Line of the report, a group whose bytes are the sum of the entries inside or a single part of the scene.
+		 */
+		struct Entry
+		{
+			std::string name;				///< What the bytes belong to.
+			unsigned    depth;				///< Number of groups the entry is in.
+			size_t      source_bytes;		///< Bytes of the data the scene is made of.
+			size_t      transient_bytes;	///< Bytes of the targets and buffers the frames are drawn with.
+			size_t      scratch_bytes;		///< Bytes taken from the frame arenas while drawing, not added to the totals.
+		};
+
+	private:
+
+		vector<Entry>  entries;				///< Every entry in the order it was added.
+		vector<size_t> open_groups;			///< Groups the next entries are added to, the innermost last.
+		size_t         peak_bytes;			///< Largest total of every report of the scene so far.
+		size_t         peak_resident_bytes;	///< Largest resident memory of the process so far, 0 if the system doesn't tell.
+
+	public:
+
+		Memory_Report() : peak_bytes(0), peak_resident_bytes(0) {}
+
+		/**
+		 * @brief Starts a group, every entry added until the matching end_group() is inside it and adds to it.
+		 *
+		 * @param name The name of the group.
+		 */
+		void begin_group(const std::string& name);
+
+		/**
+		 * @brief Closes the last group started.
+		 */
+		void end_group();
+
+		/**
+		 * @brief Adds an entry to the groups open.
+		 *
+		 * @param name What the bytes belong to.
+		 * @param source_bytes Bytes of the data the scene is made of.
+		 * @param transient_bytes Bytes of the targets and buffers the frames are drawn with.
+		 * @param scratch_bytes Bytes taken from the frame arenas while drawing.
+		 */
+		void add(const std::string& name, size_t source_bytes, size_t transient_bytes = 0, size_t scratch_bytes = 0);
+
+		const vector<Entry>& get_entries() const
+		{
+			return entries;
+		}
+
+		/**
+		 * @brief Gets the bytes of all the entries outside of any group, the scratch left out.
+		 *
+		 * @return The total in bytes.
+		 */
+		size_t get_total_bytes() const;
+
+		size_t get_peak_bytes() const
+		{
+			return peak_bytes;
+		}
+
+		size_t get_peak_resident_bytes() const
+		{
+			return peak_resident_bytes;
+		}
+
+		/**
+		 * @brief Sets the peaks, kept by whoever builds the reports since a single one only sees a moment.
+		 *
+		 * @param bytes The largest total reported so far.
+		 * @param resident_bytes The largest resident memory of the process so far.
+		 */
+		void set_peaks(size_t bytes, size_t resident_bytes)
+		{
+			peak_bytes = bytes;
+			peak_resident_bytes = resident_bytes;
+		}
+
+		/**
+		 * @brief Writes the report as a table, with the groups indented and the totals and peaks at the end.
+		 *
+		 * @param stream Where to write it.
+		 */
+		void dump(std::ostream& stream) const;
+
+		/**
+		 * @brief Asks the system for the largest resident memory the process has had, the number an instance has to be sized for.
+		 *
+		 * @return The peak in bytes, or 0 if the system doesn't tell.
+		 */
+		static size_t query_peak_resident_bytes();
+	};
+}
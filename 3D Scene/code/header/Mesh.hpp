@@ -8,6 +8,10 @@
 
 #include "Rasterizer.hpp"
 #include "Color_Buffer.hpp"
+#include "Depth_Rasterizer.hpp"
+#include "Meshlet.hpp"
+#include "Multisample_Buffer.hpp"
+#include "Transparency_Buffer.hpp"
 
 #include <cstdlib>
 #include <vector>
@@ -19,7 +23,7 @@ namespace MScenary
 	using argb::Rgb888;
 	using argb::Color_Buffer;
 
-	class Light;
+	class Light_Grid;
 
 	/**
 	 * @brief Represents a mesh object.
@@ -39,16 +43,66 @@ namespace MScenary
 		typedef vector<int>           Index_Buffer;	 ///< Type alias for index buffer.
 		typedef vector<Color>         Vertex_Colors; ///< Type alias for vertex colors.
 
-		vector<Point4f>     original_normals;		 ///< Original normals of the given mesh.
-		Vertex_Buffer       original_vertices;		 ///< Original vertices of the given mesh.
-		Index_Buffer        original_indices;		 ///< Original indices of the given mesh.
-		Vertex_Colors       original_colors;		 ///< Original colors of the given mesh.
-		Vertex_Colors       transformed_colors;		 ///< New colors of the mesh based with lightning operations applied.
-		Vertex_Buffer       transformed_vertices;	 ///< New vertices positions in projection coordinates.
-		vector<Point4i>     display_vertices;		 ///< New vertices positions in display coordinates.
+		static constexpr size_t max_lod_levels    = 4;		///< Maximum number of levels in the LOD chain, the full mesh included.
+		static constexpr size_t min_lod_triangles = 64;		///< Levels with fewer triangles than this are not simplified any further.
+		static constexpr float  lod_base_radius   = 240.f;	///< Projected radius in pixels below which the first simplified level is used, every next level halves it.
+		static constexpr float  lod_hysteresis    = 0.15f;	///< Fraction of the switch radius the projected size has to cross before changing level, so it doesn't flicker.
 
-		Matrix44 render_transformation; ///< Display transformation matrix.
-		bool render_matrix_calculated; ///< Flag indicating whether render matrix is calculated so we only have to calculate it once.
+		/**
+		 * @brief Position of a vertex in compact storage, 16 bits per axis across the bounding box of the mesh.
+		 */
+		struct Quantized_Position
+		{
+			uint16_t x, y, z;
+			uint16_t w;		///< Always 1, so the four components convert straight to a point the dequantization matrix applies to.
+		};
+
+		/**
+		 * @brief Normal of a vertex in compact storage, the unit sphere folded onto an octahedron and unrolled to a square.
+		 */
+		struct Encoded_Normal
+		{
+			int16_t x, y;
+		};
+
+		vector<Point4f>       original_normals;		 ///< Original normals of the given mesh.
+		Vertex_Buffer         original_vertices;	 ///< Original vertices of the given mesh.
+		vector<Index_Buffer>  lod_indices;			 ///< Indices of every level of detail, the first one holds the original indices of the given mesh. Freed once compacted.
+		vector<size_t>        lod_index_counts;		 ///< Number of indices of every level of detail.
+		vector<vector<Meshlet>> lod_meshlets;		 ///< Triangles of every level of detail grouped in meshlets.
+		Vertex_Colors         original_colors;		 ///< Original colors of the given mesh.
+
+		vector<Quantized_Position> quantized_vertices;	///< Original vertices in compact storage, used instead of them once compacted.
+		vector<Encoded_Normal>     encoded_normals;		///< Original normals in compact storage, used instead of them once compacted.
+		Matrix44                   dequantization;		///< Matrix from the quantized positions to model coordinates, the identity before compacting.
+
+		size_t  vertex_count;		///< Number of vertices, kept apart since the original vertices are freed once compacted.
+		Point3f bounding_center;	///< Center of the sphere that encloses the mesh in model coordinates.
+		float   bounding_radius;	///< Radius of the sphere that encloses the mesh in model coordinates.
+
+		/**
+		 * @brief Scratch data of a render call, taken from the frame arena of the thread and only valid until the call returns.
+		 * Nothing of a call is kept in the mesh, so several threads can render it at once. Only the entries of the vertices
+		 * marked in the call hold anything.
+		 */
+		struct Render_Pass
+		{
+			Color*   transformed_colors;	 ///< New colors of the mesh based with lightning operations applied.
+			Vertex*  transformed_vertices;	 ///< New vertices positions in projection coordinates.
+			Point4i* display_vertices;		 ///< New vertices positions in display coordinates.
+			Vertex*  subpixel_vertices;		 ///< Display coordinates before snapping them to whole pixels, used by the multisampled target.
+			uint8_t* vertex_marks;			 ///< TRANSFORMED and LIT flags of every vertex, so shared vertices are only processed once.
+			int*     visible_triangles;		 ///< Indices of the triangles that passed the culling and clipping.
+			size_t   visible_index_count;	 ///< Number of indices in visible_triangles.
+			int*     lit_vertices;			 ///< Provoking vertices of the visible triangles, the only ones whose color is ever used.
+			size_t   lit_vertex_count;		 ///< Number of vertices in lit_vertices.
+		};
+
+		enum Vertex_Mark : uint8_t
+		{
+			TRANSFORMED = 1,	///< The vertex has been transformed in the call.
+			LIT = 2,			///< The vertex has been queued for lighting in the call.
+		};
 
 	public:
 
@@ -68,12 +122,174 @@ namespace MScenary
 		 * @param rasterizer The rasterizer object for rendering.
 		 * @param transform_matrix The transformation matrix.
 		 * @param model_view_matrix The model-view matrix.
-		 * @param light_source The light source for illumination.
+		 * @param light_grid The lights of the scene, assigned to screen tiles.
+		 * @param lod The level of detail to draw, picked by select_lod().
+		 * @param multisample_buffer The multisampled target to draw into instead of the rasterizer, or nullptr to draw without anti-aliasing.
+		 *
+		 * The triangles are counted in the stats of the rasterizer, if it has any.
+		 */
+		void render(Rasterizer<Color_Buffer>& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, size_t lod, Multisample_Buffer* multisample_buffer = nullptr) const;
+
+		/**
+		 * @brief Same as render(), but the triangles are accumulated as translucent into the transparency buffer instead of drawn.
+		 *
+		 * @param transparency_buffer The target of the translucent triangles.
+		 * @param z_buffer The depth of the opaque triangles already drawn.
+		 * @param transform_matrix The transformation matrix.
+		 * @param model_view_matrix The model-view matrix.
+		 * @param light_grid The lights of the scene, assigned to screen tiles.
+		 * @param lod The level of detail to draw, picked by select_lod().
+		 * @param opacity The opacity of every triangle, from 0 to 1.
+		 * @param stats The counters of the triangles, or null to not count them.
 		 */
-		void render(Rasterizer<Color_Buffer>& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, Light& light_source);
+		void render_translucent(Transparency_Buffer& transparency_buffer, const vector<int>& z_buffer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, size_t lod, float opacity, Raster_Stats* stats = nullptr) const;
+
+		/**
+		 * @brief Renders only the depth of the full detail mesh, without any lighting, to use it as an occluder or shadow caster.
+		 *
+		 * @param rasterizer The depth only rasterizer.
+		 * @param transform_matrix The transformation matrix.
+		 * @param model_view_matrix The model-view matrix.
+		 * @param orthographic Whether the projection is orthographic, the meshlets facing away are only culled with perspective projections.
+		 */
+		void render_depth(Rasterizer<Depth_Target>& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, bool orthographic = false) const;
+
+		/**
+		 * @brief Moves the geometry to compact storage: positions quantized to 16 bits inside the bounding box, normals encoded in two
+		 * 16 bit values and the vertex indices of the meshlets in 16 bits when the mesh has fewer than 65536 vertices. The full precision
+		 * copies and the index buffers, only needed to build the levels of detail and the meshlets, are freed. The data is decoded as it
+		 * is transformed, so nothing else changes.
+		 */
+		void compact();
+
+		/**
+		 * @brief Checks whether the geometry is in compact storage.
+		 *
+		 * @return True after compact().
+		 */
+		bool is_compact() const
+		{
+			return !quantized_vertices.empty();
+		}
+
+		/**
+		 * @brief Builds the matrix that takes projected coordinates to the display coordinates of a target of the given size.
+		 *
+		 * @param width The width of the target.
+		 * @param height The height of the target.
+		 * @return The display transformation matrix.
+		 */
+		static Matrix44 get_display_transformation(unsigned width, unsigned height);
+
+		/**
+		 * @brief Picks the level of detail to render from the size the mesh covers on screen. The level only changes once the size
+		 * goes past the switch radius by more than the hysteresis margin, so a mesh sitting right at a threshold doesn't pop every frame.
+		 * The level of the last frame is kept by whoever draws the mesh, every camera has its own one.
+		 *
+		 * @param screen_radius Radius in pixels of the projected bounding sphere of the mesh.
+		 * @param current_level The level the mesh was drawn with in the last frame, 0 the first time.
+		 * @return The level to draw the mesh with, 0 for the full mesh.
+		 */
+		size_t select_lod(float screen_radius, size_t current_level) const;
+
+		/**
+		 * @brief Gets the center of the bounding sphere of the mesh.
+		 *
+		 * @return The center in model coordinates.
+		 */
+		const Point3f& get_bounding_center() const
+		{
+			return bounding_center;
+		}
+
+		/**
+		 * @brief Gets the radius of the bounding sphere of the mesh.
+		 *
+		 * @return The radius in model coordinates.
+		 */
+		float get_bounding_radius() const
+		{
+			return bounding_radius;
+		}
+
+		/**
+		 * @brief Gets the number of levels of detail generated for the mesh.
+		 *
+		 * @return The number of levels, the full mesh included.
+		 */
+		size_t get_lod_count() const
+		{
+			return lod_meshlets.size();
+		}
+
+		/**
+		 * @brief Gets the number of vertices of the mesh.
+		 *
+		 * @return The number of vertices, the same in compact storage.
+		 */
+		size_t get_vertex_count() const
+		{
+			return vertex_count;
+		}
+
+		/**
+		 * @brief Gets the memory the mesh keeps: vertices, normals, colors, every level of detail and its meshlets.
+		 *
+		 * @return The size in bytes, the mesh itself included.
+		 */
+		size_t get_source_bytes() const;
+
+		/**
+		 * @brief Gets the memory a render call of the full mesh takes from the frame arena of its thread, the largest of all the calls.
+		 *
+		 * @param shadow_map_count The shadow maps of the lights, every one adds a float of shadow visibility per vertex to the lighting.
+		 * @return The size in bytes, without the padding the arena adds to align the buffers.
+		 */
+		size_t get_scratch_bytes(size_t shadow_map_count) const;
 
 	private:
 
+		/**
+		 * @brief Computes the bounding sphere of the original vertices, builds the chain of simplified index buffers and splits every level in meshlets.
+		 */
+		void generate_lods();
+
+		/**
+		 * @brief Transforms the vertices of the visible meshlets, gathers the triangles that pass the culling and clipping in visible_triangles
+		 * and lights their provoking vertices, everything render() and render_translucent() need before rasterizing. The buffers are taken
+		 * from the frame arena, so the caller has to keep a scope of it open while it uses them.
+		 *
+		 * @param pass Where the buffers of the call are left.
+		 * @param lod The level of detail to draw.
+		 * @param width The width of the target.
+		 * @param height The height of the target.
+		 * @param transform_matrix The transformation matrix.
+		 * @param model_view_matrix The model-view matrix.
+		 * @param light_grid The lights of the scene, assigned to screen tiles.
+		 * @param stats The counters of the triangles submitted, culled for every reason and rasterized, or null to not count them.
+		 */
+		void prepare_triangles(Render_Pass& pass, size_t lod, unsigned width, unsigned height, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, Raster_Stats* stats) const;
+
+		/**
+		 * @brief Lights the vertices gathered in lit_vertices and stores their colors in transformed_colors.
+		 * The vertices are processed four at a time, with their components split in separate arrays.
+		 *
+		 * @param pass The buffers of the call.
+		 * @param model_view_matrix The model-view matrix, used to take the vertices and normals to camera coords.
+		 * @param light_grid The lights of the scene, every vertex is lit by the ones of the tile it falls on.
+		 */
+		void shade_vertices(Render_Pass& pass, const Matrix44& model_view_matrix, const Light_Grid& light_grid) const;
+
+		/**
+		 * @brief Transforms a vertex of the mesh, decoding it first when the geometry is compact.
+		 *
+		 * @param matrix The transformation, with the dequantization matrix already applied.
+		 * @param index The index of the vertex.
+		 * @param vectorized Whether to use the vectorized kernel, simd::enabled() read once by the caller.
+		 * @return The transformed vertex.
+		 */
+		Vertex transform_vertex(const Matrix44& matrix, int index, bool vectorized) const;
+
 		/**
 		 * @brief Checks if the triangle defined by the vertices is facing the camera, if so we render it.
 		 *
@@ -81,7 +297,7 @@ namespace MScenary
 		 * @param indices Pointer to the vertex indices.
 		 * @return True if the triangle is front-facing, false otherwise.
 		 */
-		bool is_frontface(const Vertex* const projected_vertices, const int* const indices);
+		bool is_frontface(const Vertex* const projected_vertices, const int* const indices) const;
 
 		/**
 		 * @brief Decides if the triangle should be rendered or not based on the position of its vertices in relation with the width and height of the screen
@@ -96,6 +312,6 @@ namespace MScenary
 		 * @param height Pointer to the height of the screen.
 		 * @return The number of clipped vertices.
 		 */
-		unsigned clip_triangle(Point4i* vertices, const int* init, const int* end, Point4i* clipped_vertices, const unsigned* width, const unsigned* height);
+		unsigned clip_triangle(Point4i* vertices, const int* init, const int* end, Point4i* clipped_vertices, const unsigned* width, const unsigned* height) const;
 	};
 }
\ No newline at end of file
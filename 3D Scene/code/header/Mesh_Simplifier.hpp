@@ -0,0 +1,127 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "math.hpp"
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Reduces the triangle count of a mesh with quadric error edge collapses (Garland & Heckbert).
+	 *
+	 * Every collapse moves one vertex onto one of its neighbours, so the simplified levels only differ in their
+	 * indices and keep sharing the vertex buffers of the original mesh. The simplifier keeps its state between calls,
+	 * so a whole LOD chain is built by calling simplify() with decreasing targets and reading the indices after each one.
+	 */
+	class Mesh_Simplifier
+	{
+		/**
+		 * @brief Symmetric 4x4 matrix that accumulates the squared distance to a set of planes.
+		 */
+		struct Quadric
+		{
+			double a[10]; ///< Upper triangle of the matrix, row by row.
+
+			Quadric();
+
+			void add_plane(double nx, double ny, double nz, double d, double weight);
+
+			void add(const Quadric& other);
+
+			double evaluate(const Point3f& point) const;
+		};
+
+		/**
+		 * @brief Candidate collapse of the vertex "from" onto the vertex "to". The versions let stale candidates be skipped when they are popped.
+		 */
+		struct Collapse
+		{
+			double   cost;
+			int      from;
+			int      to;
+			unsigned from_version;
+			unsigned to_version;
+
+			bool operator > (const Collapse& other) const
+			{
+				return cost > other.cost;
+			}
+		};
+
+		vector<Point3f>       positions;		  ///< Positions of the vertices of the mesh.
+		vector<Quadric>       quadrics;			  ///< Accumulated error quadric of every vertex.
+		vector<int>           triangles;		  ///< Working copy of the indices, collapsed vertices are replaced in place.
+		vector<bool>          triangle_alive;	  ///< Whether every triangle still exists or has been collapsed.
+		vector<vector<int>>   vertex_triangles;	  ///< Triangles around every vertex (it can contain triangles that have already been collapsed).
+		vector<unsigned>      versions;			  ///< Version of every vertex, increased each time its quadric or neighbourhood changes.
+		vector<bool>          vertex_alive;		  ///< Whether every vertex hasn't been collapsed onto another one.
+
+		std::priority_queue<Collapse, vector<Collapse>, std::greater<Collapse>> candidates; ///< Collapses sorted by increasing error.
+
+		size_t alive_triangles; ///< Number of triangles left.
+
+	public:
+
+		/**
+		 * @brief Builds the quadrics and adjacency of the mesh and queues every edge collapse.
+		 *
+		 * @param vertices Vertices of the mesh.
+		 * @param indices Indices of the mesh, three per triangle.
+		 */
+		Mesh_Simplifier(const vector<Point4f>& vertices, const vector<int>& indices);
+
+		/**
+		 * @brief Collapses edges, cheapest first, until the mesh has no more than the given number of triangles or the next collapse is too expensive.
+		 *
+		 * @param target_triangle_count The number of triangles to reach.
+		 * @param max_error The largest squared distance to the original surface a collapse is allowed to introduce.
+		 * @return The number of triangles left.
+		 */
+		size_t simplify(size_t target_triangle_count, float max_error);
+
+		/**
+		 * @brief Writes the indices of the triangles left.
+		 *
+		 * @param indices Buffer that receives the indices, three per triangle.
+		 */
+		void get_indices(vector<int>& indices) const;
+
+		/**
+		 * @brief Gets the number of triangles left.
+		 *
+		 * @return The number of triangles.
+		 */
+		size_t get_triangle_count() const
+		{
+			return alive_triangles;
+		}
+
+	private:
+
+		/**
+		 * @brief Queues the collapses of every edge that goes out of the given vertex, in both directions.
+		 *
+		 * @param vertex The vertex whose edges are queued.
+		 */
+		void queue_collapses(int vertex);
+
+		/**
+		 * @brief Checks that moving a vertex doesn't turn around any of the triangles that remain around it.
+		 *
+		 * @param from The vertex that is collapsed.
+		 * @param to The vertex it is collapsed onto.
+		 * @return True if no triangle flips, false otherwise.
+		 */
+		bool is_collapse_valid(int from, int to) const;
+	};
+}
@@ -0,0 +1,101 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "math.hpp"
+#include "Memory_Report.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Small cluster of neighbouring triangles of a mesh that can be culled as a whole.
+	 *
+	 * Every meshlet keeps its own list of the mesh vertices it uses, and its triangles index that list, so when a meshlet
+	 * is culled none of its vertices have to be transformed or lit. The bounds are stored in model coordinates.
+	 */
+	struct Meshlet
+	{
+		static constexpr size_t max_vertices         = 64;	///< Maximum number of vertices of a meshlet, small enough for 8 bit local indices.
+		static constexpr size_t max_triangles        = 124;	///< Maximum number of triangles of a meshlet.
+		static constexpr size_t min_triangles        = 64;	///< Number of triangles after which a meshlet stops growing if its normal cone gets too wide.
+		static constexpr float  min_normal_alignment = 0.5f;	///< Cosine of the largest angle between a new triangle and the meshlet axis once it has min_triangles.
+
+		vector<int>      vertices;		 ///< Indices of the mesh vertices used by the meshlet.
+		vector<uint16_t> short_vertices; ///< Same as vertices in 16 bits, used instead of them once the meshlet is compacted.
+		vector<uint8_t>  triangles;		 ///< Indices into the vertices of the meshlet, three per triangle.
+
+		Point3f  center;			 ///< Center of the bounding sphere.
+		float    radius;			 ///< Radius of the bounding sphere.
+		Vector3f cone_axis;			 ///< Average direction the triangles face towards.
+		float    cone_cutoff;		 ///< Sine of the spread of the normals around the axis, 1 when they spread too much to ever cull the meshlet.
+
+		/**
+		 * @brief Splits the triangles of a mesh into meshlets, growing each one through the triangles that share vertices with it.
+		 *
+		 * @param positions Vertices of the mesh.
+		 * @param indices Indices of the mesh, three per triangle.
+		 * @param meshlets Receives the meshlets.
+		 */
+		static void build(const vector<Point4f>& positions, const vector<int>& indices, vector<Meshlet>& meshlets);
+
+		/**
+		 * @brief Gets the memory of the index lists of the meshlet.
+		 *
+		 * @return The size in bytes, the meshlet itself not included.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(vertices) + MScenary::get_allocated_bytes(short_vertices) + MScenary::get_allocated_bytes(triangles);
+		}
+
+		/**
+		 * @brief Gets the number of mesh vertices used by the meshlet.
+		 *
+		 * @return The number of vertices.
+		 */
+		size_t get_vertex_count() const
+		{
+			return short_vertices.empty() ? vertices.size() : short_vertices.size();
+		}
+
+		/**
+		 * @brief Gets a mesh vertex used by the meshlet.
+		 *
+		 * @param local The index of the vertex in the meshlet.
+		 * @return The index of the vertex in the mesh.
+		 */
+		int get_vertex(size_t local) const
+		{
+			return short_vertices.empty() ? vertices[local] : int(short_vertices[local]);
+		}
+
+		/**
+		 * @brief Moves the vertex indices to 16 bits, only when every one of them fits.
+		 *
+		 * @return True if the meshlet was compacted.
+		 */
+		bool compact();
+
+		/**
+		 * @brief Checks whether every triangle of the meshlet faces away from the given point, using the normal cone.
+		 *
+		 * @param eye Position of the camera in model coordinates.
+		 * @return True if the whole meshlet is back facing, false if any of its triangles could be visible.
+		 */
+		bool is_backfacing(const Point3f& eye) const
+		{
+			Vector3f to_center = center - eye;
+
+			return glm::dot(to_center, cone_axis) >= cone_cutoff * glm::length(to_center) + radius;
+		}
+	};
+}
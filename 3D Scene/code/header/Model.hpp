@@ -24,6 +24,10 @@ namespace MScenary
 	{
 		std::vector<std::shared_ptr<Mesh>> meshes; ///< Vector of meshes that make up the model.
 
+		bool occluder = false;		///< Whether the model is rendered into the occlusion buffer to hide what is behind it.
+		bool shadow_caster = false;	///< Whether the model is rendered into the shadow maps of the lights.
+		float opacity = 1.f;		///< Opacity of the model, below 1 it is drawn in the translucent layer.
+
 	public:
 
 		/**
@@ -35,13 +39,87 @@ namespace MScenary
 		Model(Scene* given_scene, const char* mesh_file_path);
 
 		/**
-		 * @brief Passes along the meshes the projection and view matrix multiplied by the model coordinates already.
+		 * @brief Culls the meshes against the occlusion buffer of the view and adds the visible ones to its render queue, with the
+		 * projection and view matrix multiplied by the model coordinates already and the level of detail picked for the view.
+		 *
+		 * @param view The view.
+		 */
+		void submit(Scene_View& view) const override;
+
+		/**
+		 * @brief Renders the depth of the meshes into the occlusion buffer of the view, only if the model is an occluder.
+		 *
+		 * @param view The view.
+		 */
+		void render_occluder(Scene_View& view) const override;
+
+		/**
+		 * @brief Adds the meshes to the list of shadow casters with the model matrix, only if the model casts shadows.
+		 *
+		 * @param casters The list of shadow casters of the frame.
+		 */
+		void collect_shadow_casters(vector<Shadow_Caster>& casters) override;
+
+		/**
+		 * @brief Adds a group for the model with the memory of every mesh and what a render call of it takes from the frame arena.
+		 *
+		 * @param report The report.
+		 * @param name The name of the group.
+		 */
+		void report_memory(Memory_Report& report, const std::string& name) const override;
+
+		/**
+		 * @brief Sets whether the model hides what is behind it. Big and closed models make good occluders, the rest of models
+		 * are tested against them and skipped when they are hidden.
+		 *
+		 * @param is_occluder True to render the model into the occlusion buffer.
+		 */
+		void set_occluder(bool is_occluder)
+		{
+			occluder = is_occluder;
+		}
+
+		/**
+		 * @brief Sets whether the model casts shadows from the lights that have them enabled.
+		 *
+		 * @param casts_shadows True to render the model into the shadow maps.
+		 */
+		void set_shadow_caster(bool casts_shadows)
+		{
+			shadow_caster = casts_shadows;
+		}
+
+		/**
+		 * @brief Sets how opaque the model is. Translucent models are blended over the rest of the scene after it is drawn.
+		 *
+		 * @param new_opacity The opacity from 0 to 1, 1 to draw the model as opaque.
+		 */
+		void set_opacity(float new_opacity)
+		{
+			opacity = new_opacity;
+		}
+
+		/**
+		 * @brief Moves the geometry of every mesh of the model to compact storage, quantized and with 16 bit indices.
+		 * It can't go back, the full precision data is freed.
+		 */
+		void compact_geometry()
+		{
+			for (auto& mesh : meshes)
+			{
+				mesh->compact();
+			}
+		}
+
+		/**
+		 * @brief Gets the meshes of the model, empty if the file couldn't be loaded.
 		 *
-		 * @param projection_matrix The projection matrix.
-		 * @param view_matrix The view matrix.
-		 * @param light_source The light source for illumination.
+		 * @return The meshes.
 		 */
-		void render(const Matrix44& projection_matrix, const Matrix44& view_matrix, Light& light_source) override;
+		const std::vector<std::shared_ptr<Mesh>>& get_meshes() const
+		{
+			return meshes;
+		}
 
 	protected:
 
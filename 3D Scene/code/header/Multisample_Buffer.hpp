@@ -0,0 +1,201 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+#include "Raster_Stats.hpp"
+#include "Memory_Report.hpp"
+#include "math.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+	using argb::Rgb888;
+
+	/**
+	 * @brief 4x multisampled render target, drawn into instead of the color buffer when anti-aliasing is enabled and resolved into it at the end of the frame.
+	 *
+	 * Triangles are rasterized from their sub-pixel display positions, with four samples per pixel in a rotated grid. A triangle shades
+	 * every pixel only once, its color goes to all the samples it covers.
+	 *
+	 * Most pixels end up covered by a single triangle, so they are stored compressed: one depth and one color for all four samples.
+	 * A pixel only gets its own four depths and colors, taken from a pool, the first time a triangle covers it partially. Interior pixels
+	 * never look at their samples, so the cost grows with the pixels along the edges instead of with the total number of samples.
+	 */
+	class Multisample_Buffer
+	{
+	public:
+
+		static constexpr unsigned sample_count = 4;	///< Samples per pixel.
+
+	private:
+
+		/**
+		 * @brief Samples of a pixel covered by more than one triangle.
+		 */
+		struct Sample_Block
+		{
+			float    depth[sample_count];	///< Depth of every sample.
+			uint32_t color[sample_count];	///< Color of every sample as 0x00BBGGRR.
+			uint32_t pixel;					///< Pixel the samples belong to.
+		};
+
+		unsigned width;					///< Width in pixels.
+		unsigned height;				///< Height in pixels.
+
+		vector<Rgb888>       colors;	 ///< Color of every compressed pixel, laid out like the color buffer so it can be copied as it is.
+		vector<float>        depths;	 ///< Depth of every compressed pixel.
+		vector<int32_t>      blocks;	 ///< Index of the sample block of every pixel, -1 for compressed pixels.
+		vector<Sample_Block> pool;		 ///< Sample blocks of the pixels along the edges in the current frame.
+
+		int scissor_left;				///< First column drawn, cleared and resolved.
+		int scissor_top;				///< First row drawn, cleared and resolved.
+		int scissor_right;				///< Column after the last one drawn, cleared and resolved.
+		int scissor_bottom;				///< Row after the last one drawn, cleared and resolved.
+
+		Raster_Stats* stats;			///< Counters of the triangles filled, null while not counting.
+		uint16_t*     overdraw;			///< Times every pixel passed the depth test, null while not counting it.
+
+	public:
+
+		/**
+		 * @brief Creates a multisampled target of the given size.
+		 *
+		 * @param width The width in pixels.
+		 * @param height The height in pixels.
+		 */
+		Multisample_Buffer(unsigned width, unsigned height);
+
+		unsigned get_width() const
+		{
+			return width;
+		}
+
+		unsigned get_height() const
+		{
+			return height;
+		}
+
+		/**
+		 * @brief Gets the memory of the compressed pixels and of the pool of sample blocks, which keeps the size of the frame with most edges.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(colors) + MScenary::get_allocated_bytes(depths) + MScenary::get_allocated_bytes(blocks) + MScenary::get_allocated_bytes(pool);
+		}
+
+		/**
+		 * @brief Gets the number of pixels that have their own samples in the current frame.
+		 *
+		 * @return The number of edge pixels.
+		 */
+		size_t get_edge_pixel_count() const
+		{
+			return pool.size();
+		}
+
+		/**
+		 * @brief Limits the clear, the triangles and the resolve to a rectangle, leaving the pixels outside as they were.
+		 *
+		 * @param left, top The first column and row inside.
+		 * @param right, bottom The column and row after the last ones inside.
+		 */
+		void set_scissor(int left, int top, int right, int bottom);
+
+		/**
+		 * @brief Extends the scissor rectangle back to the whole buffer.
+		 */
+		void reset_scissor()
+		{
+			set_scissor(0, 0, int(width), int(height));
+		}
+
+		/**
+		 * @brief Clears every pixel inside the scissor to the given color and the farthest depth. Only the pixels that had samples have to be reset.
+		 *
+		 * @param color The background color.
+		 */
+		void clear(const Rgb888& color);
+
+		/**
+		 * @brief Counts the spans and the pixels of the triangles filled from now on, a pixel passing when any of its samples does.
+		 *
+		 * @param new_stats The counters, or null to stop counting.
+		 * @param new_overdraw Counts laid out like the pixels, increased for every pixel that passes, or null to leave them alone.
+		 */
+		void set_stats(Raster_Stats* new_stats, uint16_t* new_overdraw = nullptr)
+		{
+			stats = new_stats;
+			overdraw = new_stats ? new_overdraw : nullptr;
+		}
+
+		/**
+		 * @brief Draws a triangle of a single color, keeping the nearest depth of every sample.
+		 *
+		 * @param v0, v1, v2 The vertices in display coordinates, without snapping to whole pixels.
+		 * @param color The color of the triangle.
+		 */
+		void fill_triangle(const Point4f& v0, const Point4f& v1, const Point4f& v2, const Rgb888& color);
+
+		/**
+		 * @brief Writes the final image inside the scissor into a color buffer of the same size, averaging the samples of the edge pixels.
+		 *
+		 * @param color_buffer The target color buffer.
+		 */
+		void resolve(argb::Color_Buffer<Rgb888>& color_buffer) const;
+
+		/**
+		 * @brief Writes the depth of every pixel inside the scissor into a z-buffer of the same size, the nearest sample for the edge pixels,
+		 * so what is drawn after the resolve can still be hidden by the multisampled triangles.
+		 *
+		 * @param z_buffer The target z-buffer, in the integer depth of the display coordinates.
+		 */
+		void resolve_depth(vector<int>& z_buffer) const;
+
+	private:
+
+		bool has_scissor() const
+		{
+			return scissor_left > 0 || scissor_top > 0 || scissor_right < int(width) || scissor_bottom < int(height);
+		}
+
+		bool inside_scissor(uint32_t pixel) const
+		{
+			int x = int(pixel % width);
+			int y = int(pixel / width);
+
+			return x >= scissor_left && x < scissor_right && y >= scissor_top && y < scissor_bottom;
+		}
+
+		/**
+		 * @brief Draws a triangle, with or without counting it in the stats. Without counting the loops are the same as before.
+		 *
+		 * @param v0, v1, v2 The vertices in display coordinates.
+		 * @param color The color of the triangle.
+		 */
+		template< bool COUNT >
+		void fill(const Point4f& v0, const Point4f& v1, const Point4f& v2, const Rgb888& color);
+
+		/**
+		 * @brief Gives a compressed pixel its own samples, all of them starting with the color and depth it had.
+		 *
+		 * @param pixel The pixel.
+		 * @return The sample block of the pixel.
+		 */
+		Sample_Block& expand(uint32_t pixel);
+
+		static uint32_t pack(const Rgb888& color)
+		{
+			return uint32_t(color.red()) | (uint32_t(color.green()) << 8) | (uint32_t(color.blue()) << 16);
+		}
+	};
+}
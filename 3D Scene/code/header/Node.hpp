@@ -7,10 +7,17 @@
 #pragma once
 
 #include "Transform.hpp"
+#include "Render_Queue.hpp"
+#include "Shadow_Map.hpp"
+#include "Memory_Report.hpp"
+
+#include <memory>
+#include <string>
 
 namespace MScenary
 {
 	class Scene;
+	class Scene_View;
 	class Light;
 
 	/**
@@ -23,7 +30,8 @@ namespace MScenary
 	protected:
 
 		Scene* scene;		  ///< Pointer to the scene containing the node.
-		Transform* transform; ///< Pointer to the transform of the node that stores the transform matrix.
+		std::unique_ptr<Transform> transform; ///< Transform of the node that stores the transform matrix, owned by the node.
+		Matrix44 world_matrix; ///< Matrix from model coordinates to scene coordinates in the current frame, set by update_world_matrix().
 
 	public:
 
@@ -32,7 +40,9 @@ namespace MScenary
 		 *
 		 * @param given_scene Pointer to the scene where the node belongs.
 		 */
-		Node(Scene* given_scene) : transform(new Transform()), scene(given_scene) {}
+		Node(Scene* given_scene) : scene(given_scene), transform(new Transform()), world_matrix(1) {}
+
+		virtual ~Node() = default;
 
 		/**
 		 * @brief Updates the node. It should be used to move the nodes around the scene and some physics/movement calculations.
@@ -40,13 +50,47 @@ namespace MScenary
 		virtual void update() {}
 
 		/**
-		 * @brief Renders the node and passes along a serie of useful matrices for its render calculations.
+		 * @brief Calculates the matrix of the node in the scene, once per frame after every node has been updated, so every camera
+		 * the frame is drawn from shares it.
+		 */
+		void update_world_matrix()
+		{
+			world_matrix = transform->get_transform_matrix();
+		}
+
+		/**
+		 * @brief Adds whatever the node has to draw to the render queue of a view, with the matrices of its camera. It can be called
+		 * for several views at once from different threads, so it mustn't change the node.
 		 *
-		 * @param projection_matrix The projection matrix for rendering.
-		 * @param view_matrix The view matrix for rendering.
-		 * @param light_source The light source for rendering.
+		 * @param view The view, with the queue the draw items are added to.
 		 */
-		virtual void render(const Matrix44& projection_matrix, const Matrix44& view_matrix, Light& light_source) {}
+		virtual void submit(Scene_View& view) const {}
+
+		/**
+		 * @brief Renders the depth of the node into the occlusion buffer of a view, if the node hides what is behind it.
+		 * Like submit(), it can be called for several views at once.
+		 *
+		 * @param view The view, with the occlusion buffer.
+		 */
+		virtual void render_occluder(Scene_View& view) const {}
+
+		/**
+		 * @brief Adds the meshes of the node that cast shadows to the list the shadow maps are rendered from.
+		 *
+		 * @param casters The list of shadow casters of the frame.
+		 */
+		virtual void collect_shadow_casters(vector<Shadow_Caster>& casters) {}
+
+		/**
+		 * @brief Adds the memory of the node to a report, the derived nodes add what they own on top.
+		 *
+		 * @param report The report.
+		 * @param name The name the node is listed with.
+		 */
+		virtual void report_memory(Memory_Report& report, const std::string& name) const
+		{
+			report.add(name, sizeof(Node) + sizeof(Transform));
+		}
 
 		/**
 		 * @brief Gets the transform of the node.
@@ -55,7 +99,17 @@ namespace MScenary
 		 */
 		Transform* get_transform()
 		{
-			return transform;
+			return transform.get();
+		}
+
+		/**
+		 * @brief Gets the matrix of the node in the scene for the current frame.
+		 *
+		 * @return The matrix calculated by the last update_world_matrix().
+		 */
+		const Matrix44& get_world_matrix() const
+		{
+			return world_matrix;
 		}
 	};
 }
\ No newline at end of file
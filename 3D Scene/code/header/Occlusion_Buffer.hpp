@@ -0,0 +1,83 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Depth_Rasterizer.hpp"
+#include "math.hpp"
+
+#include <vector>
+
+namespace MScenary
+{
+	/**
+	 * @brief Small software depth buffer the occluders of the scene are rendered into before the main pass,
+	 * used to skip the meshes completely hidden behind them before any of their vertices are processed.
+	 *
+	 * The occluders go through the same Rasterizer as the main pass, only on a depth target of a much smaller size.
+	 * Since a low resolution pixel can be only partially covered, once every occluder is in the depth of every pixel
+	 * is replaced by the farthest depth around it, so a mesh is only taken as hidden when it really is.
+	 */
+	class Occlusion_Buffer
+	{
+		Depth_Target               target;			 ///< Depth only render target.
+		Rasterizer< Depth_Target > rasterizer;		 ///< Rasterizer the occluders are rendered with.
+		std::vector<int>           occluder_depth;	 ///< Conservative depth of the occluders, the one the tests are done against.
+
+	public:
+
+		/**
+		 * @brief Creates an occlusion buffer of the given size.
+		 *
+		 * @param width The width in pixels.
+		 * @param height The height in pixels.
+		 */
+		Occlusion_Buffer(unsigned width = 256, unsigned height = 128);
+
+		/**
+		 * @brief Gets the memory of the depth of the occluders, the rendered one and the conservative one.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return target.get_allocated_bytes() + rasterizer.get_allocated_bytes() + occluder_depth.capacity() * sizeof(int);
+		}
+
+		/**
+		 * @brief Clears the depth before rendering the occluders of a new frame.
+		 */
+		void clear()
+		{
+			rasterizer.clear();
+		}
+
+		/**
+		 * @brief Gets the rasterizer the occluders have to be rendered with.
+		 *
+		 * @return Rasterizer< Depth_Target >& Reference to the rasterizer.
+		 */
+		Rasterizer< Depth_Target >& get_rasterizer()
+		{
+			return rasterizer;
+		}
+
+		/**
+		 * @brief Builds the conservative depth the tests are done against, once every occluder of the frame has been rendered.
+		 */
+		void update();
+
+		/**
+		 * @brief Checks whether a bounding sphere is completely behind the occluders.
+		 *
+		 * @param center Center of the sphere in model coordinates.
+		 * @param radius Radius of the sphere in model coordinates.
+		 * @param transform_matrix Matrix from model coordinates to projection coordinates.
+		 * @return True if the sphere is hidden, false if any part of it could be visible.
+		 */
+		bool is_occluded(const Point3f& center, float radius, const Matrix44& transform_matrix) const;
+	};
+}
@@ -0,0 +1,71 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+#include "Thread_Pool.hpp"
+
+#include <functional>
+
+namespace MScenary
+{
+	using argb::Rgb888;
+
+	/**
+	 * @brief Screen space pass applied to the finished image, after everything is rasterized and before it reaches the window.
+	 */
+	class Post_Process
+	{
+		Thread_Pool* thread_pool = nullptr;	///< Threads the bands are processed on, none to process them on the calling thread.
+
+	public:
+
+		typedef argb::Color_Buffer<Rgb888> Color_Buffer;	///< Alias for 24 bit color buffer type.
+
+		virtual ~Post_Process() = default;
+
+		/**
+		 * @brief Processes the image in place.
+		 *
+		 * @param color_buffer The image.
+		 */
+		virtual void apply(Color_Buffer& color_buffer) = 0;
+
+		/**
+		 * @brief Sets the threads the bands of the image are processed on, kept by whoever applies the pass.
+		 *
+		 * @param pool The threads, or null to process every band on the calling thread.
+		 */
+		void set_thread_pool(Thread_Pool* pool)
+		{
+			thread_pool = pool;
+		}
+
+		/**
+		 * @brief Gets the memory the pass keeps from one frame to the next.
+		 *
+		 * @return The size in bytes.
+		 */
+		virtual size_t get_allocated_bytes() const
+		{
+			return 0;
+		}
+
+	protected:
+
+		static constexpr unsigned band_height = 16;		///< Rows of every band of work handed to the threads.
+
+		/**
+		 * @brief Splits the rows of an image in bands and processes them in parallel on the thread pool, every thread taking the next
+		 * free band until none is left.
+		 *
+		 * @param rows The number of rows.
+		 * @param function Called with the first and the end row of every band.
+		 */
+		void for_each_band(unsigned rows, const std::function<void(unsigned, unsigned)>& function) const;
+	};
+}
@@ -0,0 +1,144 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color.hpp"
+#include "Color_Buffer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+	using argb::Rgb888;
+
+	/**
+	 * @brief Counters of everything a frame goes through from the meshes drawn to the pixels written.
+	 *
+	 * The pipeline only counts when it's handed a Raster_Stats. Otherwise the rasterizers run versions of their loops without
+	 * any counting, so the stats cost nothing in the frames that aren't sampled.
+	 */
+	struct Raster_Stats
+	{
+		/**
+		 * @brief Why a triangle of a mesh drawn didn't reach the rasterizer.
+		 */
+		enum Cull_Reason
+		{
+			MESHLET_FRUSTUM,	///< Its meshlet was out of the view.
+			MESHLET_BACKFACE,	///< Its meshlet was facing away as a whole.
+			BACKFACE,			///< It was facing away.
+			CLIPPED,			///< Nothing of it was left inside the screen.
+			CULL_REASON_COUNT
+		};
+
+		uint64_t meshes_submitted = 0;		///< Meshes drawn.
+		uint64_t meshes_occluded = 0;		///< Meshes skipped because they were hidden behind the occluders.
+		uint64_t meshes_unchanged = 0;		///< Meshes skipped because they were outside of the part of the frame drawn again.
+
+		uint64_t triangles_submitted = 0;						///< Triangles of the meshes drawn, at the level of detail they were drawn with.
+		uint64_t triangles_culled[CULL_REASON_COUNT] = { };		///< Triangles of the meshes drawn that were culled, for every reason.
+		uint64_t triangles_rasterized = 0;						///< Triangles that reached the rasterizer.
+
+		uint64_t spans = 0;				///< Rows of pixels filled.
+		uint64_t pixels_tested = 0;		///< Pixels inside the triangles that reached the depth test.
+		uint64_t pixels_passed = 0;		///< Pixels that passed the depth test, with multisampling the ones where any sample did.
+		uint64_t pixels_written = 0;	///< Pixels whose color was written.
+
+		void clear()
+		{
+			*this = Raster_Stats();
+		}
+
+		Raster_Stats& operator += (const Raster_Stats& other);
+
+		/**
+		 * @brief Gets the name of a reason to cull a triangle, to print the stats.
+		 *
+		 * @param reason The reason.
+		 * @return The name in snake case.
+		 */
+		static const char* get_cull_reason_name(Cull_Reason reason);
+	};
+
+	/**
+	 * @brief How many times every pixel was shaded in a frame, to find where the rasterizer works on pixels that end up hidden.
+	 */
+	class Overdraw_Map
+	{
+		unsigned         width;		///< Width in pixels.
+		unsigned         height;	///< Height in pixels.
+		vector<uint16_t> counts;	///< Times every pixel passed the depth test.
+
+	public:
+
+		Overdraw_Map()
+			:
+			width(0),
+			height(0)
+		{
+		}
+
+		unsigned get_width() const
+		{
+			return width;
+		}
+
+		unsigned get_height() const
+		{
+			return height;
+		}
+
+		/**
+		 * @brief Sets the size of the map, clearing it if it changes.
+		 *
+		 * @param new_width The width in pixels.
+		 * @param new_height The height in pixels.
+		 */
+		void resize(unsigned new_width, unsigned new_height);
+
+		/**
+		 * @brief Sets every count back to zero.
+		 */
+		void clear();
+
+		/**
+		 * @brief Gets the counts for the rasterizers to increase, laid out like the color buffer.
+		 *
+		 * @return The counts.
+		 */
+		uint16_t* get_counts()
+		{
+			return counts.data();
+		}
+
+		const uint16_t* get_counts() const
+		{
+			return counts.data();
+		}
+
+		size_t get_allocated_bytes() const
+		{
+			return counts.capacity() * sizeof(uint16_t);
+		}
+
+		/**
+		 * @brief Gets the times a pixel was shaded on average, counting only the pixels shaded at least once.
+		 *
+		 * @return The overdraw, 1 when no pixel was shaded twice.
+		 */
+		float get_average() const;
+
+		/**
+		 * @brief Draws the map as a heatmap, black where nothing was shaded and from blue to red as the overdraw grows.
+		 *
+		 * @param target The image, of the same size as the map.
+		 */
+		void resolve(argb::Color_Buffer< Rgb888 >& target) const;
+	};
+}
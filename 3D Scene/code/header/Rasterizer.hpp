@@ -6,14 +6,178 @@
 #define RASTERIZER_HEADER
 
 #include <algorithm>
+#include <array>
 #include <ciso646>
 #include <cstdint>
 #include <limits>
+#include <utility>
 #include <vector>
 #include "math.hpp"
+#include "Raster_Stats.hpp"
 
 namespace MScenary
 {
+	// Modos del rasterizador. Cada combinación se instancia por separado con sus políticas, de modo que el bucle
+	// interno de cada una no tiene ninguna comprobación del modo y el modo solo se elige una vez por polígono.
+
+	namespace Raster
+	{
+		enum Depth_Mode
+		{
+			DEPTH_OFF,				// Ni se comprueba ni se escribe la profundidad.
+			DEPTH_TEST,				// Se comprueba pero no se escribe (p. ej. para superficies translúcidas).
+			DEPTH_TEST_WRITE,		// Se comprueba y se escribe.
+			DEPTH_MODE_COUNT
+		};
+
+		enum Shading_Mode
+		{
+			FLAT,					// Todo el polígono con el color fijado con set_color().
+			GOURAUD,				// Color interpolado entre los colores de los vértices fijados con set_vertex_colors().
+			SHADING_MODE_COUNT
+		};
+
+		enum Write_Mask
+		{
+			WRITE_COLOR,			// Se escribe el color.
+			WRITE_NONE,				// No se escribe el color, solo la profundidad si el modo de profundidad la escribe.
+			WRITE_MASK_COUNT
+		};
+
+		enum Blend_Mode
+		{
+			BLEND_REPLACE,			// El color sustituye al que hay en el buffer.
+			BLEND_ALPHA,			// Mezcla con el color del buffer según el alpha fijado con set_alpha().
+			BLEND_ADD,				// Se suma al color del buffer, saturando.
+			BLEND_MODE_COUNT
+		};
+
+		struct State
+		{
+			Depth_Mode   depth      = DEPTH_TEST_WRITE;
+			Shading_Mode shading    = FLAT;
+			Write_Mask   write_mask = WRITE_COLOR;
+			Blend_Mode   blend      = BLEND_REPLACE;
+		};
+
+		// Políticas de profundidad:
+
+		struct Depth_Off
+		{
+			static bool test  (int , int ) { return true; }
+			static void write (int , int&) { }
+		};
+
+		struct Depth_Test
+		{
+			static bool test  (int z, int stored) { return z < stored; }
+			static void write (int  , int&      ) { }
+		};
+
+		struct Depth_Test_Write
+		{
+			static bool test  (int z, int  stored) { return z < stored; }
+			static void write (int z, int& stored) { stored = z; }
+		};
+
+		// Políticas de sombreado. Los atributos se interpolan en coma fija 16.16 a lo largo de los lados y las scanlines:
+
+		struct Flat_Shading
+		{
+			static constexpr unsigned attribute_count = 0;
+
+			template< class COLOR > static void  load  (const COLOR&      , int*       ) { }
+			template< class COLOR > static COLOR shade (const COLOR& color, const int* ) { return color; }
+		};
+
+		struct Gouraud_Shading
+		{
+			static constexpr unsigned attribute_count = 3;
+
+			template< class COLOR >
+			static void load (const COLOR& color, int* attributes)
+			{
+				attributes[0] = int(color.red  ()) << 16;
+				attributes[1] = int(color.green()) << 16;
+				attributes[2] = int(color.blue ()) << 16;
+			}
+
+			template< class COLOR >
+			static COLOR shade (const COLOR& , const int* attributes)
+			{
+				COLOR color;
+
+				color.red  () = typename COLOR::Component_Type(attributes[0] >> 16);
+				color.green() = typename COLOR::Component_Type(attributes[1] >> 16);
+				color.blue () = typename COLOR::Component_Type(attributes[2] >> 16);
+
+				return color;
+			}
+		};
+
+		// Políticas de máscara de escritura:
+
+		struct Write_Color { static constexpr bool writes_color = true;  };
+		struct Write_None  { static constexpr bool writes_color = false; };
+
+		// Políticas de mezcla. El alpha va de 0 a 256:
+
+		struct Blend_Replace
+		{
+			template< class COLOR > static COLOR blend (const COLOR& source, const COLOR& , int ) { return source; }
+		};
+
+		struct Blend_Alpha
+		{
+			template< class COLOR >
+			static COLOR blend (const COLOR& source, const COLOR& target, int alpha)
+			{
+				COLOR color;
+
+				color.red  () = typename COLOR::Component_Type(target.red  () + (((int(source.red  ()) - int(target.red  ())) * alpha) >> 8));
+				color.green() = typename COLOR::Component_Type(target.green() + (((int(source.green()) - int(target.green())) * alpha) >> 8));
+				color.blue () = typename COLOR::Component_Type(target.blue () + (((int(source.blue ()) - int(target.blue ())) * alpha) >> 8));
+
+				return color;
+			}
+		};
+
+		struct Blend_Add
+		{
+			template< class COLOR >
+			static COLOR blend (const COLOR& source, const COLOR& target, int )
+			{
+				COLOR color;
+
+				color.red  () = typename COLOR::Component_Type(std::min(int(source.red  ()) + int(target.red  ()), 255));
+				color.green() = typename COLOR::Component_Type(std::min(int(source.green()) + int(target.green()), 255));
+				color.blue () = typename COLOR::Component_Type(std::min(int(source.blue ()) + int(target.blue ()), 255));
+
+				return color;
+			}
+		};
+
+		// Correspondencia entre los modos y las políticas:
+
+		template< unsigned MODE > struct Depth_Policy;
+		template< > struct Depth_Policy< DEPTH_OFF        > { typedef Depth_Off        Type; };
+		template< > struct Depth_Policy< DEPTH_TEST       > { typedef Depth_Test       Type; };
+		template< > struct Depth_Policy< DEPTH_TEST_WRITE > { typedef Depth_Test_Write Type; };
+
+		template< unsigned MODE > struct Shading_Policy;
+		template< > struct Shading_Policy< FLAT    > { typedef Flat_Shading    Type; };
+		template< > struct Shading_Policy< GOURAUD > { typedef Gouraud_Shading Type; };
+
+		template< unsigned MODE > struct Write_Policy;
+		template< > struct Write_Policy< WRITE_COLOR > { typedef Write_Color Type; };
+		template< > struct Write_Policy< WRITE_NONE  > { typedef Write_None  Type; };
+
+		template< unsigned MODE > struct Blend_Policy;
+		template< > struct Blend_Policy< BLEND_REPLACE > { typedef Blend_Replace Type; };
+		template< > struct Blend_Policy< BLEND_ALPHA   > { typedef Blend_Alpha   Type; };
+		template< > struct Blend_Policy< BLEND_ADD     > { typedef Blend_Add     Type; };
+	}
+
 	template< class COLOR_BUFFER_TYPE >
 	class Rasterizer
 	{
@@ -24,15 +188,45 @@ namespace MScenary
 
 	private:
 
+		typedef void (Rasterizer::*Fill_Function)(const Point4i* const, const int* const, const int* const);
+
+		static constexpr unsigned max_attributes = 3;
+
+		static constexpr unsigned mode_count =
+			Raster::DEPTH_MODE_COUNT * Raster::SHADING_MODE_COUNT * Raster::WRITE_MASK_COUNT * Raster::BLEND_MODE_COUNT;
+
+		// Cada modo está dos veces en la tabla, sin contar y contando las estadísticas:
+
+		static const std::array< Fill_Function, 2 * mode_count > fill_functions;
+
 		Color_Buffer& color_buffer;
 
-		static int offset_cache0[2160];
-		static int offset_cache1[2160];
+		// Las cachés de los lados son de cada rasterizador, así varios pueden rellenar polígonos a la vez desde hilos distintos.
+		// Tienen una entrada por scanline del color buffer y dos más, porque interpolate() escribe de dos en dos hasta y_max + 1:
 
-		static int z_cache0[2160];
-		static int z_cache1[2160];
+		std::vector< int > offset_cache0;
+		std::vector< int > offset_cache1;
 
-		Color color;
+		std::vector< int > z_cache0;
+		std::vector< int > z_cache1;
+
+		std::vector< int > attribute_cache0[max_attributes];
+		std::vector< int > attribute_cache1[max_attributes];
+
+		Color          color;
+		const Color  * vertex_colors;
+		int            alpha;
+
+		Raster::State  state;
+		Fill_Function  fill_function;
+
+		Raster_Stats * stats;
+		uint16_t     * overdraw;
+
+		int            scissor_left;
+		int            scissor_top;
+		int            scissor_right;
+		int            scissor_bottom;
 
 		std::vector< int > z_buffer;
 
@@ -40,9 +234,25 @@ namespace MScenary
 
 		Rasterizer(Color_Buffer& target)
 			:
-			color_buffer(target),
-			z_buffer(target.get_width()* target.get_height())
+			color_buffer (target),
+			offset_cache0(target.get_height() + 2),
+			offset_cache1(target.get_height() + 2),
+			z_cache0     (target.get_height() + 2),
+			z_cache1     (target.get_height() + 2),
+			vertex_colors(nullptr),
+			alpha        (256),
+			stats        (nullptr),
+			overdraw     (nullptr),
+			z_buffer     (target.get_width()* target.get_height())
 		{
+			for (unsigned attribute = 0; attribute < max_attributes; attribute++)
+			{
+				attribute_cache0[attribute].resize(target.get_height() + 2);
+				attribute_cache1[attribute].resize(target.get_height() + 2);
+			}
+
+			set_state     (Raster::State());
+			reset_scissor ();
 		}
 
 		const Color_Buffer& get_color_buffer() const
@@ -50,6 +260,30 @@ namespace MScenary
 			return (color_buffer);
 		}
 
+		const std::vector< int >& get_z_buffer() const
+		{
+			return (z_buffer);
+		}
+
+		std::vector< int >& get_z_buffer()
+		{
+			return (z_buffer);
+		}
+
+		// Memoria del z-buffer y de las cachés de los lados:
+
+		size_t get_allocated_bytes() const
+		{
+			size_t caches = offset_cache0.capacity() + offset_cache1.capacity() + z_cache0.capacity() + z_cache1.capacity();
+
+			for (unsigned attribute = 0; attribute < max_attributes; attribute++)
+			{
+				caches += attribute_cache0[attribute].capacity() + attribute_cache1[attribute].capacity();
+			}
+
+			return (z_buffer.capacity() + caches) * sizeof(int);
+		}
+
 	public:
 
 		void set_color(const Color& new_color)
@@ -59,60 +293,226 @@ namespace MScenary
 
 		void set_color(float r, float g, float b)
 		{
-			color_buffer.set(r, g, b);
+			color.set(r, g, b);
+		}
+
+		// Colores por vértice para el sombreado Gouraud, indexados igual que los vértices:
+
+		void set_vertex_colors(const Color* new_vertex_colors)
+		{
+			vertex_colors = new_vertex_colors;
+		}
+
+		void set_alpha(float new_alpha)
+		{
+			alpha = int(std::min(std::max(new_alpha, 0.f), 1.f) * 256.f);
+		}
+
+		// Se elige la función de relleno del modo una sola vez, fill_polygon() la llama directamente:
+
+		void set_state(const Raster::State& new_state)
+		{
+			state = new_state;
+
+			select_fill_function();
+		}
+
+		const Raster::State& get_state() const
+		{
+			return state;
+		}
+
+		// Mientras se le dan unas estadísticas, se cuentan en ellas las scanlines y los píxeles de los polígonos rellenados,
+		// y si se le da un mapa de overdraw (del tamaño del color buffer) cada píxel que pasa el test de profundidad suma 1 en él.
+		// Sin ellas se usan las funciones de relleno que no cuentan nada:
+
+		void set_stats(Raster_Stats* new_stats, uint16_t* new_overdraw = nullptr)
+		{
+			stats    = new_stats;
+			overdraw = new_stats ? new_overdraw : nullptr;
+
+			select_fill_function();
+		}
+
+		Raster_Stats* get_stats() const
+		{
+			return stats;
+		}
+
+		// Limita el dibujo y el borrado a un rectángulo en píxeles (sin incluir el lado derecho ni el inferior):
+
+		void set_scissor(int left, int top, int right, int bottom)
+		{
+			scissor_left   = std::max(left, 0);
+			scissor_top    = std::max(top,  0);
+			scissor_right  = std::min(right,  int(color_buffer.get_width ()));
+			scissor_bottom = std::min(bottom, int(color_buffer.get_height()));
+		}
+
+		void reset_scissor()
+		{
+			set_scissor(0, 0, int(color_buffer.get_width()), int(color_buffer.get_height()));
+		}
+
+		bool has_scissor() const
+		{
+			return scissor_left > 0 || scissor_top > 0 || scissor_right < int(color_buffer.get_width()) || scissor_bottom < int(color_buffer.get_height());
 		}
 
 		void clear()
 		{
-			color_buffer.clear({ 0, 0.6f, 0.8f });
+			if (!has_scissor())
+			{
+				color_buffer.clear({ 0, 0.6f, 0.8f });
+
+				for (int* z = z_buffer.data(), *end = z + z_buffer.size(); z != end; z++)
+				{
+					*z = std::numeric_limits< int >::max();
+				}
+
+				return;
+			}
+
+			// Con recorte solo se borran las filas del rectángulo, cada una entre sus lados izquierdo y derecho:
+
+			const Color background(0.f, 0.6f, 0.8f);
 
-			for (int* z = z_buffer.data(), *end = z + z_buffer.size(); z != end; z++)
+			int pitch = int(color_buffer.get_width());
+
+			for (int y = scissor_top; y < scissor_bottom; y++)
 			{
-				*z = std::numeric_limits< int >::max();
+				int begin = y * pitch + scissor_left;
+				int end   = y * pitch + scissor_right;
+
+				std::fill(color_buffer.pixels() + begin, color_buffer.pixels() + end, background);
+				std::fill(z_buffer.begin() + begin, z_buffer.begin() + end, std::numeric_limits< int >::max());
 			}
 		}
 
+		// Rellena con el modo fijado con set_state():
+
+		void fill_polygon
+		(
+			const Point4i* const vertices,
+			const int* const indices_begin,
+			const int* const indices_end
+		)
+		{
+			(this->*fill_function)(vertices, indices_begin, indices_end);
+		}
+
+		// Modos fijos, sin pasar por la tabla:
+
 		void fill_convex_polygon
 		(
 			const Point4i* const vertices,
 			const int* const indices_begin,
 			const int* const indices_end
-		);
+		)
+		{
+			if (stats)
+				fill< Raster::Depth_Off, Raster::Flat_Shading, Raster::Write_Color, Raster::Blend_Replace, true  >(vertices, indices_begin, indices_end);
+			else
+				fill< Raster::Depth_Off, Raster::Flat_Shading, Raster::Write_Color, Raster::Blend_Replace, false >(vertices, indices_begin, indices_end);
+		}
 
 		void fill_convex_polygon_z_buffer
 		(
 			const Point4i* const vertices,
 			const int* const indices_begin,
 			const int* const indices_end
-		);
+		)
+		{
+			if (stats)
+				fill< Raster::Depth_Test_Write, Raster::Flat_Shading, Raster::Write_Color, Raster::Blend_Replace, true  >(vertices, indices_begin, indices_end);
+			else
+				fill< Raster::Depth_Test_Write, Raster::Flat_Shading, Raster::Write_Color, Raster::Blend_Replace, false >(vertices, indices_begin, indices_end);
+		}
 
 	private:
 
+		void select_fill_function()
+		{
+			fill_function = fill_functions
+			[
+				(stats ? mode_count : 0) +
+				((unsigned(state.depth) * Raster::SHADING_MODE_COUNT + state.shading) * Raster::WRITE_MASK_COUNT + state.write_mask) * Raster::BLEND_MODE_COUNT + state.blend
+			];
+		}
+
+		template< class DEPTH, class SHADING, class WRITE_MASK, class BLEND, bool COUNT >
+		void fill
+		(
+			const Point4i* const vertices,
+			const int* const indices_begin,
+			const int* const indices_end
+		);
+
+		template< unsigned MODE >
+		void fill_mode
+		(
+			const Point4i* const vertices,
+			const int* const indices_begin,
+			const int* const indices_end
+		)
+		{
+			fill
+			<
+				typename Raster::Depth_Policy  < MODE % mode_count / (Raster::SHADING_MODE_COUNT * Raster::WRITE_MASK_COUNT * Raster::BLEND_MODE_COUNT) >::Type,
+				typename Raster::Shading_Policy< MODE / (Raster::WRITE_MASK_COUNT * Raster::BLEND_MODE_COUNT) % Raster::SHADING_MODE_COUNT >::Type,
+				typename Raster::Write_Policy  < MODE / Raster::BLEND_MODE_COUNT % Raster::WRITE_MASK_COUNT >::Type,
+				typename Raster::Blend_Policy  < MODE % Raster::BLEND_MODE_COUNT >::Type,
+				(MODE >= mode_count)
+			>
+			(vertices, indices_begin, indices_end);
+		}
+
+		template< size_t... MODES >
+		static std::array< Fill_Function, 2 * mode_count > make_fill_functions(std::index_sequence< MODES... >)
+		{
+			return {{ &Rasterizer::fill_mode< MODES >... }};
+		}
+
+		template< class SHADING >
+		void interpolate_edge
+		(
+			int** caches,
+			const Point4i* const vertices,
+			int index0,
+			int index1,
+			int pitch
+		);
+
 		template< typename VALUE_TYPE, size_t SHIFT >
 		void interpolate(int* cache, int v0, int v1, int y_min, int y_max);
 	};
 
-	template< class COLOR_BUFFER_TYPE > int Rasterizer< COLOR_BUFFER_TYPE >::offset_cache0[2160];
-	template< class COLOR_BUFFER_TYPE > int Rasterizer< COLOR_BUFFER_TYPE >::offset_cache1[2160];
-
-	template< class COLOR_BUFFER_TYPE > int Rasterizer< COLOR_BUFFER_TYPE >::z_cache0[2160];
-	template< class COLOR_BUFFER_TYPE > int Rasterizer< COLOR_BUFFER_TYPE >::z_cache1[2160];
+	template< class COLOR_BUFFER_TYPE >
+	const std::array< typename Rasterizer< COLOR_BUFFER_TYPE >::Fill_Function, 2 * Rasterizer< COLOR_BUFFER_TYPE >::mode_count >
+	Rasterizer< COLOR_BUFFER_TYPE >::fill_functions = Rasterizer< COLOR_BUFFER_TYPE >::make_fill_functions(std::make_index_sequence< 2 * mode_count >());
 
 	template< class  COLOR_BUFFER_TYPE >
-	void Rasterizer< COLOR_BUFFER_TYPE >::fill_convex_polygon
+	template< class DEPTH, class SHADING, class WRITE_MASK, class BLEND, bool COUNT >
+	void Rasterizer< COLOR_BUFFER_TYPE >::fill
 	(
 		const Point4i* const vertices,
 		const int* const indices_begin,
 		const int* const indices_end
 	)
 	{
+		static constexpr unsigned attribute_count = SHADING::attribute_count;
+
 		// Se cachean algunos valores de interés:
 
 		int   pitch = color_buffer.get_width();
-		int* offset_cache0 = this->offset_cache0;
-		int* offset_cache1 = this->offset_cache1;
+		Color* pixels = color_buffer.pixels();
 		const int* indices_back = indices_end - 1;
 
+		// Cada lado usa la caché de offsets, la de z y las de los atributos del sombreado, en ese orden:
+
+		int* caches0[2 + max_attributes] = { offset_cache0.data(), z_cache0.data(), attribute_cache0[0].data(), attribute_cache0[1].data(), attribute_cache0[2].data() };
+		int* caches1[2 + max_attributes] = { offset_cache1.data(), z_cache1.data(), attribute_cache1[0].data(), attribute_cache1[1].data(), attribute_cache1[2].data() };
+
 		// Se busca el vértice de inicio (el que tiene menor Y) y el de terminación (el que tiene mayor Y):
 
 		const int* start_index = indices_begin;
@@ -137,241 +537,175 @@ namespace MScenary
 				}
 		}
 
-		// Se cachean las coordenadas X de los lados que van desde el vértice con Y menor al
+		// Se cachean los valores de los lados que van desde el vértice con Y menor al
 		// vértice con Y mayor en sentido antihorario:
 
 		const int* current_index = start_index;
 		const int* next_index = start_index > indices_begin ? start_index - 1 : indices_back;
 
-		int y0 = vertices[*current_index][1];
-		int y1 = vertices[*next_index][1];
-		int o0 = vertices[*current_index][0] + y0 * pitch;
-		int o1 = vertices[*next_index][0] + y1 * pitch;
-
 		while (true)
 		{
-			interpolate< int64_t, 32 >(offset_cache0, o0, o1, y0, y1);
+			interpolate_edge< SHADING >(caches0, vertices, *current_index, *next_index, pitch);
 
 			if (current_index == indices_begin) current_index = indices_back; else current_index--;
 			if (current_index == end_index) break;
 			if (next_index == indices_begin) next_index = indices_back; else    next_index--;
-
-			y0 = y1;
-			y1 = vertices[*next_index][1];
-			o0 = o1;
-			o1 = vertices[*next_index][0] + y1 * pitch;
 		}
 
-		int end_offset = o1;
+		int end_offset = vertices[*next_index][0] + vertices[*next_index][1] * pitch;
 
-		// Se cachean las coordenadas X de los lados que van desde el vértice con Y menor al
+		// Se cachean los valores de los lados que van desde el vértice con Y menor al
 		// vértice con Y mayor en sentido horario:
 
 		current_index = start_index;
 		next_index = start_index < indices_back ? start_index + 1 : indices_begin;
 
-		y0 = vertices[*current_index][1];
-		y1 = vertices[*next_index][1];
-		o0 = vertices[*current_index][0] + y0 * pitch;
-		o1 = vertices[*next_index][0] + y1 * pitch;
-
 		while (true)
 		{
-			interpolate< int64_t, 32 >(offset_cache1, o0, o1, y0, y1);
+			interpolate_edge< SHADING >(caches1, vertices, *current_index, *next_index, pitch);
 
 			if (current_index == indices_back) current_index = indices_begin; else current_index++;
 			if (current_index == end_index) break;
 			if (next_index == indices_back) next_index = indices_begin; else next_index++;
-
-			y0 = y1;
-			y1 = vertices[*next_index][1];
-			o0 = o1;
-			o1 = vertices[*next_index][0] + y1 * pitch;
 		}
 
+		int o1 = vertices[*next_index][0] + vertices[*next_index][1] * pitch;
+
 		if (o1 > end_offset) end_offset = o1;
 
-		// Se rellenan las scanlines desde la que tiene menor Y hasta la que tiene mayor Y:
+		// Se rellenan las scanlines desde la que tiene menor Y hasta la que tiene mayor Y. Cada una va
+		// del lado con menor offset al de mayor offset, con la z y los atributos del lado en el que empieza:
+
+		int attributes[max_attributes + 1];
+		int attribute_steps[max_attributes + 1];
+
+		// Las cuentas se llevan en locales y se suman a las estadísticas al final. Sin COUNT el compilador quita todo lo que las toca:
 
-		offset_cache0 += start_y;
-		offset_cache1 += start_y;
+		unsigned spans = 0, tested = 0, passed = 0, written = 0;
 
 		for (int y = start_y; y < end_y; y++)
 		{
-			o0 = *offset_cache0++;
-			o1 = *offset_cache1++;
+			int** begin_caches = caches0;
+			int** end_caches = caches1;
 
-			if (o0 < o1)
-			{
-				while (o0 < o1) color_buffer.set_pixel(o0++);
+			if (caches1[0][y] < caches0[0][y]) std::swap(begin_caches, end_caches);
 
-				if (o0 > end_offset) break;
-			}
-			else
-			{
-				while (o1 < o0) color_buffer.set_pixel(o1++);
+			int offset = begin_caches[0][y];
+			int end = end_caches[0][y];
 
-				if (o1 > end_offset) break;
-			}
-		}
-	}
-
-	template< class  COLOR_BUFFER_TYPE >
-	void Rasterizer< COLOR_BUFFER_TYPE >::fill_convex_polygon_z_buffer
-	(
-		const Point4i* const vertices,
-		const int* const indices_begin,
-		const int* const indices_end
-	)
-	{
-		// Se cachean algunos valores de interés:
+			if (offset == end) continue;
 
-		int   pitch = color_buffer.get_width();
-		int* offset_cache0 = this->offset_cache0;
-		int* offset_cache1 = this->offset_cache1;
-		int* z_cache0 = this->z_cache0;
-		int* z_cache1 = this->z_cache1;
-		const int* indices_back = indices_end - 1;
+			// Las scanlines fuera del rectángulo de recorte se saltan:
 
-		// Se busca el vértice de inicio (el que tiene menor Y) y el de terminación (el que tiene mayor Y):
+			if (y < scissor_top || y >= scissor_bottom)
+			{
+				if (end > end_offset) break;
 
-		const int* start_index = indices_begin;
-		int   start_y = vertices[*start_index][1];
-		const int* end_index = indices_begin;
-		int   end_y = start_y;
+				continue;
+			}
 
-		for (const int* index_iterator = start_index; ++index_iterator < indices_end; )
-		{
-			int current_y = vertices[*index_iterator][1];
+			int length = end - offset;
+			int z = begin_caches[1][y];
+			int z_step = (end_caches[1][y] - z) / length;
 
-			if (current_y < start_y)
+			for (unsigned attribute = 0; attribute < attribute_count; attribute++)
 			{
-				start_y = current_y;
-				start_index = index_iterator;
+				attributes[attribute] = begin_caches[2 + attribute][y];
+				attribute_steps[attribute] = (end_caches[2 + attribute][y] - attributes[attribute]) / length;
 			}
-			else
-				if (current_y > end_y)
-				{
-					end_y = current_y;
-					end_index = index_iterator;
-				}
-		}
 
-		// Se cachean las coordenadas X de los lados que van desde el vértice con Y menor al
-		// vértice con Y mayor en sentido antihorario:
-
-		const int* current_index = start_index;
-		const int* next_index = start_index > indices_begin ? start_index - 1 : indices_back;
+			// Y las que lo cruzan se recortan, avanzando la z y los atributos hasta el primer píxel dentro:
 
-		int y0 = vertices[*current_index][1];
-		int y1 = vertices[*next_index][1];
-		int z0 = vertices[*current_index][2];
-		int z1 = vertices[*next_index][2];
-		int o0 = vertices[*current_index][0] + y0 * pitch;
-		int o1 = vertices[*next_index][0] + y1 * pitch;
+			int row = y * pitch;
+			int skipped = std::max(row + scissor_left - offset, 0);
+			int clipped_end = std::min(end, row + scissor_right);
 
-		while (true)
-		{
-			interpolate< int64_t, 32 >(offset_cache0, o0, o1, y0, y1);
-			interpolate< int32_t, 0 >(z_cache0, z0, z1, y0, y1);
+			if (skipped > 0)
+			{
+				offset += skipped;
+				z += z_step * skipped;
 
-			if (current_index == indices_begin) current_index = indices_back; else current_index--;
-			if (current_index == end_index) break;
-			if (next_index == indices_begin) next_index = indices_back; else    next_index--;
+				for (unsigned attribute = 0; attribute < attribute_count; attribute++)
+				{
+					attributes[attribute] += attribute_steps[attribute] * skipped;
+				}
+			}
 
-			y0 = y1;
-			y1 = vertices[*next_index][1];
-			z0 = z1;
-			z1 = vertices[*next_index][2];
-			o0 = o1;
-			o1 = vertices[*next_index][0] + y1 * pitch;
-		}
+			if (COUNT && offset < clipped_end)
+			{
+				spans++;
+				tested += unsigned(clipped_end - offset);
+			}
 
-		int end_offset = o1;
+			for (; offset < clipped_end; offset++)
+			{
+				if (DEPTH::test(z, z_buffer[offset]))
+				{
+					DEPTH::write(z, z_buffer[offset]);
 
-		// Se cachean las coordenadas X de los lados que van desde el vértice con Y menor al
-		// vértice con Y mayor en sentido horario:
+					if (WRITE_MASK::writes_color)
+					{
+						pixels[offset] = BLEND::blend(SHADING::shade(color, attributes), pixels[offset], alpha);
+					}
 
-		current_index = start_index;
-		next_index = start_index < indices_back ? start_index + 1 : indices_begin;
+					if (COUNT)
+					{
+						passed++;
 
-		y0 = vertices[*current_index][1];
-		y1 = vertices[*next_index][1];
-		z0 = vertices[*current_index][2];
-		z1 = vertices[*next_index][2];
-		o0 = vertices[*current_index][0] + y0 * pitch;
-		o1 = vertices[*next_index][0] + y1 * pitch;
+						if (WRITE_MASK::writes_color) written++;
+						if (overdraw) overdraw[offset]++;
+					}
+				}
 
-		while (true)
-		{
-			interpolate< int64_t, 32 >(offset_cache1, o0, o1, y0, y1);
-			interpolate< int32_t, 0 >(z_cache1, z0, z1, y0, y1);
+				z += z_step;
 
-			if (current_index == indices_back) current_index = indices_begin; else current_index++;
-			if (current_index == end_index) break;
-			if (next_index == indices_back) next_index = indices_begin; else next_index++;
+				for (unsigned attribute = 0; attribute < attribute_count; attribute++)
+				{
+					attributes[attribute] += attribute_steps[attribute];
+				}
+			}
 
-			y0 = y1;
-			y1 = vertices[*next_index][1];
-			z0 = z1;
-			z1 = vertices[*next_index][2];
-			o0 = o1;
-			o1 = vertices[*next_index][0] + y1 * pitch;
+			if (end > end_offset) break;
 		}
 
-		if (o1 > end_offset) end_offset = o1;
+		if (COUNT)
+		{
+			stats->spans          += spans;
+			stats->pixels_tested  += tested;
+			stats->pixels_passed  += passed;
+			stats->pixels_written += written;
+		}
+	}
 
-		// Se rellenan las scanlines desde la que tiene menor Y hasta la que tiene mayor Y:
+	template< class  COLOR_BUFFER_TYPE >
+	template< class SHADING >
+	void Rasterizer< COLOR_BUFFER_TYPE >::interpolate_edge
+	(
+		int** caches,
+		const Point4i* const vertices,
+		int index0,
+		int index1,
+		int pitch
+	)
+	{
+		int y0 = vertices[index0][1];
+		int y1 = vertices[index1][1];
 
-		offset_cache0 += start_y;
-		offset_cache1 += start_y;
-		z_cache0 += start_y;
-		z_cache1 += start_y;
+		interpolate< int64_t, 32 >(caches[0], vertices[index0][0] + y0 * pitch, vertices[index1][0] + y1 * pitch, y0, y1);
+		interpolate< int32_t, 0  >(caches[1], vertices[index0][2], vertices[index1][2], y0, y1);
 
-		for (int y = start_y; y < end_y; y++)
+		if (SHADING::attribute_count > 0)
 		{
-			o0 = *offset_cache0++;
-			o1 = *offset_cache1++;
-			z0 = *z_cache0++;
-			z1 = *z_cache1++;
+			int attributes0[max_attributes + 1];
+			int attributes1[max_attributes + 1];
 
-			if (o0 < o1)
-			{
-				int z_step = (z1 - z0) / (o1 - o0);
-
-				while (o0 < o1)
-				{
-					if (z0 < z_buffer[o0])
-					{
-						color_buffer.set_pixel(o0, color);
-						z_buffer[o0] = z0;
-					}
-
-					z0 += z_step;
-					o0++;
-				}
+			SHADING::load(vertex_colors[index0], attributes0);
+			SHADING::load(vertex_colors[index1], attributes1);
 
-				if (o0 > end_offset) break;
+			for (unsigned attribute = 0; attribute < SHADING::attribute_count; attribute++)
+			{
+				interpolate< int32_t, 0 >(caches[2 + attribute], attributes0[attribute], attributes1[attribute], y0, y1);
 			}
-			else
-				if (o1 < o0)
-				{
-					int z_step = (z0 - z1) / (o0 - o1);
-
-					while (o1 < o0)
-					{
-						if (z1 < z_buffer[o1])
-						{
-							color_buffer.set_pixel(o1, color);
-							z_buffer[o1] = z1;
-						}
-
-						z1 += z_step;
-						o1++;
-					}
-
-					if (o1 > end_offset) break;
-				}
 		}
 	}
 
@@ -395,4 +729,4 @@ namespace MScenary
 	}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,152 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "math.hpp"
+#include "Memory_Report.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	class Mesh;
+
+	/**
+	 * @brief Mesh waiting to be drawn, with everything needed to render it.
+	 */
+	struct Draw_Item
+	{
+		const Mesh* mesh;				///< Mesh to render.
+		Matrix44    transform_matrix;	///< Matrix from model coordinates to projection coordinates.
+		Matrix44    model_view_matrix;	///< Matrix from model coordinates to camera coordinates.
+		size_t      lod = 0;			///< Level of detail the mesh is drawn with, picked for the camera of the queue.
+		float       opacity = 1.f;		///< Opacity of the mesh, only used by the translucent layer.
+	};
+
+	/**
+	 * @brief Collects the meshes that survive the culling during a frame and hands them back sorted, so the nearest
+	 * ones are drawn first and the z-buffer rejects as many of the pixels behind them as possible.
+	 *
+	 * Every item gets a 64 bit key, from the most to the least significant bits:
+	 *
+	 *   - 4 bits of layer, the opaque meshes go before anything else.
+	 *   - 28 bits of state, free for material or rasterizer state so items sharing it end up together.
+	 *   - 32 bits of view depth.
+	 *
+	 * The keys are sorted with a radix sort that skips the bytes every key shares, so while the state bits are unused
+	 * only the depth bytes are actually sorted.
+	 */
+	class Render_Queue
+	{
+	public:
+
+		/**
+		 * @brief Groups of items drawn one after another, in this order.
+		 */
+		enum Layer : uint64_t
+		{
+			OPAQUE = 0,
+			TRANSLUCENT = 1,	///< Blended over the opaque meshes without sorting, drawn last.
+		};
+
+	private:
+
+		/**
+		 * @brief Key of an item next to the position of the item, what is actually moved around while sorting.
+		 */
+		struct Sort_Entry
+		{
+			uint64_t key;
+			uint32_t item;
+		};
+
+		vector<Draw_Item>  items;		  ///< Items in the order they were submitted.
+		vector<Sort_Entry> entries;		  ///< Sort keys, sorted by sort().
+		vector<Sort_Entry> sort_buffer;	  ///< Scratch buffer of the radix sort.
+
+	public:
+
+		/**
+		 * @brief Empties the queue for a new frame. The memory is kept, so a queue that has already seen a frame as big doesn't allocate.
+		 */
+		void clear()
+		{
+			items.clear();
+			entries.clear();
+		}
+
+		/**
+		 * @brief Gets the memory of the items and of the sort, which keeps the size of the biggest frame.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(items) + MScenary::get_allocated_bytes(entries) + MScenary::get_allocated_bytes(sort_buffer);
+		}
+
+		/**
+		 * @brief Adds a mesh to the queue.
+		 *
+		 * @param item The mesh and its matrices.
+		 * @param view_depth Distance of the mesh to the camera along the view direction.
+		 * @param layer Group the mesh is drawn with.
+		 * @param state State bits, items with the same layer and depth are ordered by them (only the lowest 28 bits are used).
+		 */
+		void submit(const Draw_Item& item, float view_depth, Layer layer = OPAQUE, uint32_t state = 0);
+
+		/**
+		 * @brief Sorts the items by their keys.
+		 */
+		void sort();
+
+		/**
+		 * @brief Gets the number of items in the queue.
+		 *
+		 * @return The number of items.
+		 */
+		size_t size() const
+		{
+			return entries.size();
+		}
+
+		/**
+		 * @brief Gets an item in sorted order (once sort() has been called).
+		 *
+		 * @param index Position of the item.
+		 * @return The item.
+		 */
+		const Draw_Item& operator [] (size_t index) const
+		{
+			return items[entries[index].item];
+		}
+
+		/**
+		 * @brief Gets the layer of an item in sorted order (once sort() has been called).
+		 *
+		 * @param index Position of the item.
+		 * @return The layer of the item.
+		 */
+		Layer get_layer(size_t index) const
+		{
+			return Layer(entries[index].key >> 60);
+		}
+
+	private:
+
+		/**
+		 * @brief Turns a depth into 32 bits that sort in the same order. The bits of a positive float already do.
+		 *
+		 * @param view_depth The depth.
+		 * @return The quantized depth.
+		 */
+		static uint32_t quantize_depth(float view_depth);
+	};
+}
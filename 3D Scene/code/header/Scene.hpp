@@ -10,11 +10,19 @@
 #include "Rasterizer.hpp"
 #include "math.hpp"
 #include "Color_Buffer.hpp"
+#include "Post_Process.hpp"
+#include "Thread_Pool.hpp"
+#include "Dynamic_Resolution.hpp"
+#include "Scene_View.hpp"
+#include "Frame_Ring.hpp"
+#include "Memory_Report.hpp"
+#include "Cross_Check.hpp"
 
 #include <SFML/Window.hpp>
 
 #include <cstdlib>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <map>
 
@@ -33,14 +41,25 @@ namespace MScenary
 		typedef Rgb888                Color;		///< Alias for 24 bit color type.
 		typedef Color_Buffer< Color > Color_Buffer; ///< Alias for 24 bitcolor buffer type.
 
-		Color_Buffer               color_buffer;	///< Display Color buffer for rendering.
-		Rasterizer< Color_Buffer > rasterizer;		///< Rasterizer for rendering.
+		Color_Buffer                   window_buffer;	   ///< Display Color buffer, at the size of the window, the frame is scaled up into it when rendered smaller.
+		Scene_View                     main_view;		   ///< View of the "camera" node, shown in the window at the resolution picked by the dynamic resolution.
+		vector<Scene_View*>            window_views;	   ///< Views render() draws, only the main view, kept so no list is made every frame.
+		Dynamic_Resolution             dynamic_resolution; ///< Picks the resolution from the time the frames take.
+		vector<Light*>             lights;			 ///< Lights of the current frame.
+		vector<Shadow_Caster>      shadow_casters;	 ///< Meshes that cast shadows in the current frame.
+		vector<std::unique_ptr<Post_Process>> post_processes; ///< Passes applied in order to the finished image before showing it.
+		std::shared_ptr<Frame_Ring>    frame_ring;		   ///< Shared memory the frames shown in the window are rendered into for other processes, if any.
+		std::shared_ptr<Cross_Check>   cross_check;		   ///< Compares every view drawn with the same view drawn through the reference paths, if set.
+		Thread_Pool                thread_pool;		 ///< Threads the views and the post-processes run on, started once with the scene.
 
 		std::map<std::string, std::shared_ptr<Node>> entities;	///< List of nodes in the scene with a unique id to be updated and rendered in scene.
 
-		sf::Window* window; ///< Pointer to the SFML window.
+		std::unique_ptr<sf::Window> window; ///< The SFML window, null for offline scenes.
+
+		size_t peak_frame_bytes = 0;	///< Largest memory of the render targets and the frame buffers so far, the only part that grows once the scene is built.
 
 		bool exit = false; ///< Flag to indicate whether the scene should exit and terminate the window.
+		bool dynamic_scaling = false; ///< Flag to indicate whether the resolution changes to keep the frames within their time budget.
 
 	public:
 
@@ -49,8 +68,9 @@ namespace MScenary
 		*
 		* @param width  The width of the window.
 		* @param height The height of the window.
+		* @param offline True to create the scene without a window, to render it only through render_views(), like a Sequence_Renderer does.
 		*/
-		Scene(unsigned width, unsigned height);
+		Scene(unsigned width, unsigned height, bool offline = false);
 
 		/**
 		 * @brief Gets a node from the scene by its ID.
@@ -77,27 +97,49 @@ namespace MScenary
 
 		/**
 		 * @brief Executes a loop that mantains the scene running, first gets the inputs, then updates the nodes and finally renders them.
+		 * Offline scenes have no window to run in, so it returns right away.
 		 */
 		void run();
 
 		/**
-		 * @brief Gets the height of the window.
+		 * @brief Gets the height of the window, the size it was created with for offline scenes.
 		 *
 		 * @return size_t The height of the window.
 		 */
 		size_t get_window_height()
 		{
-			return window->getSize().y;
+			return window_buffer.get_height();
 		}
 
 		/**
-		 * @brief Gets the width of the window.
+		 * @brief Gets the width of the window, the size it was created with for offline scenes.
 		 *
 		 * @return size_t The width of the window.
 		 */
 		size_t get_window_width()
 		{
-			return window->getSize().x;
+			return window_buffer.get_width();
+		}
+
+		/**
+		 * @brief Renders the scene from several cameras in a single pass, every view into its own target. The nodes, their world matrices,
+		 * the lights and the shadow maps are processed once for all the views, and then the views are culled and drawn in parallel
+		 * on the threads of the scene, one view per thread. The post-processes are applied to every view afterwards.
+		 *
+		 * The nodes aren't updated, that's up to whoever owns the frame, like run().
+		 *
+		 * @param views The views, each one with its camera already set.
+		 */
+		void render_views(const vector<Scene_View*>& views);
+
+		/**
+		 * @brief Gets the view of the "camera" node, the one shown in the window.
+		 *
+		 * @return Scene_View& Reference to the view.
+		 */
+		Scene_View& get_main_view()
+		{
+			return main_view;
 		}
 
 		/**
@@ -107,7 +149,134 @@ namespace MScenary
 		 */
 		Rasterizer< Color_Buffer >& get_rasterizer()
 		{
-			return rasterizer;
+			return main_view.get_rasterizer();
+		}
+
+		/**
+		 * @brief Adds a pass at the end of the post-process stage, applied to every frame after it is rasterized.
+		 *
+		 * @param post_process The pass.
+		 */
+		void add_post_process(std::unique_ptr<Post_Process> post_process)
+		{
+			post_process->set_thread_pool(&thread_pool);
+			post_processes.push_back(std::move(post_process));
+		}
+
+		/**
+		 * @brief Takes a pass out of the post-process stage.
+		 *
+		 * @param post_process The pass, as added.
+		 * @return The pass, or null if it wasn't in the stage.
+		 */
+		std::unique_ptr<Post_Process> remove_post_process(const Post_Process* post_process);
+
+		/**
+		 * @brief Sets a ring of shared memory for other processes to take the frames from. Every frame shown in the window is rendered,
+		 * or scaled up, straight into the next free slot of the ring, unless the reader has every slot and the frame is dropped from it.
+		 *
+		 * The slots take turns, so with a ring the incremental rendering draws every frame whole.
+		 *
+		 * @param ring The ring, with the size of the window, or null to stop sharing the frames.
+		 */
+		void set_frame_ring(std::shared_ptr<Frame_Ring> ring)
+		{
+			frame_ring = ring && ring->is_open() && ring->get_width() == window_buffer.get_width() && ring->get_height() == window_buffer.get_height() ? ring : nullptr;
+		}
+
+		/**
+		 * @brief Sets a cross-check of the render paths. Every view render_views() draws is then drawn again through the reference paths,
+		 * which are much slower, and both images are compared. The results of the last frame are kept in the cross-check.
+		 *
+		 * @param check The cross-check, or null to stop checking.
+		 */
+		void set_cross_check(std::shared_ptr<Cross_Check> check)
+		{
+			cross_check = check;
+		}
+
+		/**
+		 * @brief Enables or disables the 4x multisample anti-aliasing, which is off until enabled. It takes about four times the
+		 * memory and fill time of the plain target. N toggles it while the scene runs.
+		 *
+		 * @param state True to anti-alias the edges of the triangles.
+		 */
+		void set_multisampling(bool state)
+		{
+			main_view.set_multisampling(state);
+		}
+
+		/**
+		 * @brief Enables or disables the incremental rendering. With it only the rectangle around the meshes that moved or changed
+		 * is cleared and drawn again, while the camera and the lights stay still. Without it every frame is drawn whole, which is
+		 * the default. I toggles it while the scene runs.
+		 *
+		 * @param state True to draw only what changed.
+		 */
+		void set_incremental_rendering(bool state)
+		{
+			main_view.set_incremental_rendering(state);
+		}
+
+		/**
+		 * @brief Enables or disables the raster stats of the main view, read through get_main_view().get_stats().
+		 *
+		 * @param interval The frames from a sampled one to the next one, 1 to count every frame or 0 to stop counting.
+		 * @param overdraw True to also fill the overdraw map in the sampled frames.
+		 */
+		void set_raster_stats(unsigned interval, bool overdraw = false)
+		{
+			main_view.set_raster_stats(interval, overdraw);
+		}
+
+		/**
+		 * @brief Reports the memory of the nodes, the meshes, the views and the rest of the render targets, updating the peak.
+		 *
+		 * @return The report, with the peaks so far.
+		 */
+		Memory_Report report_memory();
+
+		/**
+		 * @brief Adds up the memory of the render targets and the frame buffers, the ones in the "targets" group and the main view
+		 * of the reports, without building any report.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_frame_bytes() const;
+
+		/**
+		 * @brief Gets the number of lights of the frame with a shadow map, the most a view can light the meshes with.
+		 *
+		 * @return The number of shadow maps.
+		 */
+		size_t get_shadow_map_count() const;
+
+		/**
+		 * @brief Writes a memory report of the scene as a table.
+		 *
+		 * @param stream Where to write it.
+		 */
+		void dump_memory(std::ostream& stream)
+		{
+			report_memory().dump(stream);
+		}
+
+		/**
+		 * @brief Enables or disables the dynamic resolution. Without it the scene is always rendered at the size of the window.
+		 *
+		 * @param state True to scale the resolution with the frame times.
+		 * @param frame_budget The time a frame should take, in seconds.
+		 */
+		void set_dynamic_resolution(bool state, float frame_budget = 1.f / 60.f);
+
+		/**
+		 * @brief Gets the occlusion buffer of the scene.
+		 *
+		 * @return Occlusion_Buffer& Reference to the occlusion buffer.
+		 */
+		Occlusion_Buffer& get_occlusion_buffer()
+		{
+			return main_view.get_occlusion_buffer();
 		}
 
 		/**
@@ -133,10 +302,21 @@ namespace MScenary
 		void update();
 
 		/**
-		 * @brief Renders all the nodes in the scene, passing along the light source and the camera matrix for calculations in the meshes.
+		 * @brief Renders all the nodes in the scene from the "camera" node and shows the frame in the window. The nodes add their visible
+		 * meshes to the render queue with the camera matrices, and then the queue is drawn front to back passing along the light grid for
+		 * calculations in the meshes. The translucent meshes go last, accumulated in the transparency buffer and blended over the rest at once.
+		 *
+		 * With incremental rendering, everything outside the rectangle that changed since the last frame is kept as it was.
 		 */
 		void render();
 
+		/**
+		 * @brief Draws the views again through the reference paths of the cross-check and compares them with the ones already drawn.
+		 *
+		 * @param views The views, already drawn and post-processed.
+		 */
+		void cross_check_views(const vector<Scene_View*>& views);
+
 		/**
 		 * @brief Creates all the nodes in the scene as well as setting their parameters like position, variables and rotation.
 		 */
@@ -0,0 +1,400 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Rasterizer.hpp"
+#include "math.hpp"
+#include "Color_Buffer.hpp"
+#include "Occlusion_Buffer.hpp"
+#include "Render_Queue.hpp"
+#include "Light_Grid.hpp"
+#include "Multisample_Buffer.hpp"
+#include "Transparency_Buffer.hpp"
+#include "Dirty_Region.hpp"
+#include "Frame_Arena.hpp"
+#include "Raster_Stats.hpp"
+#include "Memory_Report.hpp"
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MScenary
+{
+	using  std::vector;
+	using argb::Rgb888;
+
+	class Light;
+	class Mesh;
+	class Node;
+
+	/**
+	 * @brief A camera looking at the scene, with everything needed to draw what it sees into a target of its own.
+	 *
+	 * The scene draws a list of views in a single pass. What doesn't depend on the camera, like the world matrices of the nodes,
+	 * the lights and the shadow maps, is done once for all of them, and then the views are drawn at the same time from different
+	 * threads. That's why everything a camera changes while drawing lives here instead of in the scene or the nodes: the targets,
+	 * the occlusion buffer, the render queue, the light grid, the dirty region and the level of detail picked for every mesh.
+	 */
+	class Scene_View
+	{
+		friend class Scene;
+
+	public:
+
+		typedef Rgb888                      Color;		  ///< Alias for 24 bit color type.
+		typedef argb::Color_Buffer< Color > Color_Buffer; ///< Alias for 24 bit color buffer type.
+		typedef std::unordered_map<const Mesh*, size_t> Lod_Map; ///< Level of detail of every mesh drawn.
+
+		/**
+		 * @brief Everything a frame is rendered into, all of it at the size of the view.
+		 *
+		 * The multisampled and the transparency targets take several times the memory of the color buffer, so they're only created
+		 * the first time a frame needs them: the first one drawn with anti-aliasing and the first one with translucent meshes.
+		 */
+		struct Frame_Targets
+		{
+			Color_Buffer                         color_buffer;			///< Color buffer the frame is rendered into.
+			Rasterizer< Color_Buffer >           rasterizer;			///< Rasterizer for rendering.
+			std::unique_ptr<Multisample_Buffer>  multisample_buffer;	///< 4x multisampled target used instead of the rasterizer when anti-aliasing is enabled.
+			std::unique_ptr<Transparency_Buffer> transparency_buffer;	///< Accumulation and revealage of the translucent meshes, composited over the opaque ones.
+
+			Frame_Targets(unsigned width, unsigned height)
+				:
+				color_buffer(width, height),
+				rasterizer(color_buffer)
+			{
+			}
+		};
+
+	private:
+
+		std::unique_ptr<Frame_Targets> targets;					///< Render targets at the size of the view.
+		Matrix44                       view_matrix;				///< View matrix of the camera.
+		Matrix44                       perspective_matrix;		///< Perspective of the camera alone, without the view matrix.
+		Matrix44                       projection_matrix;		///< Projection matrix of the camera, already multiplied by the view matrix.
+		Occlusion_Buffer               occlusion_buffer;		///< Low resolution depth of the occluders, to skip the meshes hidden behind them.
+		Render_Queue                   render_queue;			///< Meshes to draw in the current frame, sorted front to back.
+		Light_Grid                     light_grid;				///< Lights of the current frame assigned to the screen tiles they reach.
+		Dirty_Region                   dirty_region;			///< Part of the frame that changed since the last one, the only one drawn again.
+		Matrix44                       drawn_view_matrix;		///< View matrix of the last frame drawn.
+		Matrix44                       drawn_projection_matrix;	///< Projection matrix of the last frame drawn.
+		vector<float>                  drawn_light_state;		///< Positions, directions and intensities of the lights in the last frame drawn.
+		vector<float>                  light_state;				///< Same as drawn_light_state for the current frame.
+		Lod_Map                        mesh_lods;				///< Level of detail every mesh was last drawn with, kept for the hysteresis.
+		Frame_Arena                    arena;					///< Scratch memory of the meshes drawn for the view, whichever thread draws it.
+		Raster_Stats                   stats;					///< Counters of the last sampled frame.
+		Overdraw_Map                   overdraw_map;			///< Times every pixel was shaded in the last sampled frame.
+		Raster_Stats*                  frame_stats = nullptr;	///< Counters of the frame being drawn, null unless it's sampled.
+
+		unsigned stats_interval = 0;		///< Frames from a sampled one to the next one, 0 to never count.
+		unsigned stats_countdown = 0;		///< Frames left until the next sampled one.
+
+		bool multisampling = false;			///< Flag to indicate whether the frame is drawn with 4x multisample anti-aliasing.
+		bool incremental_rendering = false;	///< Flag to indicate whether only the part of the frame that changed is drawn again.
+		bool overdraw = false;				///< Flag to indicate whether the sampled frames also fill the overdraw map.
+		bool occlusion_culling = true;		///< Flag to indicate whether the meshes hidden behind the occluders are skipped.
+
+	public:
+
+		/**
+		 * @brief Creates a view with its targets, looking from the origin until a camera is set.
+		 *
+		 * @param width The width of the target.
+		 * @param height The height of the target.
+		 */
+		Scene_View(unsigned width, unsigned height);
+
+		/**
+		 * @brief Sets the camera the next frame is drawn from.
+		 *
+		 * @param new_view_matrix The view matrix.
+		 * @param new_perspective_matrix The perspective of the camera alone, like the one of Camera::get_perspective_matrix().
+		 */
+		void set_camera(const Matrix44& new_view_matrix, const Matrix44& new_perspective_matrix)
+		{
+			view_matrix = new_view_matrix;
+			perspective_matrix = new_perspective_matrix;
+			projection_matrix = new_perspective_matrix * new_view_matrix;
+		}
+
+		/**
+		 * @brief Creates the targets at a new size, nothing is done if they already have it.
+		 *
+		 * @param width The width to render at.
+		 * @param height The height to render at.
+		 */
+		void resize(unsigned width, unsigned height);
+
+		/**
+		 * @brief Makes the frame be drawn into memory outside of the view, like a slot of a Frame_Ring, instead of its own color buffer.
+		 * The memory isn't kept after a resize.
+		 *
+		 * @param pixels The memory, with room for a frame of the size of the view, or null to draw into the color buffer again.
+		 */
+		void set_target_memory(Color* pixels)
+		{
+			Color_Buffer& color_buffer = targets->color_buffer;
+			Color*        previous = color_buffer.pixels();
+
+			color_buffer.set_memory(pixels);
+
+			// Whatever is in the new memory is from another frame, if anything, so nothing of it can be kept.
+
+			if (color_buffer.pixels() != previous) dirty_region.invalidate();
+		}
+
+		/**
+		 * @brief Enables or disables the 4x multisample anti-aliasing.
+		 *
+		 * @param state True to anti-alias the edges of the triangles.
+		 */
+		void set_multisampling(bool state)
+		{
+			if (state != multisampling) dirty_region.invalidate();
+
+			multisampling = state;
+
+			// The multisampled target is the largest one, it isn't kept while it's not used.
+
+			if (!state && targets) targets->multisample_buffer.reset();
+		}
+
+		bool is_multisampling_enabled() const
+		{
+			return multisampling;
+		}
+
+		/**
+		 * @brief Enables or disables the incremental rendering. With it only the rectangle around the meshes that moved or changed
+		 * is cleared and drawn again, while the camera and the lights stay still. Without it every frame is drawn whole.
+		 *
+		 * @param state True to draw only what changed.
+		 */
+		void set_incremental_rendering(bool state)
+		{
+			incremental_rendering = state;
+		}
+
+		bool is_incremental_rendering_enabled() const
+		{
+			return incremental_rendering;
+		}
+
+		/**
+		 * @brief Enables or disables the occlusion culling. Without it the occluders aren't drawn and every mesh in the view is drawn,
+		 * which should give the same image only slower.
+		 *
+		 * @param state True to skip the meshes hidden behind the occluders.
+		 */
+		void set_occlusion_culling(bool state)
+		{
+			occlusion_culling = state;
+		}
+
+		bool is_occlusion_culling_enabled() const
+		{
+			return occlusion_culling;
+		}
+
+		/**
+		 * @brief Gets the levels of detail the meshes were last drawn with, which decide the ones picked in the next frame.
+		 *
+		 * @return The level of every mesh drawn.
+		 */
+		const Lod_Map& get_lods() const
+		{
+			return mesh_lods;
+		}
+
+		/**
+		 * @brief Makes the view pick the same levels of detail in its next frame as another view with these last levels.
+		 *
+		 * @param lods The levels, like the ones of get_lods().
+		 */
+		void set_lods(const Lod_Map& lods)
+		{
+			mesh_lods = lods;
+		}
+
+		/**
+		 * @brief Enables or disables the raster stats. Only one frame every interval is counted, the rest are drawn without any counting
+		 * at all, so a long interval costs next to nothing. With incremental rendering only the part of the frame drawn again is counted.
+		 *
+		 * @param interval The frames from a sampled one to the next one, 1 to count every frame or 0 to stop counting.
+		 * @param with_overdraw True to also count how many times every pixel is shaded in the sampled frames.
+		 */
+		void set_raster_stats(unsigned interval, bool with_overdraw = false)
+		{
+			stats_interval = interval;
+			stats_countdown = 0;
+			overdraw = with_overdraw;
+		}
+
+		/**
+		 * @brief Gets the counters of the last sampled frame.
+		 *
+		 * @return The stats, all zeros until a frame has been sampled.
+		 */
+		const Raster_Stats& get_stats() const
+		{
+			return stats;
+		}
+
+		/**
+		 * @brief Gets the counters of the frame being drawn, for the nodes to count what they skip.
+		 *
+		 * @return The stats, or null when the frame isn't sampled.
+		 */
+		Raster_Stats* get_frame_stats()
+		{
+			return frame_stats;
+		}
+
+		/**
+		 * @brief Gets how many times every pixel was shaded in the last sampled frame with the overdraw enabled.
+		 *
+		 * @return Overdraw_Map& Reference to the overdraw map, which can be resolved into a heatmap.
+		 */
+		const Overdraw_Map& get_overdraw_map() const
+		{
+			return overdraw_map;
+		}
+
+		/**
+		 * @brief Adds a group for the view with the memory of its targets, buffers and frame arena, all of it sized by the resolution
+		 * and the load of the frames.
+		 *
+		 * @param report The report.
+		 * @param name The name of the group.
+		 */
+		void report_memory(Memory_Report& report, const std::string& name) const;
+
+		/**
+		 * @brief Adds up the memory report_memory() reports, without building any report, cheap enough to check every frame.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const;
+
+		const Matrix44& get_view_matrix() const
+		{
+			return view_matrix;
+		}
+
+		const Matrix44& get_perspective_matrix() const
+		{
+			return perspective_matrix;
+		}
+
+		const Matrix44& get_projection_matrix() const
+		{
+			return projection_matrix;
+		}
+
+		/**
+		 * @brief Gets how many pixels a unit of length covers at a unit of distance from the camera, to know the size of the meshes
+		 * on screen.
+		 *
+		 * @return The scale of the perspective in pixels.
+		 */
+		float get_pixels_per_unit() const
+		{
+			return std::abs(perspective_matrix[1][1]) * float(get_height()) * 0.5f;
+		}
+
+		unsigned get_width() const
+		{
+			return targets->color_buffer.get_width();
+		}
+
+		unsigned get_height() const
+		{
+			return targets->color_buffer.get_height();
+		}
+
+		/**
+		 * @brief Gets the image of the view, valid once the scene has drawn it.
+		 *
+		 * @return Color_Buffer& Reference to the color buffer.
+		 */
+		Color_Buffer& get_color_buffer()
+		{
+			return targets->color_buffer;
+		}
+
+		const Color_Buffer& get_color_buffer() const
+		{
+			return targets->color_buffer;
+		}
+
+		/**
+		 * @brief Gets the rasterizer of the view.
+		 *
+		 * @return Rasterizer<Color_Buffer>& Reference to the rasterizer.
+		 */
+		Rasterizer< Color_Buffer >& get_rasterizer()
+		{
+			return targets->rasterizer;
+		}
+
+		const Rasterizer< Color_Buffer >& get_rasterizer() const
+		{
+			return targets->rasterizer;
+		}
+
+		/**
+		 * @brief Gets the occlusion buffer of the view.
+		 *
+		 * @return Occlusion_Buffer& Reference to the occlusion buffer.
+		 */
+		Occlusion_Buffer& get_occlusion_buffer()
+		{
+			return occlusion_buffer;
+		}
+
+		/**
+		 * @brief Gets the queue the nodes add their meshes to.
+		 *
+		 * @return Render_Queue& Reference to the render queue.
+		 */
+		Render_Queue& get_render_queue()
+		{
+			return render_queue;
+		}
+
+		/**
+		 * @brief Picks the level of detail of a mesh for this view, with the hysteresis of the level it was drawn with in it last.
+		 *
+		 * @param mesh The mesh.
+		 * @param screen_radius Radius in pixels of the projected bounding sphere of the mesh.
+		 * @return The level to draw the mesh with.
+		 */
+		size_t select_lod(const Mesh& mesh, float screen_radius);
+
+	private:
+
+		/**
+		 * @brief Culls and draws the nodes from the camera of the view. Only the view is changed, so several views can be drawn at once.
+		 *
+		 * @param nodes The nodes of the scene, with their world matrices already updated.
+		 * @param lights The lights of the scene, with their world positions and shadow maps already updated.
+		 * @param redraw True to draw the whole frame even if nothing in the view has changed, like when the shadows do.
+		 */
+		void render(const std::map<std::string, std::shared_ptr<Node>>& nodes, const vector<Light*>& lights, bool redraw);
+
+		/**
+		 * @brief Clears and draws the meshes of the render queue inside a rectangle of the frame, resolving and compositing it.
+		 *
+		 * @param region The pixels to draw, the whole frame unless only part of it changed.
+		 */
+		void draw_region(const Screen_Rect& region);
+	};
+}
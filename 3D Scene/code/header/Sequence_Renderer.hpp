@@ -0,0 +1,225 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Scene_View.hpp"
+#include "math.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	class Scene;
+
+	/**
+	 * @brief Pose of the camera at a point of a sequence, the rest of the poses are interpolated between the keyframes.
+	 */
+	struct Camera_Keyframe
+	{
+		float    time;		///< Time of the pose in seconds from the start of the sequence.
+		Vector3f position;	///< Position of the camera, like the one set in its transform.
+		Vector3f rotation;	///< Euler angles of the camera, like the ones set in its transform.
+	};
+
+	/**
+	 * @brief Renders a camera path through a scene offline, as fast as the machine allows, into numbered images or a video stream.
+	 *
+	 * The frames of a sequence only differ in the camera, so they don't depend on each other and are drawn in batches, one
+	 * frame per view of Scene::render_views() and so one per thread, every view with its own targets and rasterizer. The nodes
+	 * aren't updated while rendering, the scene holds still as the camera flies through it.
+	 *
+	 * The frames drawn are queued for a writer thread started once per sequence, which writes them in order and gives their views
+	 * back as it goes, so the disk doesn't stall the rendering. Every batch takes the views that are free, and new ones are only
+	 * created while the writer holds on to the others and there are fewer than the limit. Every view has targets of the size of
+	 * the frames, so the limit is what bounds the memory.
+	 */
+	class Sequence_Renderer
+	{
+	public:
+
+		typedef Scene_View::Color_Buffer Color_Buffer;	///< Alias for 24 bit color buffer type.
+
+		/**
+		 * @brief What the frames are written as.
+		 */
+		enum Output_Format
+		{
+			PPM_IMAGES,		///< A binary PPM file per frame, numbered from 0.
+			Y4M_STREAM,		///< A single YUV4MPEG2 stream with 4:2:0 full range chroma, which most encoders and players take as it is.
+			NO_OUTPUT,		///< Nothing, the frames are only drawn, like when the scene cross-checks them.
+		};
+
+	private:
+
+		Scene&                  scene;			///< Scene to render.
+		vector<Camera_Keyframe> keyframes;		///< Path of the camera, sorted by time.
+		Matrix44                perspective_matrix;	///< Perspective of the camera, the one of the "camera" node of the scene.
+		unsigned                width;			///< Width of the frames.
+		unsigned                height;			///< Height of the frames.
+		unsigned                frame_rate;		///< Frames per second of the sequence.
+		unsigned                batch_size;		///< Frames drawn at once, one per thread.
+		unsigned                view_limit;		///< Most views alive at once, the ones drawn and the ones waiting to be written.
+		bool                    multisampling;	///< Whether the frames are drawn with 4x multisample anti-aliasing.
+		bool                    fxaa;			///< Whether the frames are anti-aliased with FXAA after they're drawn.
+
+		/**
+		 * @brief A frame drawn and waiting for the writer.
+		 */
+		struct Pending_Frame
+		{
+			Scene_View* view;		///< View the frame was drawn into, given back once it's written.
+			unsigned    number;		///< Number of the frame in the sequence.
+		};
+
+		vector<std::unique_ptr<Scene_View>> views;			///< Every view created so far, at most view_limit.
+		vector<Scene_View*>                 free_views;		///< Views neither being drawn nor waiting to be written.
+		vector<Scene_View*>                 batch;			///< Views of the batch being drawn.
+		std::deque<Pending_Frame>           pending_frames;	///< Frames drawn and not written yet, in order.
+		std::mutex                          mutex;			///< Guards the free views, the pending frames and the end of the sequence.
+		std::condition_variable             frame_pending;	///< Wakes the writer when a frame is queued or the sequence ends.
+		std::condition_variable             view_freed;		///< Wakes the renderer when the writer gives a view back.
+		bool                                finished;		///< Set when every frame is queued, so the writer stops once the queue is empty.
+		std::atomic<bool>                   failed;			///< Set when a frame couldn't be written, so nothing else is drawn.
+		vector<uint8_t>                     planes;			///< Luma and chroma planes of a frame of the Y4M stream, reused from frame to frame.
+
+	public:
+
+		/**
+		 * @brief Creates a renderer of sequences of a scene, with the perspective of its "camera" node.
+		 *
+		 * @param scene The scene, which can be offline.
+		 * @param width The width of the frames.
+		 * @param height The height of the frames.
+		 * @param frame_rate The frames per second of the sequence.
+		 */
+		Sequence_Renderer(Scene& scene, unsigned width, unsigned height, unsigned frame_rate = 30);
+
+		/**
+		 * @brief Adds a pose to the path of the camera. The keyframes can be added in any order.
+		 *
+		 * @param time The time of the pose in seconds.
+		 * @param position The position of the camera.
+		 * @param rotation The euler angles of the camera.
+		 */
+		void add_keyframe(float time, const Vector3f& position, const Vector3f& rotation);
+
+		/**
+		 * @brief Sets how many frames are drawn at once. By default one per hardware thread.
+		 *
+		 * @param frames The number of frames, at least 1.
+		 */
+		void set_batch_size(unsigned frames);
+
+		/**
+		 * @brief Sets how many views can be alive at once, counting the ones drawn and the ones waiting to be written. By default
+		 * one per frame of a batch and two more for the writer. Below the batch size the batches are smaller.
+		 *
+		 * @param limit The number of views, at least 1.
+		 */
+		void set_view_limit(unsigned limit);
+
+		/**
+		 * @brief Enables or disables the 4x multisample anti-aliasing of the frames.
+		 *
+		 * @param state True to anti-alias the edges of the triangles.
+		 */
+		void set_multisampling(bool state)
+		{
+			multisampling = state;
+		}
+
+		/**
+		 * @brief Enables or disables the FXAA of the frames. The pass is added to the post-processes of the scene while the
+		 * sequence renders and taken out after it, on top of any the scene already has.
+		 *
+		 * @param state True to anti-alias the finished frames.
+		 */
+		void set_fxaa(bool state)
+		{
+			fxaa = state;
+		}
+
+		/**
+		 * @brief Gets the number of frames of the sequence, from the first keyframe to the last one both included.
+		 *
+		 * @return The number of frames, 0 without keyframes.
+		 */
+		unsigned get_frame_count() const;
+
+		/**
+		 * @brief Renders the whole sequence and writes it.
+		 *
+		 * @param path The file of the Y4M stream, or the start of the name of the images, which end in a number of 5 digits and ".ppm".
+		 * Ignored without output.
+		 * @param format What the frames are written as.
+		 * @return False if anything couldn't be written.
+		 */
+		bool render(const std::string& path, Output_Format format);
+
+	private:
+
+		/**
+		 * @brief Takes the views of the next batch: the free ones first, then new ones while there's room for them, and if none is
+		 * left it waits for the writer to give one back.
+		 *
+		 * @param frames The frames left to draw.
+		 */
+		void take_views(unsigned frames);
+
+		/**
+		 * @brief Gives views back to the free ones.
+		 *
+		 * @param given The views.
+		 */
+		void give_views(const vector<Scene_View*>& given);
+
+		/**
+		 * @brief Loop of the writer thread, writing the frames queued in order until the sequence ends.
+		 *
+		 * @param path The path given to render().
+		 * @param format What the frames are written as.
+		 * @param stream The Y4M stream, with the header already written.
+		 */
+		void write_frames(const std::string& path, Output_Format format, std::ofstream& stream);
+
+		/**
+		 * @brief Interpolates the pose of the camera between the keyframes around a time.
+		 *
+		 * @param time The time in seconds.
+		 * @return The view matrix of the camera.
+		 */
+		Matrix44 sample_view_matrix(float time) const;
+
+		/**
+		 * @brief Writes a frame as a binary PPM file.
+		 *
+		 * @param path The file.
+		 * @param frame The image.
+		 * @return False if the file couldn't be written.
+		 */
+		static bool write_ppm(const std::string& path, const Color_Buffer& frame);
+
+		/**
+		 * @brief Converts a frame to YCbCr 4:2:0 and appends it to the Y4M stream.
+		 *
+		 * @param stream The stream, with the header already written.
+		 * @param frame The image.
+		 * @return False if the frame couldn't be written.
+		 */
+		bool write_y4m_frame(std::ofstream& stream, const Color_Buffer& frame);
+	};
+}
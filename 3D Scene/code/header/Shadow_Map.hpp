@@ -0,0 +1,131 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Depth_Rasterizer.hpp"
+#include "math.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	class Light;
+	class Mesh;
+
+	/**
+	 * @brief Mesh that casts shadows, with the matrix that places it in the scene.
+	 */
+	struct Shadow_Caster
+	{
+		Mesh*    mesh;			///< Mesh to render into the shadow maps.
+		Matrix44 model_matrix;	///< Matrix from model coordinates to scene coordinates.
+	};
+
+	/**
+	 * @brief Depth of the shadow casters seen from a light, used to know which vertices the light doesn't reach.
+	 *
+	 * The casters are rendered through a depth only Rasterizer, with a projection fitted to the sphere that encloses all of them:
+	 * an orthographic one for directional lights and a perspective one looking at the sphere for point lights. The map is only
+	 * rendered again when the light, the set of casters or any of their matrices change, otherwise the last one is reused.
+	 */
+	class Shadow_Map
+	{
+		static constexpr float max_field_of_view = 2.1f;	///< Widest angle of the projection of point lights, used when the light is among the casters.
+
+		Depth_Target               target;			 ///< Depth only render target.
+		Rasterizer< Depth_Target > rasterizer;		 ///< Rasterizer the casters are rendered with, its z-buffer is the shadow map.
+
+		Matrix44 light_matrix;		///< Matrix from scene coordinates to the projection coordinates of the light.
+
+		uint64_t cached_key;		///< Hash of the light and casters the map was last rendered with.
+		bool     has_casters;		///< Whether the map holds anything, otherwise everything is lit.
+		bool     pcf;				///< Whether the lookups average the 3x3 texels around the point.
+		float    depth_bias;		///< Depth offset in projection coordinates that keeps the surfaces from shadowing themselves.
+
+	public:
+
+		/**
+		 * @brief Creates a square shadow map.
+		 *
+		 * @param resolution The width and height of the map in texels.
+		 */
+		Shadow_Map(unsigned resolution = 512);
+
+		/**
+		 * @brief Renders the casters from the light if anything changed since the last time. Nothing of it depends on the camera,
+		 * so a single map serves every view of the frame.
+		 *
+		 * @param light The light, with its world position already updated.
+		 * @param casters Every mesh that casts shadows.
+		 * @return True if the map had to be rendered again.
+		 */
+		bool update(const Light& light, const vector<Shadow_Caster>& casters);
+
+		/**
+		 * @brief Builds the matrix that takes the points of a camera to the map. The camera can move without the map changing,
+		 * so every view builds it every frame.
+		 *
+		 * @param view_matrix The view matrix of the camera the lookups come from.
+		 * @return The matrix from camera coordinates to the display coordinates of the shadow map.
+		 */
+		Matrix44 get_lookup_matrix(const Matrix44& view_matrix) const;
+
+		/**
+		 * @brief Finds how much of the light reaches a batch of points, with every component in its own array.
+		 *
+		 * @param lookup_matrix The matrix returned by get_lookup_matrix() for the camera of the points.
+		 * @param x, y, z Components of the points in camera coords.
+		 * @param visibility Where the result for every point is written, 0 in shadow and 1 lit.
+		 * @param count Number of points.
+		 */
+		void calculate_visibility(const Matrix44& lookup_matrix, const float* x, const float* y, const float* z, float* visibility, size_t count) const;
+
+		/**
+		 * @brief Enables or disables percentage closer filtering, which softens the edges of the shadows at the cost of 9 lookups per point.
+		 *
+		 * @param state True to filter.
+		 */
+		void set_pcf(bool state)
+		{
+			pcf = state;
+		}
+
+		/**
+		 * @brief Sets the depth offset applied before comparing against the map.
+		 *
+		 * @param bias The offset in projection coordinates.
+		 */
+		void set_depth_bias(float bias)
+		{
+			depth_bias = bias;
+		}
+
+		/**
+		 * @brief Gets the memory of the map and of the rasterizer that draws it.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return target.get_allocated_bytes() + rasterizer.get_allocated_bytes();
+		}
+
+	private:
+
+		/**
+		 * @brief Hashes everything the content of the map depends on.
+		 *
+		 * @param light The light.
+		 * @param casters The casters.
+		 * @return The hash.
+		 */
+		static uint64_t calculate_key(const Light& light, const vector<Shadow_Caster>& casters);
+	};
+}
@@ -0,0 +1,117 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+
+	/**
+	 * @brief Threads started once and kept waiting for work, so the parallel parts of a frame don't pay for starting and
+	 * joining threads every time.
+	 *
+	 * The work is a number of items, every thread takes the next free one until none is left. The calling thread takes its
+	 * share too and returns once every item is done. Only one job runs at a time: a job started from inside another one, or
+	 * while another thread has one running, is done entirely by the thread that starts it. The threads run the same kernels,
+	 * vectorized or plain, as the thread that starts the job.
+	 */
+	class Thread_Pool
+	{
+		typedef void (*Job_Function)(void* context, unsigned item);	///< Calls the function of a job for an item.
+
+		vector<std::thread>     threads;		///< Threads waiting for work, the calling thread is not among them.
+		std::mutex              mutex;			///< Guards the job and the counts below.
+		std::condition_variable job_ready;		///< Wakes the threads when a job starts or the pool closes.
+		std::condition_variable job_done;		///< Wakes the thread that started the job when the last thread leaves it.
+
+		Job_Function          job_function;		///< Function of the current job, null when there's none.
+		void*                 job_context;		///< Callable the function calls.
+		unsigned              job_items;		///< Number of items of the current job.
+		std::atomic<unsigned> next_item;		///< Next item nobody has taken.
+		uint64_t              job_number;		///< Number of jobs started, so every thread joins every job once.
+		unsigned              busy_threads;		///< Threads of the pool working on the current job.
+		bool                  job_vectorized;	///< Whether the thread that started the job runs the vectorized kernels, the pool runs the same ones.
+		std::atomic<bool>     running;			///< Set while a job runs.
+		bool                  closing;			///< Set when the pool is destroyed, to stop the threads.
+
+	public:
+
+		/**
+		 * @brief Starts the threads.
+		 *
+		 * @param thread_count The threads that work on every job, the calling one included. 0 takes one per hardware thread.
+		 */
+		explicit Thread_Pool(unsigned thread_count = 0);
+
+		/**
+		 * @brief Stops the threads, after the job running if any.
+		 */
+		~Thread_Pool();
+
+		Thread_Pool(const Thread_Pool&) = delete;
+		Thread_Pool& operator = (const Thread_Pool&) = delete;
+
+		/**
+		 * @brief Gets the threads that work on every job.
+		 *
+		 * @return The number of threads, the calling one included.
+		 */
+		unsigned get_thread_count() const
+		{
+			return unsigned(threads.size()) + 1;
+		}
+
+		/**
+		 * @brief Calls a function for every item of a job in parallel and waits until all of them are done. The function
+		 * is only referenced, nothing is allocated.
+		 *
+		 * @param item_count The number of items.
+		 * @param function Called with the index of every item, from several threads at once.
+		 */
+		template< typename FUNCTION >
+		void for_each(unsigned item_count, FUNCTION&& function)
+		{
+			typedef typename std::remove_reference< FUNCTION >::type Function;
+
+			run
+			(
+				item_count,
+				[](void* context, unsigned item) { (*static_cast<Function*>(context))(item); },
+				const_cast<void*>(static_cast<const void*>(&function))
+			);
+		}
+
+	private:
+
+		/**
+		 * @brief Runs a job on the calling thread and on the pool.
+		 *
+		 * @param item_count The number of items.
+		 * @param function Called for every item.
+		 * @param context Passed to the function.
+		 */
+		void run(unsigned item_count, Job_Function function, void* context);
+
+		/**
+		 * @brief Takes items of the current job until none is left.
+		 */
+		void work(Job_Function function, void* context, unsigned item_count);
+
+		/**
+		 * @brief Loop of every thread of the pool, waiting for jobs until it closes.
+		 */
+		void wait_for_jobs();
+	};
+}
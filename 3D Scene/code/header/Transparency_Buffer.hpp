@@ -0,0 +1,119 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+#include "Color_Buffer.hpp"
+#include "math.hpp"
+#include "Memory_Report.hpp"
+
+#include <vector>
+
+namespace MScenary
+{
+	using std::vector;
+	using argb::Rgb888;
+
+	/**
+	 * @brief Target of the translucent triangles, drawn after the opaque ones with weighted blended order independent transparency.
+	 *
+	 * Every translucent triangle adds its premultiplied color, weighted by its depth, to an accumulation buffer and multiplies the
+	 * revealage of the pixels it covers by its transparency. Both operations give the same result in any order, so the triangles
+	 * are never sorted. The composite then divides the accumulated color by the accumulated weight and blends it over the opaque
+	 * image by how much of it is still revealed.
+	 *
+	 * The triangles are tested against the depth of the opaque ones but don't write it, so they never hide each other.
+	 */
+	class Transparency_Buffer
+	{
+		unsigned width;					///< Width in pixels.
+		unsigned height;				///< Height in pixels.
+
+		vector<float> accumulated_red;		///< Weighted sum of the premultiplied red of every pixel.
+		vector<float> accumulated_green;	///< Weighted sum of the premultiplied green of every pixel.
+		vector<float> accumulated_blue;		///< Weighted sum of the premultiplied blue of every pixel.
+		vector<float> accumulated_alpha;	///< Weighted sum of the alpha of every pixel.
+		vector<float> revealage;			///< Product of the transparency of everything drawn on every pixel, 1 where nothing was.
+
+		unsigned dirty_begin;			///< First row drawn into since the last clear.
+		unsigned dirty_end;				///< End of the rows drawn into since the last clear, the only ones cleared and composited.
+
+		int scissor_left;				///< First column drawn into.
+		int scissor_top;				///< First row drawn into.
+		int scissor_right;				///< Column after the last one drawn into.
+		int scissor_bottom;				///< Row after the last one drawn into.
+
+	public:
+
+		/**
+		 * @brief Creates the buffers for a target of the given size.
+		 *
+		 * @param width The width in pixels.
+		 * @param height The height in pixels.
+		 */
+		Transparency_Buffer(unsigned width, unsigned height);
+
+		unsigned get_width() const
+		{
+			return width;
+		}
+
+		unsigned get_height() const
+		{
+			return height;
+		}
+
+		/**
+		 * @brief Gets the memory of the accumulation and revealage planes.
+		 *
+		 * @return The size in bytes.
+		 */
+		size_t get_allocated_bytes() const
+		{
+			return MScenary::get_allocated_bytes(accumulated_red) + MScenary::get_allocated_bytes(accumulated_green) + MScenary::get_allocated_bytes(accumulated_blue)
+				+ MScenary::get_allocated_bytes(accumulated_alpha) + MScenary::get_allocated_bytes(revealage);
+		}
+
+		/**
+		 * @brief Limits the triangles to a rectangle. Nothing is accumulated outside it, so the composite leaves those pixels as they are.
+		 *
+		 * @param left, top The first column and row inside.
+		 * @param right, bottom The column and row after the last ones inside.
+		 */
+		void set_scissor(int left, int top, int right, int bottom);
+
+		/**
+		 * @brief Extends the scissor rectangle back to the whole buffer.
+		 */
+		void reset_scissor()
+		{
+			set_scissor(0, 0, int(width), int(height));
+		}
+
+		/**
+		 * @brief Resets the rows that were drawn into, leaving every pixel fully revealed.
+		 */
+		void clear();
+
+		/**
+		 * @brief Accumulates a translucent triangle of a single color.
+		 *
+		 * @param vertices The vertices of the mesh in display coordinates, all three of the triangle inside the target.
+		 * @param indices The three indices of the triangle.
+		 * @param color The color of the triangle.
+		 * @param alpha The opacity of the triangle, from 0 to 1.
+		 * @param z_buffer The depth of the opaque triangles, which hide the translucent ones behind them.
+		 */
+		void fill_triangle(const Point4i* vertices, const int* indices, const Rgb888& color, float alpha, const vector<int>& z_buffer);
+
+		/**
+		 * @brief Blends the translucent triangles over the opaque image.
+		 *
+		 * @param color_buffer The opaque image, of the same size as the buffer.
+		 */
+		void composite(argb::Color_Buffer<Rgb888>& color_buffer) const;
+	};
+}
@@ -5,6 +5,9 @@
 #ifndef MATH_HEADER
 #define MATH_HEADER
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -97,6 +100,92 @@ namespace MScenary
 		return Vector3f(translation[0], translation[1], translation[2]);
 	}
 
+	inline float extract_max_scale(const Matrix44& transformation)
+	{
+		return std::sqrt(std::max(std::max(glm::dot(Vector3f(transformation[0]), Vector3f(transformation[0])),
+		                                   glm::dot(Vector3f(transformation[1]), Vector3f(transformation[1]))),
+		                                   glm::dot(Vector3f(transformation[2]), Vector3f(transformation[2]))));
+	}
+
+	inline void extract_frustum_planes(const Matrix44& transformation, Vector4f planes[6])
+	{
+		// Gribb & Hartmann: the planes come in the space the matrix transforms from, pointing inwards.
+
+		Vector4f row_x(transformation[0][0], transformation[1][0], transformation[2][0], transformation[3][0]);
+		Vector4f row_y(transformation[0][1], transformation[1][1], transformation[2][1], transformation[3][1]);
+		Vector4f row_z(transformation[0][2], transformation[1][2], transformation[2][2], transformation[3][2]);
+		Vector4f row_w(transformation[0][3], transformation[1][3], transformation[2][3], transformation[3][3]);
+
+		planes[0] = row_w + row_x;
+		planes[1] = row_w - row_x;
+		planes[2] = row_w + row_y;
+		planes[3] = row_w - row_y;
+		planes[4] = row_w + row_z;
+		planes[5] = row_w - row_z;
+
+		for (size_t index = 0; index < 6; index++)
+		{
+			planes[index] *= 1.f / std::sqrt(glm::dot(Vector3f(planes[index]), Vector3f(planes[index])));
+		}
+	}
+
+	inline bool is_sphere_in_frustum(const Vector4f planes[6], const Point3f& center, float radius)
+	{
+		for (size_t index = 0; index < 6; index++)
+		{
+			if (glm::dot(Vector3f(planes[index]), center) + planes[index].w < -radius) return false;
+		}
+
+		return true;
+	}
+
+	// Box a sphere covers once projected, in normalized device coords. When it reaches the camera plane it can't be
+	// projected and only the flag is set.
+
+	struct Projected_Bounds
+	{
+		float x_min, x_max;
+		float y_min, y_max;
+		float z_min;
+		bool  crosses_camera_plane;
+	};
+
+	inline Projected_Bounds project_sphere_bounds(const Point3f& center, float radius, const Matrix44& transformation)
+	{
+		// The sphere is bounded by the box around it, whose corners are projected.
+
+		Projected_Bounds bounds;
+
+		bounds.x_min = bounds.y_min = bounds.z_min = std::numeric_limits<float>::max();
+		bounds.x_max = bounds.y_max = -std::numeric_limits<float>::max();
+		bounds.crosses_camera_plane = false;
+
+		for (int corner = 0; corner < 8; corner++)
+		{
+			Point4f projected = transformation * Point4f
+			(
+				center.x + (corner & 1 ? radius : -radius),
+				center.y + (corner & 2 ? radius : -radius),
+				center.z + (corner & 4 ? radius : -radius),
+				1.f
+			);
+
+			if (projected.w <= 0.f)
+			{
+				bounds.crosses_camera_plane = true;
+				return bounds;
+			}
+
+			float inverse_w = 1.f / projected.w;
+
+			bounds.x_min = std::min(bounds.x_min, projected.x * inverse_w); bounds.x_max = std::max(bounds.x_max, projected.x * inverse_w);
+			bounds.y_min = std::min(bounds.y_min, projected.y * inverse_w); bounds.y_max = std::max(bounds.y_max, projected.y * inverse_w);
+			bounds.z_min = std::min(bounds.z_min, projected.z * inverse_w);
+		}
+
+		return bounds;
+	}
+
 	inline Quaternion extract_rotation(const Matrix44& transformation)
 	{
 		glm::vec3 scale;
@@ -0,0 +1,74 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#pragma once
+
+// SSE2 is always there on x64, elsewhere it depends on the compiler flags. The vectorized
+// kernels check MSCENARY_SSE2 and fall back to plain loops when it's 0.
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MSCENARY_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define MSCENARY_SSE2 0
+#endif
+
+namespace MScenary
+{
+	namespace simd
+	{
+		/**
+		 * @brief Gets the flag of the calling thread, read through enabled() and set through an Override.
+		 */
+		inline bool& thread_state()
+		{
+			thread_local bool state = MSCENARY_SSE2 != 0;
+			return state;
+		}
+
+		/**
+		 * @brief Whether the vectorized kernels run on the calling thread. Their plain loops are always compiled too, as the
+		 * reference path a Cross_Check compares them with, and take over when it's false.
+		 *
+		 * Every thread has its own flag, so a thread drawing through the plain loops doesn't change what the others run. The
+		 * Thread_Pool gives its threads the flag of the thread that starts every job.
+		 *
+		 * @return The flag of the thread, true by default when there's SSE2.
+		 */
+		inline bool enabled()
+		{
+			return thread_state();
+		}
+
+		/**
+		 * @brief Sets the flag of the calling thread while it's in scope, and restores the one it had after.
+		 */
+		class Override
+		{
+			bool previous;		///< Flag of the thread before the override.
+
+		public:
+
+			/**
+			 * @brief Sets the flag of the thread.
+			 *
+			 * @param state True to run the vectorized kernels, which only has an effect when there's SSE2.
+			 */
+			explicit Override(bool state) : previous(thread_state())
+			{
+				thread_state() = state && MSCENARY_SSE2 != 0;
+			}
+
+			~Override()
+			{
+				thread_state() = previous;
+			}
+
+			Override(const Override&) = delete;
+			Override& operator = (const Override&) = delete;
+		};
+	}
+}
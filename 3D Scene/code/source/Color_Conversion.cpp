@@ -0,0 +1,327 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Color_Conversion.hpp"
+#include "../header/simd.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace MScenary
+{
+	using color_conversion::Channels;
+	using color_conversion::bayer_offset;
+	using color_conversion::convert_pixel;
+
+	static_assert(sizeof(Rgb888) == 3 && sizeof(Rgba8888) == 4, "The kernels read and write the pixels as bytes");
+	static_assert(sizeof(Rgbf) == 12 && sizeof(Rgbaf) == 16, "The kernels read and write the pixels as floats");
+
+	namespace
+	{
+		/**
+		 * @brief Gets the offsets added to the channels of 4 pixels in a row before truncating them, which repeat every 4 pixels.
+		 *
+		 * @param x The column of the first pixel.
+		 * @param y The row.
+		 * @param dithering Whether to dither, otherwise all of them are a half to round to the nearest level.
+		 * @param offsets Where to write the offsets of the 4 pixels.
+		 */
+		void get_run_offsets(unsigned x, unsigned y, Dithering dithering, float offsets[4])
+		{
+			for (unsigned index = 0; index < 4; index++)
+			{
+				offsets[index] = dithering == ORDERED_DITHERING ? bayer_offset(x + index, y) : 0.5f;
+			}
+		}
+
+		uint32_t load_32(const uint8_t* bytes)
+		{
+			uint32_t word;
+			std::memcpy(&word, bytes, sizeof(word));
+			return word;
+		}
+
+		void store_32(uint8_t* bytes, uint32_t word)
+		{
+			std::memcpy(bytes, &word, sizeof(word));
+		}
+
+		/**
+		 * @brief Converts from 24 bit color to a packed format with fewer levels.
+		 *
+		 * The 12 channels of 4 pixels are converted at once. They stay interleaved as they are in memory, filling 3 vectors,
+		 * and the scales and offsets are laid out the same way, so the only reordering is packing the levels of each pixel.
+		 */
+		template< class PACKED >
+		void quantize_rgb888(const Rgb888* source, PACKED* target, unsigned count, unsigned x, unsigned y, Dithering dithering)
+		{
+			float offsets[4];
+
+			get_run_offsets(x, y, dithering, offsets);
+
+			unsigned index = 0;
+
+			#if MSCENARY_SSE2
+
+			typedef Channels< PACKED > Target;
+
+			const float red_max   = Target::template max< PACKED::RED   >();
+			const float green_max = Target::template max< PACKED::GREEN >();
+			const float blue_max  = Target::template max< PACKED::BLUE  >();
+
+			// The same scales as convert_channel(), so both give the same levels.
+
+			const float red_scale   = red_max   / 255.f;
+			const float green_scale = green_max / 255.f;
+			const float blue_scale  = blue_max  / 255.f;
+
+			const __m128 scale_0 = _mm_setr_ps(red_scale,   green_scale, blue_scale,  red_scale);
+			const __m128 scale_1 = _mm_setr_ps(green_scale, blue_scale,  red_scale,   green_scale);
+			const __m128 scale_2 = _mm_setr_ps(blue_scale,  red_scale,   green_scale, blue_scale);
+
+			// Every run of 4 pixels has the same offsets as the first one.
+
+			const __m128 offset_0 = _mm_setr_ps(offsets[0], offsets[0], offsets[0], offsets[1]);
+			const __m128 offset_1 = _mm_setr_ps(offsets[1], offsets[1], offsets[2], offsets[2]);
+			const __m128 offset_2 = _mm_setr_ps(offsets[2], offsets[3], offsets[3], offsets[3]);
+
+			const __m128i max_01 = _mm_setr_epi16(short(red_max), short(green_max), short(blue_max), short(red_max), short(green_max), short(blue_max), short(red_max), short(green_max));
+			const __m128i max_2  = _mm_setr_epi16(short(blue_max), short(red_max), short(green_max), short(blue_max), 0, 0, 0, 0);
+			const __m128i zero   = _mm_setzero_si128();
+
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(source);
+
+			alignas(16) uint16_t levels[16];
+
+			const bool vectorized = simd::enabled();
+
+			for (; vectorized && index + 4 <= count; index += 4)
+			{
+				// 12 bytes, loaded as 8 and 4 to not read past the end of the row.
+
+				__m128i packed = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes + index * 3)), _mm_cvtsi32_si128(int(load_32(bytes + index * 3 + 8))));
+				__m128i words_01 = _mm_unpacklo_epi8(packed, zero);
+				__m128i words_2 = _mm_unpackhi_epi8(packed, zero);
+
+				__m128 channels_0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words_01, zero));
+				__m128 channels_1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words_01, zero));
+				__m128 channels_2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words_2, zero));
+
+				__m128i levels_0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_0, scale_0), offset_0));
+				__m128i levels_1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_1, scale_1), offset_1));
+				__m128i levels_2 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_2, scale_2), offset_2));
+
+				_mm_store_si128(reinterpret_cast<__m128i*>(levels), _mm_min_epi16(_mm_packs_epi32(levels_0, levels_1), max_01));
+				_mm_store_si128(reinterpret_cast<__m128i*>(levels + 8), _mm_min_epi16(_mm_packs_epi32(levels_2, levels_2), max_2));
+
+				for (unsigned pixel = 0; pixel < 4; pixel++)
+				{
+					PACKED& color = target[index + pixel];
+
+					color = PACKED();
+
+					Target::template set< PACKED::RED   >(color, levels[pixel * 3 + 0]);
+					Target::template set< PACKED::GREEN >(color, levels[pixel * 3 + 1]);
+					Target::template set< PACKED::BLUE  >(color, levels[pixel * 3 + 2]);
+				}
+			}
+
+			#endif
+
+			for (; index < count; index++)
+			{
+				convert_pixel(source[index], target[index], offsets[index & 3]);
+			}
+		}
+
+		/**
+		 * @brief Converts from 24 bit color to float through a table of the 256 levels, with the same values convert_channel() gives.
+		 */
+		template< class FLOAT_COLOR >
+		void expand_rgb888(const Rgb888* source, FLOAT_COLOR* target, unsigned count)
+		{
+			static const struct Table
+			{
+				float values[256];
+
+				Table()
+				{
+					for (unsigned level = 0; level < 256; level++) values[level] = float(level) * (1.f / 255.f);
+				}
+			}
+			table;
+
+			for (unsigned index = 0; index < count; index++)
+			{
+				FLOAT_COLOR& color = target[index];
+
+				color.components[FLOAT_COLOR::RED  ] = table.values[source[index].red  ()];
+				color.components[FLOAT_COLOR::GREEN] = table.values[source[index].green()];
+				color.components[FLOAT_COLOR::BLUE ] = table.values[source[index].blue ()];
+
+				color_conversion::set_opaque(color, std::integral_constant< bool, color_conversion::Has_Alpha< FLOAT_COLOR >::value >());
+			}
+		}
+	}
+
+	void convert_row(const Rgb888* source, Rgb565* target, unsigned count, unsigned x, unsigned y, Dithering dithering)
+	{
+		quantize_rgb888(source, target, count, x, y, dithering);
+	}
+
+	void convert_row(const Rgb888* source, Rgb332* target, unsigned count, unsigned x, unsigned y, Dithering dithering)
+	{
+		quantize_rgb888(source, target, count, x, y, dithering);
+	}
+
+	void convert_row(const Rgb888* source, Rgba8888* target, unsigned count, unsigned, unsigned, Dithering)
+	{
+		const uint8_t* source_bytes = reinterpret_cast<const uint8_t*>(source);
+		uint8_t*       target_bytes = reinterpret_cast<uint8_t*>(target);
+
+		size_t index = 0;
+
+		// There are no byte shuffles in SSE2, so the 3 words of 4 pixels are split into 4 words with shifts. The words are
+		// little endian, like on every machine this builds for, so the first byte is the lowest one.
+
+		const uint32_t alpha = 0xFF000000u;
+
+		for (; index + 4 <= count; index += 4)
+		{
+			uint32_t word_0 = load_32(source_bytes + index * 3 + 0);
+			uint32_t word_1 = load_32(source_bytes + index * 3 + 4);
+			uint32_t word_2 = load_32(source_bytes + index * 3 + 8);
+
+			store_32(target_bytes + index * 4 +  0, alpha | word_0);
+			store_32(target_bytes + index * 4 +  4, alpha | (word_0 >> 24) | (word_1 << 8));
+			store_32(target_bytes + index * 4 +  8, alpha | (word_1 >> 16) | (word_2 << 16));
+			store_32(target_bytes + index * 4 + 12, alpha | (word_2 >> 8));
+		}
+
+		for (; index < count; index++)
+		{
+			target_bytes[index * 4 + 0] = source_bytes[index * 3 + 0];
+			target_bytes[index * 4 + 1] = source_bytes[index * 3 + 1];
+			target_bytes[index * 4 + 2] = source_bytes[index * 3 + 2];
+			target_bytes[index * 4 + 3] = 0xFF;
+		}
+	}
+
+	void convert_row(const Rgba8888* source, Rgb888* target, unsigned count, unsigned, unsigned, Dithering)
+	{
+		const uint8_t* source_bytes = reinterpret_cast<const uint8_t*>(source);
+		uint8_t*       target_bytes = reinterpret_cast<uint8_t*>(target);
+
+		size_t index = 0;
+
+		// The reverse of the conversion to Rgba8888, the alpha bytes are shifted out.
+
+		for (; index + 4 <= count; index += 4)
+		{
+			uint32_t word_0 = load_32(source_bytes + index * 4 +  0) & 0xFFFFFFu;
+			uint32_t word_1 = load_32(source_bytes + index * 4 +  4) & 0xFFFFFFu;
+			uint32_t word_2 = load_32(source_bytes + index * 4 +  8) & 0xFFFFFFu;
+			uint32_t word_3 = load_32(source_bytes + index * 4 + 12) & 0xFFFFFFu;
+
+			store_32(target_bytes + index * 3 + 0, word_0 | (word_1 << 24));
+			store_32(target_bytes + index * 3 + 4, (word_1 >> 8) | (word_2 << 16));
+			store_32(target_bytes + index * 3 + 8, (word_2 >> 16) | (word_3 << 8));
+		}
+
+		for (; index < count; index++)
+		{
+			target_bytes[index * 3 + 0] = source_bytes[index * 4 + 0];
+			target_bytes[index * 3 + 1] = source_bytes[index * 4 + 1];
+			target_bytes[index * 3 + 2] = source_bytes[index * 4 + 2];
+		}
+	}
+
+	void convert_row(const Rgb888* source, Rgbf* target, unsigned count, unsigned, unsigned, Dithering)
+	{
+		expand_rgb888(source, target, count);
+	}
+
+	void convert_row(const Rgb888* source, Rgbaf* target, unsigned count, unsigned, unsigned, Dithering)
+	{
+		expand_rgb888(source, target, count);
+	}
+
+	void convert_row(const Rgbf* source, Rgb888* target, unsigned count, unsigned x, unsigned y, Dithering dithering)
+	{
+		float offsets[4];
+
+		get_run_offsets(x, y, dithering, offsets);
+
+		unsigned index = 0;
+
+		#if MSCENARY_SSE2
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 scale = _mm_set1_ps(255.f / 1.f);
+
+		const __m128 offset_0 = _mm_setr_ps(offsets[0], offsets[0], offsets[0], offsets[1]);
+		const __m128 offset_1 = _mm_setr_ps(offsets[1], offsets[1], offsets[2], offsets[2]);
+		const __m128 offset_2 = _mm_setr_ps(offsets[2], offsets[3], offsets[3], offsets[3]);
+
+		// The 12 channels of 4 pixels are 3 whole vectors, laid out like the 12 bytes they become.
+
+		const float* channels = reinterpret_cast<const float*>(source);
+		uint8_t*     bytes = reinterpret_cast<uint8_t*>(target);
+
+		const bool vectorized = simd::enabled();
+
+		for (; vectorized && index + 4 <= count; index += 4)
+		{
+			__m128 channels_0 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(channels + index * 3 + 0), zero), one);
+			__m128 channels_1 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(channels + index * 3 + 4), zero), one);
+			__m128 channels_2 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(channels + index * 3 + 8), zero), one);
+
+			__m128i levels_0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_0, scale), offset_0));
+			__m128i levels_1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_1, scale), offset_1));
+			__m128i levels_2 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(channels_2, scale), offset_2));
+
+			// The clamp keeps every level within 255, so the saturation of the packs doesn't change any.
+
+			__m128i levels = _mm_packus_epi16(_mm_packs_epi32(levels_0, levels_1), _mm_packs_epi32(levels_2, levels_2));
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(bytes + index * 3), levels);
+			store_32(bytes + index * 3 + 8, uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(levels, 8))));
+		}
+
+		#endif
+
+		for (; index < count; index++)
+		{
+			convert_pixel(source[index], target[index], offsets[index & 3]);
+		}
+	}
+
+	void convert_row(const Rgb565* source, Rgb888* target, unsigned count, unsigned, unsigned, Dithering)
+	{
+		// Every level of 5 and 6 bits rounded to 8 bits, with the same operations as convert_channel().
+
+		static const struct Tables
+		{
+			uint8_t levels_5[32];
+			uint8_t levels_6[64];
+
+			Tables()
+			{
+				for (unsigned level = 0; level < 32; level++) levels_5[level] = uint8_t(unsigned(float(level) * (255.f / 31.f) + 0.5f));
+				for (unsigned level = 0; level < 64; level++) levels_6[level] = uint8_t(unsigned(float(level) * (255.f / 63.f) + 0.5f));
+			}
+		}
+		tables;
+
+		for (unsigned index = 0; index < count; index++)
+		{
+			target[index].red  () = tables.levels_5[source[index].red  ()];
+			target[index].green() = tables.levels_6[source[index].green()];
+			target[index].blue () = tables.levels_5[source[index].blue ()];
+		}
+	}
+}
@@ -0,0 +1,266 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Cross_Check.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace MScenary
+{
+	namespace
+	{
+		/**
+		 * @brief Gets how far apart two colors are.
+		 *
+		 * @return The largest difference of their channels.
+		 */
+		int color_error(const Scene_View::Color& a, const Scene_View::Color& b)
+		{
+			int red = std::abs(int(a.red()) - int(b.red()));
+			int green = std::abs(int(a.green()) - int(b.green()));
+			int blue = std::abs(int(a.blue()) - int(b.blue()));
+
+			return std::max(red, std::max(green, blue));
+		}
+
+		int64_t depth_error(int a, int b)
+		{
+			return std::llabs(int64_t(a) - int64_t(b));
+		}
+	}
+
+	Cross_Check::Cross_Check(int color_tolerance, int depth_tolerance, unsigned tile_size)
+		:
+		color_tolerance(std::max(color_tolerance, 0)),
+		depth_tolerance(std::max(depth_tolerance, 0)),
+		tile_size(std::max(tile_size, 1u)),
+		log(nullptr),
+		images_checked(0),
+		images_failed(0)
+	{
+	}
+
+	void Cross_Check::keep_lods(size_t index, const Scene_View& view)
+	{
+		if (frame_lods.size() <= index) frame_lods.resize(index + 1);
+
+		frame_lods[index] = view.get_lods();
+	}
+
+	Scene_View& Cross_Check::prepare_reference(size_t index, const Scene_View& view)
+	{
+		if (!reference) reference = std::make_unique<Scene_View>(view.get_width(), view.get_height());
+
+		reference->resize(view.get_width(), view.get_height());
+		reference->set_camera(view.get_view_matrix(), view.get_perspective_matrix());
+		reference->set_multisampling(view.is_multisampling_enabled());
+		reference->set_incremental_rendering(false);
+		reference->set_occlusion_culling(false);
+		reference->set_lods(frame_lods[index]);
+
+		return *reference;
+	}
+
+	const Cross_Check_Result& Cross_Check::compare(const Scene_View& view, const Scene_View& reference)
+	{
+		const Color_Buffer& colors = view.get_color_buffer();
+		const Color_Buffer& reference_colors = reference.get_color_buffer();
+
+		assert(colors.get_width() == reference_colors.get_width() && colors.get_height() == reference_colors.get_height());
+
+		int width = int(colors.get_width());
+		int height = int(colors.get_height());
+
+		// With anti-aliasing the depth is in the multisampled target and the z-buffer of the rasterizer isn't written, so only
+		// the color can be compared.
+
+		bool        with_depth = !view.is_multisampling_enabled();
+		const int*  depths = view.get_rasterizer().get_z_buffer().data();
+		const int*  reference_depths = reference.get_rasterizer().get_z_buffer().data();
+
+		int tiles_x = (width + int(tile_size) - 1) / int(tile_size);
+		int tiles_y = (height + int(tile_size) - 1) / int(tile_size);
+
+		vector<size_t> tile_mismatches(size_t(tiles_x) * size_t(tiles_y), 0);
+
+		results.emplace_back();
+
+		Cross_Check_Result& result = results.back();
+
+		result.image = images_checked++;
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				size_t offset = size_t(y) * size_t(width) + size_t(x);
+
+				int     color = color_error(colors.pixels()[offset], reference_colors.pixels()[offset]);
+				int64_t depth = with_depth ? depth_error(depths[offset], reference_depths[offset]) : 0;
+
+				result.max_color_error = std::max(result.max_color_error, color);
+				result.max_depth_error = std::max(result.max_depth_error, depth);
+
+				bool color_mismatch = color > color_tolerance;
+				bool depth_mismatch = depth > depth_tolerance;
+
+				if (color_mismatch) result.color_mismatches++;
+				if (depth_mismatch) result.depth_mismatches++;
+
+				if (color_mismatch || depth_mismatch)
+				{
+					Screen_Rect pixel;
+
+					pixel.left = x;
+					pixel.top = y;
+					pixel.right = x + 1;
+					pixel.bottom = y + 1;
+
+					result.bounds.merge(pixel);
+
+					tile_mismatches[size_t(y / int(tile_size)) * size_t(tiles_x) + size_t(x / int(tile_size))]++;
+				}
+			}
+		}
+
+		for (int tile_y = 0; tile_y < tiles_y; tile_y++)
+		{
+			for (int tile_x = 0; tile_x < tiles_x; tile_x++)
+			{
+				size_t pixels = tile_mismatches[size_t(tile_y) * size_t(tiles_x) + size_t(tile_x)];
+
+				if (pixels == 0) continue;
+
+				Mismatch_Region region;
+
+				region.bounds.left = tile_x * int(tile_size);
+				region.bounds.top = tile_y * int(tile_size);
+				region.bounds.right = std::min(region.bounds.left + int(tile_size), width);
+				region.bounds.bottom = std::min(region.bounds.top + int(tile_size), height);
+				region.pixels = pixels;
+
+				result.regions.push_back(region);
+			}
+		}
+
+		if (!result.passed())
+		{
+			images_failed++;
+
+			if (log) write_result(*log, result);
+
+			if (!difference_path.empty() && !write_difference_image(result, view, reference) && log)
+			{
+				*log << "couldn't write the difference image of image " << result.image << '\n';
+			}
+		}
+
+		return result;
+	}
+
+	void Cross_Check::write_result(std::ostream& stream, const Cross_Check_Result& result)
+	{
+		// The tiles are listed up to a limit, past it they're usually a single broken mesh and the bounds already say where.
+
+		const size_t listed_regions = 16;
+
+		char line[256];
+
+		std::snprintf
+		(
+			line, sizeof(line),
+			"image %llu: %zu color and %zu depth mismatches in %zu tiles, largest errors %d and %lld",
+			(unsigned long long)result.image, result.color_mismatches, result.depth_mismatches, result.regions.size(),
+			result.max_color_error, (long long)result.max_depth_error
+		);
+
+		stream << line;
+
+		if (!result.bounds.is_empty())
+		{
+			std::snprintf(line, sizeof(line), ", within (%d, %d)-(%d, %d)", result.bounds.left, result.bounds.top, result.bounds.right, result.bounds.bottom);
+
+			stream << line;
+		}
+
+		stream << '\n';
+
+		for (size_t index = 0; index < result.regions.size() && index < listed_regions; index++)
+		{
+			const Mismatch_Region& region = result.regions[index];
+
+			std::snprintf(line, sizeof(line), "    (%d, %d)-(%d, %d): %zu pixels\n", region.bounds.left, region.bounds.top, region.bounds.right, region.bounds.bottom, region.pixels);
+
+			stream << line;
+		}
+
+		if (result.regions.size() > listed_regions)
+		{
+			stream << "    and " << result.regions.size() - listed_regions << " more tiles\n";
+		}
+	}
+
+	bool Cross_Check::write_difference_image(const Cross_Check_Result& result, const Scene_View& view, const Scene_View& reference) const
+	{
+		const Color_Buffer& colors = view.get_color_buffer();
+		const Color_Buffer& reference_colors = reference.get_color_buffer();
+
+		unsigned width = colors.get_width();
+		unsigned height = colors.get_height();
+
+		bool        with_depth = !view.is_multisampling_enabled();
+		const int*  depths = view.get_rasterizer().get_z_buffer().data();
+		const int*  reference_depths = reference.get_rasterizer().get_z_buffer().data();
+
+		char number[16];
+
+		std::snprintf(number, sizeof(number), "%05llu.ppm", (unsigned long long)result.image);
+
+		std::ofstream file(difference_path + number, std::ios::binary);
+
+		file << "P6\n" << width << ' ' << height << "\n255\n";
+
+		vector<uint8_t> row(size_t(width) * 3);
+
+		for (unsigned y = 0; y < height; y++)
+		{
+			for (unsigned x = 0; x < width; x++)
+			{
+				size_t offset = size_t(y) * width + x;
+
+				const Scene_View::Color& pixel = reference_colors.pixels()[offset];
+
+				bool color_mismatch = color_error(colors.pixels()[offset], pixel) > color_tolerance;
+				bool depth_mismatch = with_depth && depth_error(depths[offset], reference_depths[offset]) > depth_tolerance;
+
+				uint8_t* out = &row[size_t(x) * 3];
+
+				if (color_mismatch || depth_mismatch)
+				{
+					out[0] = color_mismatch ? 255 : 0;
+					out[1] = 0;
+					out[2] = depth_mismatch ? 255 : 0;
+				}
+				else
+				{
+					// The matching pixels are dimmed so the mismatches stand out, while the image can still be recognized.
+
+					uint8_t gray = uint8_t((int(pixel.red()) + int(pixel.green()) + int(pixel.blue())) / 6);
+
+					out[0] = out[1] = out[2] = gray;
+				}
+			}
+
+			file.write(reinterpret_cast<const char*>(row.data()), std::streamsize(row.size()));
+		}
+
+		return bool(file);
+	}
+}
@@ -0,0 +1,143 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Dirty_Region.hpp"
+#include "../header/Mesh.hpp"
+
+#include <cmath>
+
+namespace MScenary
+{
+	namespace
+	{
+		// Pixels added around every projected rectangle, for the rounding of the display coordinates and the samples of the edges.
+
+		const int padding = 2;
+	}
+
+	Dirty_Region::Dirty_Region()
+		:
+		width(0),
+		height(0),
+		frame(0),
+		full_redraw(true)
+	{
+	}
+
+	void Dirty_Region::begin_frame(unsigned width, unsigned height)
+	{
+		// At another size nothing of the last frame can be kept, and the rectangles of the meshes mean nothing anymore.
+
+		if (width != this->width || height != this->height)
+		{
+			this->width = width;
+			this->height = height;
+
+			drawn_meshes.clear();
+			full_redraw = true;
+		}
+
+		bounds = Screen_Rect();
+		frame++;
+	}
+
+	void Dirty_Region::add_item(const Draw_Item& item)
+	{
+		Screen_Rect item_bounds = project_bounds(item.mesh->get_bounding_center(), item.mesh->get_bounding_radius(), item.transform_matrix, width, height);
+
+		auto found = drawn_meshes.find(item.mesh);
+
+		if (found == drawn_meshes.end())
+		{
+			drawn_meshes[item.mesh] = Drawn_Mesh{ item.transform_matrix, item.opacity, item.lod, item_bounds, frame };
+			bounds.merge(item_bounds);
+			return;
+		}
+
+		Drawn_Mesh& drawn = found->second;
+
+		// A mesh drawn more than once in the same frame covers all of its rectangles.
+
+		if (drawn.frame == frame)
+		{
+			drawn.bounds.merge(item_bounds);
+			bounds.merge(drawn.bounds);
+			return;
+		}
+
+		bool changed = drawn.transform_matrix != item.transform_matrix || drawn.opacity != item.opacity || drawn.lod != item.lod;
+
+		if (changed)
+		{
+			bounds.merge(drawn.bounds);
+			bounds.merge(item_bounds);
+
+			drawn.transform_matrix = item.transform_matrix;
+			drawn.opacity = item.opacity;
+			drawn.lod = item.lod;
+			drawn.bounds = item_bounds;
+		}
+
+		drawn.frame = frame;
+	}
+
+	void Dirty_Region::end_frame()
+	{
+		for (auto iterator = drawn_meshes.begin(); iterator != drawn_meshes.end(); )
+		{
+			if (iterator->second.frame != frame)
+			{
+				bounds.merge(iterator->second.bounds);
+				iterator = drawn_meshes.erase(iterator);
+			}
+			else
+			{
+				++iterator;
+			}
+		}
+
+		if (full_redraw)
+		{
+			bounds = whole_screen();
+			full_redraw = false;
+		}
+	}
+
+	bool Dirty_Region::intersects(const Draw_Item& item) const
+	{
+		auto found = drawn_meshes.find(item.mesh);
+
+		return found == drawn_meshes.end() || found->second.bounds.intersects(bounds);
+	}
+
+	Screen_Rect Dirty_Region::project_bounds(const Point3f& center, float radius, const Matrix44& transform_matrix, unsigned width, unsigned height)
+	{
+		Screen_Rect screen;
+
+		screen.right = int(width);
+		screen.bottom = int(height);
+
+		Projected_Bounds projected = project_sphere_bounds(center, radius, transform_matrix);
+
+		// A sphere reaching the camera plane can't be projected, so it's given the whole screen.
+
+		if (projected.crosses_camera_plane) return screen;
+
+		// Same mapping as the display transformation of the meshes.
+
+		float half_width = float(width / 2);
+		float half_height = float(height / 2);
+
+		Screen_Rect rect;
+
+		rect.left   = std::max(int(std::floor(std::max(projected.x_min, -2.f) * half_width + half_width)) - padding, 0);
+		rect.right  = std::min(int(std::ceil (std::min(projected.x_max,  2.f) * half_width + half_width)) + padding, screen.right);
+		rect.top    = std::max(int(std::floor(std::max(projected.y_min, -2.f) * half_height + half_height)) - padding, 0);
+		rect.bottom = std::min(int(std::ceil (std::min(projected.y_max,  2.f) * half_height + half_height)) + padding, screen.bottom);
+
+		return rect;
+	}
+}
@@ -0,0 +1,82 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Dynamic_Resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MScenary
+{
+	// std::min() takes the steps by reference, so before C++17 they need a definition out of the class.
+
+	constexpr unsigned Dynamic_Resolution::scale_steps;
+	constexpr unsigned Dynamic_Resolution::history_size;
+
+	Dynamic_Resolution::Dynamic_Resolution(unsigned width, unsigned height, float frame_budget, float min_scale)
+		:
+		full_width(width),
+		full_height(height),
+		min_step(std::min(std::max(unsigned(min_scale * scale_steps + 0.5f), 1u), scale_steps)),
+		step(scale_steps),
+		frame_budget(frame_budget),
+		frame_count(0)
+	{
+	}
+
+	bool Dynamic_Resolution::record_frame(float seconds)
+	{
+		frame_times[frame_count % history_size] = seconds;
+		frame_count++;
+
+		// A few frames are enough to react to a spike, growing waits for a whole history.
+
+		unsigned samples = std::min(frame_count, history_size);
+
+		if (samples < 4) return false;
+
+		float average = 0.f;
+
+		for (unsigned index = 0; index < samples; index++)
+		{
+			average += frame_times[index];
+		}
+
+		average /= float(samples);
+
+		unsigned new_step = step;
+
+		if (average > frame_budget)
+		{
+			// The cost goes with the pixels, which go with the square of the scale.
+
+			float fitting_step = float(step) * std::sqrt(frame_budget * headroom / average);
+
+			new_step = std::max(std::min(unsigned(fitting_step), step - 1), min_step);
+		}
+		else if (average < frame_budget * grow_margin && samples == history_size)
+		{
+			new_step = std::min(step + 1, scale_steps);
+		}
+
+		if (new_step == step) return false;
+
+		step = new_step;
+		frame_count = 0;
+
+		return true;
+	}
+
+	void Dynamic_Resolution::upscale(const Color_Buffer& source, Color_Buffer& target)
+	{
+		Screen_Rect whole;
+
+		whole.right = int(target.get_width());
+		whole.bottom = int(target.get_height());
+
+		scaler.blit(source, target, whole, BILINEAR_FILTER);
+	}
+}
@@ -0,0 +1,93 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Frame_Arena.hpp"
+
+#include <algorithm>
+
+namespace MScenary
+{
+	namespace
+	{
+		thread_local Frame_Arena* bound_arena = nullptr;	///< Arena bound to the thread, null to use its own one.
+	}
+
+	Frame_Arena::Binding::Binding(Frame_Arena& arena)
+		:
+		previous(bound_arena)
+	{
+		bound_arena = &arena;
+	}
+
+	Frame_Arena::Binding::~Binding()
+	{
+		bound_arena = previous;
+	}
+
+	Frame_Arena::Frame_Arena()
+		:
+		current_block(0),
+		offset(0),
+		high_water(0)
+	{
+	}
+
+	Frame_Arena& Frame_Arena::local()
+	{
+		static thread_local Frame_Arena arena;
+
+		return bound_arena ? *bound_arena : arena;
+	}
+
+	void Frame_Arena::reset()
+	{
+		if (blocks.size() > 1)
+		{
+			size_t capacity = get_capacity();
+
+			blocks.clear();
+			blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[capacity]), capacity, 0 });
+		}
+
+		current_block = 0;
+		offset = 0;
+	}
+
+	void* Frame_Arena::allocate_bytes(size_t size, size_t align)
+	{
+		for (;;)
+		{
+			if (current_block < blocks.size())
+			{
+				Block& block = blocks[current_block];
+
+				uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+				size_t    aligned = size_t(((base + offset + align - 1) & ~uintptr_t(align - 1)) - base);
+
+				if (aligned + size <= block.size)
+				{
+					offset = aligned + size;
+					high_water = std::max(high_water, block.start + offset);
+
+					return block.memory.get() + aligned;
+				}
+
+				// Whatever is left at the end of the block is wasted until the arena goes back before it.
+
+				current_block++;
+				offset = 0;
+
+				continue;
+			}
+
+			// Each new block at least doubles the memory, so a frame far bigger than the previous ones only chains a few.
+
+			size_t block_size = std::max({ size + align, min_block_size, get_capacity() });
+
+			blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[block_size]), block_size, get_capacity() });
+		}
+	}
+}
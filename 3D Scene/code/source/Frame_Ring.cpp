@@ -0,0 +1,192 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Frame_Ring.hpp"
+
+#include <chrono>
+#include <new>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+namespace MScenary
+{
+	namespace
+	{
+		constexpr size_t page_size = 4096;	///< The slots start at page boundaries, so a reader can map or copy them whole.
+
+		size_t round_to_page(size_t size)
+		{
+			return (size + page_size - 1) / page_size * page_size;
+		}
+	}
+
+	Frame_Ring::Frame_Ring(const std::string& name, unsigned width, unsigned height, unsigned slot_count)
+		:
+		header(nullptr),
+		slots(nullptr),
+		pixels(nullptr),
+		mapped_size(0),
+		name(name),
+		frame_number(0),
+		acquired(false),
+		#ifdef _WIN32
+		mapping(nullptr)
+		#else
+		descriptor(-1)
+		#endif
+	{
+		if (slot_count == 0 || width == 0 || height == 0) return;
+
+		size_t stride = size_t(width) * sizeof(Rgb888);
+		size_t slot_offset = round_to_page(sizeof(Frame_Ring_Header) + slot_count * sizeof(Frame_Ring_Slot));
+		size_t slot_size = round_to_page(stride * height);
+
+		mapped_size = slot_offset + slot_size * slot_count;
+
+		void* memory = nullptr;
+
+		#ifdef _WIN32
+
+		std::string mapping_name = "Local\\" + (name.empty() || name[0] != '/' ? name : name.substr(1));
+
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(mapped_size) >> 32), DWORD(mapped_size), mapping_name.c_str());
+
+		if (!mapping) return;
+
+		memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, mapped_size);
+
+		#else
+
+		// A ring left behind by a renderer that crashed is replaced, the readers open the new one by the same name.
+
+		shm_unlink(name.c_str());
+
+		descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+		if (descriptor < 0) return;
+
+		if (ftruncate(descriptor, off_t(mapped_size)) == 0)
+		{
+			memory = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+			if (memory == MAP_FAILED) memory = nullptr;
+		}
+
+		#endif
+
+		if (!memory)
+		{
+			close();
+			return;
+		}
+
+		// The new memory is all zeros, the header is constructed in it and the magic is written last, so a reader that
+		// finds it knows the rest is already there.
+
+		header = new (memory) Frame_Ring_Header();
+		slots = reinterpret_cast<Frame_Ring_Slot*>(header + 1);
+		pixels = static_cast<uint8_t*>(memory) + slot_offset;
+
+		header->version = Frame_Ring_Header::version_value;
+		header->slot_count = slot_count;
+		header->width = width;
+		header->height = height;
+		header->stride = uint32_t(stride);
+		header->slot_offset = slot_offset;
+		header->slot_size = slot_size;
+		header->write_index.store(0);
+		header->read_index.store(0);
+		header->dropped_frames.store(0);
+
+		std::atomic_thread_fence(std::memory_order_release);
+
+		header->magic = Frame_Ring_Header::magic_value;
+	}
+
+	Frame_Ring::~Frame_Ring()
+	{
+		close();
+
+		#ifndef _WIN32
+
+		if (!name.empty()) shm_unlink(name.c_str());
+
+		#endif
+	}
+
+	Rgb888* Frame_Ring::acquire_slot()
+	{
+		if (!header) return nullptr;
+
+		uint64_t write_index = header->write_index.load(std::memory_order_relaxed);
+
+		if (!acquired)
+		{
+			// The reader gives the slots back with release order, so once it's seen here the reader is done with the slot.
+
+			if (write_index - header->read_index.load(std::memory_order_acquire) >= header->slot_count)
+			{
+				header->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+				frame_number++;
+
+				return nullptr;
+			}
+
+			acquired = true;
+		}
+
+		return reinterpret_cast<Rgb888*>(pixels + (write_index % header->slot_count) * header->slot_size);
+	}
+
+	void Frame_Ring::publish()
+	{
+		if (!acquired) return;
+
+		uint64_t write_index = header->write_index.load(std::memory_order_relaxed);
+
+		Frame_Ring_Slot& slot = slots[write_index % header->slot_count];
+
+		slot.frame_number = frame_number++;
+		slot.timestamp = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+		// The release order makes the pixels and the metadata visible before the index that publishes them.
+
+		header->write_index.store(write_index + 1, std::memory_order_release);
+
+		acquired = false;
+	}
+
+	void Frame_Ring::close()
+	{
+		#ifdef _WIN32
+
+		if (header) UnmapViewOfFile(header);
+		if (mapping) CloseHandle(mapping);
+
+		mapping = nullptr;
+
+		#else
+
+		if (header) munmap(header, mapped_size);
+		if (descriptor >= 0) ::close(descriptor);
+
+		descriptor = -1;
+
+		#endif
+
+		header = nullptr;
+		slots = nullptr;
+		pixels = nullptr;
+	}
+}
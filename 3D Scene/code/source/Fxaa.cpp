@@ -0,0 +1,228 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Fxaa.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MScenary
+{
+	Fxaa::Fxaa(uint8_t contrast_threshold, float subpixel_quality)
+		:
+		contrast_threshold(std::max<uint8_t>(contrast_threshold, 1)),
+		relative_shift(3),
+		subpixel_quality(subpixel_quality)
+	{
+	}
+
+	void Fxaa::apply(Color_Buffer& color_buffer)
+	{
+		unsigned width = color_buffer.get_width();
+		unsigned height = color_buffer.get_height();
+
+		if (width < 3 || height < 3) return;
+
+		luma.resize(size_t(width) * height);
+		source.resize(size_t(width) * height);
+
+		// The whole image has to be copied and converted to luma before any band starts blending, since the bands read the rows around them.
+
+		for_each_band(height, [&](unsigned first_row, unsigned end_row)
+		{
+			const Rgb888* pixels = color_buffer.pixels();
+
+			for (size_t index = size_t(first_row) * width, end = size_t(end_row) * width; index < end; index++)
+			{
+				const Rgb888& pixel = pixels[index];
+
+				source[index] = pixel;
+				luma[index] = uint8_t((pixel.red() * 77u + pixel.green() * 150u + pixel.blue() * 29u + 128u) >> 8);
+			}
+		});
+
+		for_each_band(height, [&](unsigned first_row, unsigned end_row)
+		{
+			process_band(color_buffer, first_row, end_row);
+		});
+	}
+
+	void Fxaa::process_band(Color_Buffer& color_buffer, unsigned first_row, unsigned end_row) const
+	{
+		unsigned width = color_buffer.get_width();
+		unsigned height = color_buffer.get_height();
+
+		// The pixels of the border have no neighbours on one side and are left as they are.
+
+		first_row = std::max(first_row, 1u);
+		end_row = std::min(end_row, height - 1);
+
+	#if MSCENARY_SSE2
+		const bool vectorized = simd::enabled();
+	#endif
+
+		for (unsigned y = first_row; y < end_row; y++)
+		{
+			const uint8_t* row = luma.data() + size_t(y) * width;
+
+			unsigned x = 1;
+
+		#if MSCENARY_SSE2
+
+			// The contrast of sixteen pixels against their neighbours is found at once, and only the ones above the threshold are blended.
+
+			const __m128i absolute_threshold = _mm_set1_epi8(char(contrast_threshold));
+			const __m128i shift = _mm_cvtsi32_si128(relative_shift);
+			const __m128i shift_mask = _mm_set1_epi8(char(0xFF >> relative_shift));
+
+			for (; vectorized && x + 16 <= width - 1; x += 16)
+			{
+				__m128i middle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+				__m128i north  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - width));
+				__m128i south  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + width));
+				__m128i west   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+				__m128i east   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+
+				__m128i maximum = _mm_max_epu8(_mm_max_epu8(_mm_max_epu8(north, south), _mm_max_epu8(west, east)), middle);
+				__m128i minimum = _mm_min_epu8(_mm_min_epu8(_mm_min_epu8(north, south), _mm_min_epu8(west, east)), middle);
+				__m128i range = _mm_subs_epu8(maximum, minimum);
+
+				// There are no 8 bit shifts, so the bits that move in from the next byte are masked away.
+
+				__m128i threshold = _mm_max_epu8(absolute_threshold, _mm_and_si128(_mm_srl_epi16(maximum, shift), shift_mask));
+
+				// The range reaches the threshold where subtracting it saturates to 0.
+
+				unsigned edges = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(threshold, range), _mm_setzero_si128())));
+
+				for (; edges != 0; edges &= edges - 1)
+				{
+					unsigned lane = 0;
+
+					while (!(edges & (1u << lane))) lane++;
+
+					process_pixel(color_buffer, x + lane, y);
+				}
+			}
+
+		#endif
+
+			for (; x < width - 1; x++)
+			{
+				const uint8_t* center = row + x;
+
+				uint8_t middle = center[0];
+				uint8_t maximum = std::max({ *(center - width), *(center + width), center[-1], center[1], middle });
+				uint8_t minimum = std::min({ *(center - width), *(center + width), center[-1], center[1], middle });
+				uint8_t range = uint8_t(maximum - minimum);
+
+				if (range >= std::max<uint8_t>(contrast_threshold, uint8_t(maximum >> relative_shift)))
+				{
+					process_pixel(color_buffer, x, y);
+				}
+			}
+		}
+	}
+
+	void Fxaa::process_pixel(Color_Buffer& color_buffer, unsigned x, unsigned y) const
+	{
+		int    width = int(color_buffer.get_width());
+		int    height = int(color_buffer.get_height());
+		size_t index = size_t(y) * width + x;
+
+		const uint8_t* center = luma.data() + index;
+
+		float m  = center[0];
+		float n  = center[-width],     s  = center[width];
+		float w  = center[-1],         e  = center[1];
+		float nw = center[-width - 1], ne = center[-width + 1];
+		float sw = center[width - 1],  se = center[width + 1];
+
+		float maximum = std::max(std::max(std::max(n, s), std::max(w, e)), m);
+		float minimum = std::min(std::min(std::min(n, s), std::min(w, e)), m);
+		float range = maximum - minimum;
+
+		// An edge is horizontal when the luma changes more from row to row than from column to column.
+
+		float vertical_change   = std::abs(n + s - 2.f * m) * 2.f + std::abs(nw + sw - 2.f * w) + std::abs(ne + se - 2.f * e);
+		float horizontal_change = std::abs(w + e - 2.f * m) * 2.f + std::abs(nw + ne - 2.f * n) + std::abs(sw + se - 2.f * s);
+
+		bool horizontal_edge = vertical_change >= horizontal_change;
+
+		// The pixel is blended with the neighbour across the edge on the side where the luma changes the most.
+
+		float negative_luma = horizontal_edge ? n : w;
+		float positive_luma = horizontal_edge ? s : e;
+		float negative_gradient = std::abs(negative_luma - m);
+		float positive_gradient = std::abs(positive_luma - m);
+
+		bool positive_side = positive_gradient >= negative_gradient;
+
+		int across = (horizontal_edge ? width : 1) * (positive_side ? 1 : -1);
+		int along  = horizontal_edge ? 1 : width;
+
+		float edge_luma = (m + (positive_side ? positive_luma : negative_luma)) * 0.5f;
+		float gradient = std::max(negative_gradient, positive_gradient) * 0.25f;
+
+		// Walk both ways along the edge until the average luma of the two rows around it stops matching, which is where it ends.
+
+		int position = horizontal_edge ? int(x) : int(y);
+		int limit = (horizontal_edge ? width : height) - 1;
+
+		int   distances[2] = { 0, 0 };
+		float end_deltas[2] = { 0.f, 0.f };
+
+		for (int direction = 0; direction < 2; direction++)
+		{
+			int sign = direction == 0 ? -1 : 1;
+
+			for (int step = 1; step <= int(search_steps); step++)
+			{
+				int coordinate = position + sign * step;
+
+				if (coordinate < 0 || coordinate > limit) break;
+
+				const uint8_t* sample = center + sign * step * along;
+
+				distances[direction] = step;
+				end_deltas[direction] = (float(sample[0]) + float(sample[across])) * 0.5f - edge_luma;
+
+				if (std::abs(end_deltas[direction]) >= gradient) break;
+			}
+		}
+
+		// Only the end nearest to the pixel matters, and only when the edge actually crosses the pixel on the way there.
+
+		int   nearest = distances[0] < distances[1] ? 0 : 1;
+		float edge_offset = 0.f;
+
+		if (distances[0] + distances[1] > 0 && ((m - edge_luma) < 0.f) != (end_deltas[nearest] < 0.f))
+		{
+			edge_offset = 0.5f - float(distances[nearest]) / float(distances[0] + distances[1]);
+		}
+
+		// Details thinner than a pixel don't form long edges, so they are blended by how much they differ from their surroundings.
+
+		float average = (2.f * (n + s + w + e) + nw + ne + sw + se) / 12.f;
+		float subpixel = std::min(std::abs(average - m) / range, 1.f);
+
+		subpixel = (-2.f * subpixel + 3.f) * subpixel * subpixel;
+		subpixel = subpixel * subpixel * subpixel_quality;
+
+		float blend = std::max(edge_offset, subpixel);
+
+		if (blend <= 0.f) return;
+
+		const Rgb888& own = source[index];
+		const Rgb888& other = source[index + across];
+		Rgb888& target = color_buffer.pixels()[index];
+
+		target.red()   = uint8_t(float(own.red())   + (float(other.red())   - float(own.red()))   * blend + 0.5f);
+		target.green() = uint8_t(float(own.green()) + (float(other.green()) - float(own.green())) * blend + 0.5f);
+		target.blue()  = uint8_t(float(own.blue())  + (float(other.blue())  - float(own.blue()))  * blend + 0.5f);
+	}
+}
@@ -0,0 +1,207 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Image_Scaler.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+
+namespace MScenary
+{
+	// The filter walks the channels of the pixels as plain bytes.
+
+	static_assert(sizeof(Rgb888) == 3, "Rgb888 pixels are expected to be three packed bytes");
+
+	Image_Scaler::Image_Scaler()
+		:
+		filtered_sources{ -1, -1 },
+		table_source(0),
+		table_width(0),
+		table_begin(0),
+		table_end(0),
+		table_filter(BILINEAR_FILTER)
+	{
+	}
+
+	void Image_Scaler::blit(const Color_Buffer& source, Color_Buffer& target, const Screen_Rect& destination, Scale_Filter filter)
+	{
+		unsigned source_width = source.get_width();
+		unsigned source_height = source.get_height();
+
+		if (destination.is_empty() || source_width == 0 || source_height == 0) return;
+
+		unsigned width = unsigned(destination.right - destination.left);
+		unsigned height = unsigned(destination.bottom - destination.top);
+
+		// At the same size there's nothing to filter.
+
+		if (width == source_width && height == source_height)
+		{
+			target.blit(source, destination.left, destination.top);
+			return;
+		}
+
+		// Only the part of the rectangle inside the target is drawn.
+
+		int left = std::max(destination.left, 0);
+		int top = std::max(destination.top, 0);
+		int right = std::min(destination.right, int(target.get_width()));
+		int bottom = std::min(destination.bottom, int(target.get_height()));
+
+		if (left >= right || top >= bottom) return;
+
+		build_columns(source_width, width, unsigned(left - destination.left), unsigned(right - destination.left), filter);
+
+		const uint8_t* source_bytes = reinterpret_cast<const uint8_t*>(source.pixels());
+		uint8_t*       target_bytes = reinterpret_cast<uint8_t*>(target.pixels());
+
+		size_t source_pitch = size_t(source_width) * 3;
+		size_t target_pitch = size_t(target.get_width()) * 3;
+		size_t columns = size_t(right - left);
+		size_t channels = columns * 3;
+
+		float ratio = float(source_height) / float(height);
+
+		if (filter == NEAREST_FILTER)
+		{
+			for (int y = top; y < bottom; y++)
+			{
+				unsigned       row = std::min(unsigned((float(y - destination.top) + 0.5f) * ratio), source_height - 1);
+				const uint8_t* input = source_bytes + size_t(row) * source_pitch;
+				uint8_t*       output = target_bytes + size_t(y) * target_pitch + size_t(left) * 3;
+
+				for (size_t column = 0; column < columns; column++, output += 3)
+				{
+					const uint8_t* pixel = input + column_offsets[column * 2];
+
+					output[0] = pixel[0];
+					output[1] = pixel[1];
+					output[2] = pixel[2];
+				}
+			}
+
+			return;
+		}
+
+		// Every call brings a new image, so nothing filtered before can be reused.
+
+		filtered_sources[0] = filtered_sources[1] = -1;
+
+	#if MSCENARY_SSE2
+		const bool vectorized = simd::enabled();
+	#endif
+
+		for (int y = top; y < bottom; y++)
+		{
+			float position = std::max((float(y - destination.top) + 0.5f) * ratio - 0.5f, 0.f);
+			int   upper_row = int(std::min(unsigned(position), source_height - 1));
+			int   lower_row = std::min(upper_row + 1, int(source_height) - 1);
+
+			int16_t weight = int16_t((position - float(upper_row)) * 128.f + 0.5f);
+
+			// The two source rows are filtered the first time a target row needs them, into whichever slot doesn't hold the other one.
+
+			const int16_t* rows[2];
+			int needed[2] = { upper_row, lower_row };
+			int slots[2];
+
+			for (unsigned index = 0; index < 2; index++)
+			{
+				int slot = filtered_sources[0] == needed[index] ? 0 : filtered_sources[1] == needed[index] ? 1 : -1;
+
+				if (slot < 0)
+				{
+					slot = index == 1 ? 1 - slots[0] : (filtered_sources[0] == lower_row ? 1 : 0);
+
+					filter_row(source_bytes + size_t(needed[index]) * source_pitch, filtered_rows[slot].data());
+					filtered_sources[slot] = needed[index];
+				}
+
+				slots[index] = slot;
+				rows[index] = filtered_rows[slot].data();
+			}
+
+			uint8_t* output = target_bytes + size_t(y) * target_pitch + size_t(left) * 3;
+			size_t   index = 0;
+
+		#if MSCENARY_SSE2
+
+			const __m128i weights = _mm_set1_epi16(weight);
+
+			for (; vectorized && index + 8 <= channels; index += 8)
+			{
+				__m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[0] + index));
+				__m128i lower = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[1] + index));
+
+				// The difference fits in 9 bits and the weight in 8, so the product can't overflow 16 bits.
+
+				__m128i blended = _mm_add_epi16(upper, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(lower, upper), weights), 7));
+
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(output + index), _mm_packus_epi16(blended, blended));
+			}
+
+		#endif
+
+			for (; index < channels; index++)
+			{
+				output[index] = uint8_t(rows[0][index] + (((rows[1][index] - rows[0][index]) * weight) >> 7));
+			}
+		}
+	}
+
+	void Image_Scaler::build_columns(unsigned source_width, unsigned width, unsigned begin, unsigned end, Scale_Filter filter)
+	{
+		if (source_width == table_source && width == table_width && begin == table_begin && end == table_end && filter == table_filter) return;
+
+		unsigned columns = end - begin;
+
+		column_offsets.resize(size_t(columns) * 2);
+		column_weights.resize(columns);
+
+		float ratio = float(source_width) / float(width);
+
+		for (unsigned x = begin; x < end; x++)
+		{
+			// The nearest pixel is the one under the center, bilinear blends the two whose centers are around it.
+
+			float    position = filter == NEAREST_FILTER ? (float(x) + 0.5f) * ratio : std::max((float(x) + 0.5f) * ratio - 0.5f, 0.f);
+			unsigned left = std::min(unsigned(position), source_width - 1);
+			unsigned right = filter == NEAREST_FILTER ? left : std::min(left + 1, source_width - 1);
+
+			column_offsets[(x - begin) * 2 + 0] = left * 3;
+			column_offsets[(x - begin) * 2 + 1] = right * 3;
+			column_weights[x - begin] = filter == NEAREST_FILTER ? 0 : int16_t((position - float(left)) * 128.f + 0.5f);
+		}
+
+		if (filter == BILINEAR_FILTER)
+		{
+			for (vector<int16_t>& row : filtered_rows)
+			{
+				row.resize(size_t(columns) * 3);
+			}
+		}
+
+		table_source = source_width;
+		table_width = width;
+		table_begin = begin;
+		table_end = end;
+		table_filter = filter;
+	}
+
+	void Image_Scaler::filter_row(const uint8_t* source, int16_t* filtered) const
+	{
+		for (unsigned x = 0, columns = table_end - table_begin; x < columns; x++)
+		{
+			const uint8_t* left = source + column_offsets[x * 2 + 0];
+			const uint8_t* right = source + column_offsets[x * 2 + 1];
+			int            weight = column_weights[x];
+
+			filtered[x * 3 + 0] = int16_t(left[0] + (((right[0] - left[0]) * weight) >> 7));
+			filtered[x * 3 + 1] = int16_t(left[1] + (((right[1] - left[1]) * weight) >> 7));
+			filtered[x * 3 + 2] = int16_t(left[2] + (((right[2] - left[2]) * weight) >> 7));
+		}
+	}
+}
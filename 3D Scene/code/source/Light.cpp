@@ -5,40 +5,56 @@
   */
 
 #include "../header/Light.hpp"
+#include "../header/math.hpp"
+
+#include <algorithm>
 
 namespace MScenary
 {
 	void Light::update()
 	{
-		static float movement_aux = 0;
-		static int direction = 1; // Initial direction
+		if (!animated) return;
 
 		if (movement_aux >= 0.7f || movement_aux <= -0.5f)
 		{
-			direction *= -1; // Change direction
+			movement_direction *= -1; // Change direction
 		}
 
-		movement_aux += direction * 0.02f;
+		movement_aux += movement_direction * 0.02f;
 
 		transform->set_position(0.f, movement_aux, 0.f);
 	}
 
 	void Light::apply_view_transform(const Matrix44& view_matrix)
 	{
-		//TODO aplicar un nuevo transform al transform
-		transform->get_transform_matrix() = view_matrix * transform->get_transform_matrix();
+		world_position = Vector3f(transform->get_transform_matrix()[3]);
+		view_position = calculate_view_position(view_matrix);
+		view_direction = calculate_view_direction(view_matrix);
 	}
 
-	float Light::calculate_light_intensity(const Vector3f& point, const Vector3f& normal)
+	float Light::calculate_light_intensity(const Vector3f& point, const Vector3f& normal) const
 	{
 		//LAMBERT MODEL  L ^ N
 
-		Vector3f& l = glm::normalize(transform->get_position() - point);
+		Vector3f l = type == DIRECTIONAL ? -view_direction : view_position - point;
+
+		float distance_squared = glm::dot(l, l);
+
+		if (distance_squared <= 0.f) return 0.f;
+
+		float dot_product = glm::dot(l, normal) / std::sqrt(distance_squared);
 
-		float dot_product = glm::dot(l, normal);
+		// Smooth fade that gets to 0 right at the range, so the light can be culled there without a visible edge.
 
-		float total_intensity = ambient_intensity + (intensity * dot_product);
+		float attenuation = 1.f;
+
+		if (type == POINT && range > 0.f)
+		{
+			float fade = std::max(1.f - distance_squared / (range * range), 0.f);
+
+			attenuation = fade * fade;
+		}
 
-		return glm::clamp(total_intensity, ambient_intensity, 1.f);
+		return intensity * std::max(dot_product, 0.f) * attenuation;
 	}
-}
\ No newline at end of file
+}
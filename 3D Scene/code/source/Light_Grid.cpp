@@ -0,0 +1,304 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Light_Grid.hpp"
+#include "../header/Light.hpp"
+#include "../header/Shadow_Map.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace MScenary
+{
+	void Light_Grid::build(const vector<Light*>& lights, const Matrix44& view_matrix, const Matrix44& projection_matrix, unsigned width, unsigned height)
+	{
+		columns = std::max((width + tile_size - 1) / tile_size, 1u);
+		rows = std::max((height + tile_size - 1) / tile_size, 1u);
+
+		size_t tile_count = size_t(columns) * rows;
+
+		ambient_intensity = 0.f;
+
+		tile_light_counts.assign(tile_count, 0);
+		light_bounds.resize(lights.size() * 4);
+		light_positions.resize(lights.size());
+		shadow_maps.clear();
+		shadow_lookups.clear();
+
+		// First every light is bounded and counted in the tiles it reaches, so the packs of every tile can be laid out one after another.
+
+		for (size_t index = 0; index < lights.size(); index++)
+		{
+			const Light& light = *lights[index];
+			unsigned* bounds = light_bounds.data() + index * 4;
+
+			light_positions[index] = light.get_type() == Light::DIRECTIONAL ? -light.calculate_view_direction(view_matrix) : light.calculate_view_position(view_matrix);
+
+			ambient_intensity = std::max(ambient_intensity, light.get_ambient_intensity());
+
+			if (light.is_unbounded())
+			{
+				bounds[0] = 0; bounds[1] = columns - 1;
+				bounds[2] = 0; bounds[3] = rows - 1;
+			}
+			else if (!get_tile_bounds(light.get_world_position(), light_positions[index].z, light.get_range(), projection_matrix, width, height, bounds))
+			{
+				// An empty range, so the light is skipped from now on.
+
+				bounds[0] = 1; bounds[1] = 0;
+				continue;
+			}
+
+			for (unsigned row = bounds[2]; row <= bounds[3]; row++)
+			{
+				for (unsigned column = bounds[0]; column <= bounds[1]; column++)
+				{
+					tile_light_counts[row * columns + column]++;
+				}
+			}
+		}
+
+		tile_offsets.resize(tile_count + 1);
+
+		uint32_t pack_count = 0;
+
+		for (size_t tile = 0; tile < tile_count; tile++)
+		{
+			tile_offsets[tile] = pack_count;
+			pack_count += (tile_light_counts[tile] + 3) / 4;
+		}
+
+		tile_offsets[tile_count] = pack_count;
+
+		// The free lanes are left as directional lights without intensity, which add nothing and can't divide by 0.
+
+		Light_Pack empty_pack = {};
+
+		std::fill(std::begin(empty_pack.y), std::end(empty_pack.y), 1.f);
+		std::fill(std::begin(empty_pack.shadow), std::end(empty_pack.shadow), -1);
+
+		packs.assign(pack_count, empty_pack);
+
+		// Then every light is written in the next free lane of the tiles it reaches, counting them again from 0.
+
+		std::fill(tile_light_counts.begin(), tile_light_counts.end(), 0);
+
+		for (size_t index = 0; index < lights.size(); index++)
+		{
+			const Light& light = *lights[index];
+			const unsigned* bounds = light_bounds.data() + index * 4;
+
+			bool directional = light.get_type() == Light::DIRECTIONAL;
+
+			const Vector3f& position = light_positions[index];
+
+			float inverse_range_squared = light.is_unbounded() ? 0.f : 1.f / (light.get_range() * light.get_range());
+
+			int32_t shadow = -1;
+
+			if (light.get_shadow_map() && bounds[0] <= bounds[1])
+			{
+				shadow = int32_t(shadow_maps.size());
+				shadow_maps.push_back(light.get_shadow_map());
+				shadow_lookups.push_back(light.get_shadow_map()->get_lookup_matrix(view_matrix));
+			}
+
+			for (unsigned row = bounds[2]; bounds[0] <= bounds[1] && row <= bounds[3]; row++)
+			{
+				for (unsigned column = bounds[0]; column <= bounds[1]; column++)
+				{
+					uint32_t tile = row * columns + column;
+					uint32_t slot = tile_light_counts[tile]++;
+
+					Light_Pack& pack = packs[tile_offsets[tile] + slot / 4];
+					unsigned lane = slot % 4;
+
+					pack.x[lane] = position.x;
+					pack.y[lane] = position.y;
+					pack.z[lane] = position.z;
+					pack.point[lane] = directional ? 0.f : 1.f;
+					pack.intensity[lane] = light.get_intensity();
+					pack.inverse_range_squared[lane] = inverse_range_squared;
+					pack.shadow[lane] = shadow;
+				}
+			}
+		}
+	}
+
+	void Light_Grid::calculate_shadow_visibility(const float* x, const float* y, const float* z, float* visibility, size_t count) const
+	{
+		for (size_t index = 0; index < shadow_maps.size(); index++)
+		{
+			shadow_maps[index]->calculate_visibility(shadow_lookups[index], x, y, z, visibility + index * count, count);
+		}
+	}
+
+	void Light_Grid::calculate_light_intensities
+	(
+		const uint32_t* tiles,
+		const float* x,
+		const float* y,
+		const float* z,
+		const float* normal_x,
+		const float* normal_y,
+		const float* normal_z,
+		const float* visibility,
+		float* intensities,
+		size_t count
+	) const
+	{
+	#if MSCENARY_SSE2
+		const __m128 zero  = _mm_setzero_ps();
+		const __m128 one   = _mm_set1_ps(1.f);
+		const __m128 half  = _mm_set1_ps(0.5f);
+		const __m128 three = _mm_set1_ps(3.f);
+
+		const bool vectorized = simd::enabled();
+	#endif
+
+		for (size_t index = 0; index < count; index++)
+		{
+			const Light_Pack* pack = packs.data() + tile_offsets[tiles[index]];
+			const Light_Pack* end = packs.data() + tile_offsets[tiles[index] + 1];
+
+			float total_intensity = ambient_intensity;
+
+		#if MSCENARY_SSE2
+
+			// The point is repeated in every lane and lit by the four lights of a pack at once. The packs are all used up here,
+			// the plain loop below is left with nothing to do.
+
+			if (vectorized)
+			{
+				const __m128 point_x = _mm_set1_ps(x[index]);
+				const __m128 point_y = _mm_set1_ps(y[index]);
+				const __m128 point_z = _mm_set1_ps(z[index]);
+				const __m128 n_x = _mm_set1_ps(normal_x[index]);
+				const __m128 n_y = _mm_set1_ps(normal_y[index]);
+				const __m128 n_z = _mm_set1_ps(normal_z[index]);
+
+				__m128 sum = zero;
+
+				for (; pack < end; ++pack)
+				{
+					__m128 is_point = _mm_load_ps(pack->point);
+
+					__m128 l_x = _mm_sub_ps(_mm_load_ps(pack->x), _mm_mul_ps(point_x, is_point));
+					__m128 l_y = _mm_sub_ps(_mm_load_ps(pack->y), _mm_mul_ps(point_y, is_point));
+					__m128 l_z = _mm_sub_ps(_mm_load_ps(pack->z), _mm_mul_ps(point_z, is_point));
+
+					__m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l_x, l_x), _mm_mul_ps(l_y, l_y)), _mm_mul_ps(l_z, l_z));
+
+					// The reciprocal square root estimate only has 12 bits, a Newton-Raphson step takes it close to full precision.
+
+					__m128 inverse_distance = _mm_rsqrt_ps(distance_squared);
+
+					inverse_distance = _mm_mul_ps
+					(
+						_mm_mul_ps(half, inverse_distance),
+						_mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(distance_squared, inverse_distance), inverse_distance))
+					);
+
+					__m128 dot_product = _mm_mul_ps
+					(
+						_mm_add_ps(_mm_add_ps(_mm_mul_ps(l_x, n_x), _mm_mul_ps(l_y, n_y)), _mm_mul_ps(l_z, n_z)),
+						inverse_distance
+					);
+
+					// _mm_max_ps returns its second operand when the first one is NaN, so a light right on the point adds nothing.
+
+					dot_product = _mm_max_ps(dot_product, zero);
+
+					__m128 fade = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(distance_squared, _mm_load_ps(pack->inverse_range_squared))), zero);
+
+					__m128 contribution = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(pack->intensity), dot_product), _mm_mul_ps(fade, fade));
+
+					// The shadow indices of a pack without shadowed lights are all -1, so ANDing them keeps the sign bit.
+
+					if ((pack->shadow[0] & pack->shadow[1] & pack->shadow[2] & pack->shadow[3]) >= 0)
+					{
+						contribution = _mm_mul_ps(contribution, _mm_setr_ps
+						(
+							pack->shadow[0] < 0 ? 1.f : visibility[pack->shadow[0] * count + index],
+							pack->shadow[1] < 0 ? 1.f : visibility[pack->shadow[1] * count + index],
+							pack->shadow[2] < 0 ? 1.f : visibility[pack->shadow[2] * count + index],
+							pack->shadow[3] < 0 ? 1.f : visibility[pack->shadow[3] * count + index]
+						));
+					}
+
+					sum = _mm_add_ps(sum, contribution);
+				}
+
+				sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+				sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+				total_intensity += _mm_cvtss_f32(sum);
+			}
+
+		#endif
+
+			for (; pack < end; ++pack)
+			{
+				for (unsigned lane = 0; lane < 4; lane++)
+				{
+					float l_x = pack->x[lane] - x[index] * pack->point[lane];
+					float l_y = pack->y[lane] - y[index] * pack->point[lane];
+					float l_z = pack->z[lane] - z[index] * pack->point[lane];
+
+					float distance_squared = l_x * l_x + l_y * l_y + l_z * l_z;
+
+					if (distance_squared <= 0.f) continue;
+
+					float dot_product = (l_x * normal_x[index] + l_y * normal_y[index] + l_z * normal_z[index]) / std::sqrt(distance_squared);
+
+					float fade = std::max(1.f - distance_squared * pack->inverse_range_squared[lane], 0.f);
+
+					float shadow = pack->shadow[lane] < 0 ? 1.f : visibility[pack->shadow[lane] * count + index];
+
+					total_intensity += pack->intensity[lane] * std::max(dot_product, 0.f) * fade * fade * shadow;
+				}
+			}
+
+			intensities[index] = std::min(std::max(total_intensity, ambient_intensity), 1.f);
+		}
+	}
+
+	bool Light_Grid::get_tile_bounds(const Vector3f& center, float depth, float radius, const Matrix44& projection_matrix, unsigned width, unsigned height, unsigned bounds[4]) const
+	{
+		// Entirely behind the camera.
+
+		if (depth - radius >= 0.f) return false;
+
+		Projected_Bounds projected = project_sphere_bounds(Point3f(center), radius, projection_matrix);
+
+		// A sphere reaching the camera plane can't be projected, so the light is given the whole screen.
+
+		if (projected.crosses_camera_plane)
+		{
+			bounds[0] = 0; bounds[1] = columns - 1;
+			bounds[2] = 0; bounds[3] = rows - 1;
+
+			return true;
+		}
+
+		if (projected.x_max < -1.f || projected.y_max < -1.f || projected.x_min > 1.f || projected.y_min > 1.f) return false;
+
+		// Same mapping as the display transformation of the meshes.
+
+		float left   = (std::max(projected.x_min, -1.f) + 1.f) * 0.5f * float(width);
+		float right  = (std::min(projected.x_max,  1.f) + 1.f) * 0.5f * float(width);
+		float top    = (std::max(projected.y_min, -1.f) + 1.f) * 0.5f * float(height);
+		float bottom = (std::min(projected.y_max,  1.f) + 1.f) * 0.5f * float(height);
+
+		bounds[0] = std::min(unsigned(left) / tile_size, columns - 1);
+		bounds[1] = std::min(unsigned(right) / tile_size, columns - 1);
+		bounds[2] = std::min(unsigned(top) / tile_size, rows - 1);
+		bounds[3] = std::min(unsigned(bottom) / tile_size, rows - 1);
+
+		return true;
+	}
+}
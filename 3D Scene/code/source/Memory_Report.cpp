@@ -0,0 +1,137 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Memory_Report.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+namespace MScenary
+{
+	namespace
+	{
+		/**
+		 * @brief Formats a number of bytes in the largest unit that keeps it above 1.
+		 *
+		 * @param bytes The bytes.
+		 * @return The text, like "12.5 MiB".
+		 */
+		std::string format_bytes(size_t bytes)
+		{
+			static const char* const units[] = { "B", "KiB", "MiB", "GiB" };
+
+			double   value = double(bytes);
+			unsigned unit = 0;
+
+			while (value >= 1024. && unit < 3)
+			{
+				value /= 1024.;
+				unit++;
+			}
+
+			char text[32];
+
+			std::snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+
+			return text;
+		}
+	}
+
+	void Memory_Report::begin_group(const std::string& name)
+	{
+		entries.push_back({ name, unsigned(open_groups.size()), 0, 0, 0 });
+		open_groups.push_back(entries.size() - 1);
+	}
+
+	void Memory_Report::end_group()
+	{
+		assert(!open_groups.empty());
+
+		open_groups.pop_back();
+	}
+
+	void Memory_Report::add(const std::string& name, size_t source_bytes, size_t transient_bytes, size_t scratch_bytes)
+	{
+		entries.push_back({ name, unsigned(open_groups.size()), source_bytes, transient_bytes, scratch_bytes });
+
+		for (size_t group : open_groups)
+		{
+			entries[group].source_bytes += source_bytes;
+			entries[group].transient_bytes += transient_bytes;
+			entries[group].scratch_bytes += scratch_bytes;
+		}
+	}
+
+	size_t Memory_Report::get_total_bytes() const
+	{
+		size_t total = 0;
+
+		for (const Entry& entry : entries)
+		{
+			if (entry.depth == 0) total += entry.source_bytes + entry.transient_bytes;
+		}
+
+		return total;
+	}
+
+	void Memory_Report::dump(std::ostream& stream) const
+	{
+		char line[160];
+
+		std::snprintf(line, sizeof(line), "%-40s %12s %12s %12s\n", "", "source", "transient", "scratch");
+		stream << line;
+
+		for (const Entry& entry : entries)
+		{
+			std::string name = std::string(entry.depth * 2, ' ') + entry.name;
+
+			std::snprintf(line, sizeof(line), "%-40s %12s %12s %12s\n", name.c_str(), format_bytes(entry.source_bytes).c_str(), format_bytes(entry.transient_bytes).c_str(), format_bytes(entry.scratch_bytes).c_str());
+			stream << line;
+		}
+
+		stream << "total " << format_bytes(get_total_bytes()) << ", peak " << format_bytes(peak_bytes);
+
+		if (peak_resident_bytes > 0) stream << ", peak resident " << format_bytes(peak_resident_bytes);
+
+		stream << '\n';
+	}
+
+	size_t Memory_Report::query_peak_resident_bytes()
+	{
+		#ifdef _WIN32
+
+		PROCESS_MEMORY_COUNTERS counters;
+
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return size_t(counters.PeakWorkingSetSize);
+
+		return 0;
+
+		#else
+
+		rusage usage;
+
+		if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+
+		// Linux gives it in kilobytes, macOS in bytes.
+
+		#ifdef __APPLE__
+		return size_t(usage.ru_maxrss);
+		#else
+		return size_t(usage.ru_maxrss) * 1024;
+		#endif
+
+		#endif
+	}
+}
@@ -5,15 +5,84 @@
   */
 
 #include "../header/Mesh.hpp"
-#include "../header/Light.hpp"
+#include "../header/Frame_Arena.hpp"
+#include "../header/Light_Grid.hpp"
+#include "../header/Memory_Report.hpp"
 #include "../header/math.hpp"
+#include "../header/Mesh_Simplifier.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace MScenary
 {
+	namespace
+	{
+		/**
+		 * @brief Unfolds octahedral normals back onto the unit sphere, four at a time.
+		 *
+		 * @param x, y The encoded normals, in [-1, 1], overwritten with the first two components.
+		 * @param z Receives the third components.
+		 * @param count The number of normals, a multiple of four.
+		 */
+		void decode_normals(float* x, float* y, float* z, size_t count)
+		{
+			size_t slot = 0;
+
+		#if MSCENARY_SSE2
+
+			const __m128 sign_mask = _mm_set1_ps(-0.f);
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 zero = _mm_setzero_ps();
+			const bool   vectorized = simd::enabled();
+
+			for (; vectorized && slot < count; slot += 4)
+			{
+				__m128 n_x = _mm_loadu_ps(x + slot);
+				__m128 n_y = _mm_loadu_ps(y + slot);
+				__m128 n_z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, n_x)), _mm_andnot_ps(sign_mask, n_y));
+
+				// The lower half was folded over the diagonals of the square, moving x and y back towards 0 by how far below it is undoes it.
+
+				__m128 fold = _mm_max_ps(_mm_sub_ps(zero, n_z), zero);
+
+				n_x = _mm_sub_ps(n_x, _mm_or_ps(fold, _mm_and_ps(n_x, sign_mask)));
+				n_y = _mm_sub_ps(n_y, _mm_or_ps(fold, _mm_and_ps(n_y, sign_mask)));
+
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(n_x, n_x), _mm_mul_ps(n_y, n_y)), _mm_mul_ps(n_z, n_z)));
+				__m128 inverse_length = _mm_div_ps(one, length);
+
+				_mm_storeu_ps(x + slot, _mm_mul_ps(n_x, inverse_length));
+				_mm_storeu_ps(y + slot, _mm_mul_ps(n_y, inverse_length));
+				_mm_storeu_ps(z + slot, _mm_mul_ps(n_z, inverse_length));
+			}
+
+		#endif
+
+			for (; slot < count; slot++)
+			{
+				float n_x = x[slot];
+				float n_y = y[slot];
+				float n_z = 1.f - std::abs(n_x) - std::abs(n_y);
+				float fold = std::max(-n_z, 0.f);
+
+				n_x += std::signbit(n_x) ? fold : -fold;
+				n_y += std::signbit(n_y) ? fold : -fold;
+
+				float inverse_length = 1.f / std::sqrt(n_x * n_x + n_y * n_y + n_z * n_z);
+
+				x[slot] = n_x * inverse_length;
+				y[slot] = n_y * inverse_length;
+				z[slot] = n_z * inverse_length;
+			}
+		}
+	}
+
 	Mesh::Mesh(size_t number_of_vertices, aiMesh* mesh)
 	{
-		render_transformation = Matrix44(1);
-		render_matrix_calculated = false;
+		dequantization = Matrix44(1);
+		vertex_count = number_of_vertices;
 
 		original_vertices.resize(number_of_vertices);
 		original_normals.resize(number_of_vertices);
@@ -33,12 +102,8 @@ namespace MScenary
 			original_normals[index] = Vector4f(normal.x, normal.y, normal.z, 0.f);
 		}
 
-		transformed_vertices.resize(number_of_vertices);
-		display_vertices.resize(number_of_vertices);
-
 		// Set the colors as semi-grey for all the vertices
 
-		transformed_colors.resize(number_of_vertices);
 		original_colors.resize(number_of_vertices);
 
 		for (size_t index = 0; index < number_of_vertices; index++)
@@ -50,9 +115,10 @@ namespace MScenary
 
 		size_t number_of_triangles = mesh->mNumFaces;
 
-		original_indices.resize(number_of_triangles * 3);
+		lod_indices.resize(1);
+		lod_indices[0].resize(number_of_triangles * 3);
 
-		Index_Buffer::iterator indices_iterator = original_indices.begin();
+		Index_Buffer::iterator indices_iterator = lod_indices[0].begin();
 
 		for (size_t index = 0; index < number_of_triangles; index++)
 		{
@@ -68,75 +134,683 @@ namespace MScenary
 			*indices_iterator++ = int(indices[1]);
 			*indices_iterator++ = int(indices[2]);
 		}
+
+		generate_lods();
+	}
+
+	void Mesh::generate_lods()
+	{
+		// Bounding sphere centered in the bounding box, good enough for the culling and the LOD selection.
+
+		Point3f min_corner(original_vertices.empty() ? Vertex(0.f) : original_vertices[0]);
+		Point3f max_corner(min_corner);
+
+		for (const Vertex& vertex : original_vertices)
+		{
+			min_corner = glm::min(min_corner, Point3f(vertex));
+			max_corner = glm::max(max_corner, Point3f(vertex));
+		}
+
+		bounding_center = (min_corner + max_corner) * 0.5f;
+		bounding_radius = 0.f;
+
+		for (const Vertex& vertex : original_vertices)
+		{
+			bounding_radius = std::max(bounding_radius, glm::length(Point3f(vertex) - bounding_center));
+		}
+
+		// Each level targets half the triangles of the previous one. The allowed error grows with the level as well,
+		// since every level is used at half the projected size of the previous one.
+
+		size_t triangle_count = lod_indices[0].size() / 3;
+
+		if (triangle_count >= min_lod_triangles * 2)
+		{
+			Mesh_Simplifier simplifier(original_vertices, lod_indices[0]);
+
+			float max_error = bounding_radius * 0.005f;
+
+			while (lod_indices.size() < max_lod_levels && triangle_count >= min_lod_triangles * 2)
+			{
+				max_error *= 2.f;
+
+				size_t simplified_count = simplifier.simplify(triangle_count / 2, max_error * max_error);
+
+				// Stop once the simplifier can't get rid of a meaningful amount of triangles without breaking the error bound.
+
+				if (simplified_count > triangle_count - triangle_count / 8) break;
+
+				lod_indices.emplace_back();
+				simplifier.get_indices(lod_indices.back());
+
+				triangle_count = simplified_count;
+			}
+		}
+
+		// Every level is split into meshlets so the parts of the mesh out of view or facing away can be culled as a whole.
+
+		lod_meshlets.resize(lod_indices.size());
+
+		for (size_t level = 0; level < lod_indices.size(); level++)
+		{
+			Meshlet::build(original_vertices, lod_indices[level], lod_meshlets[level]);
+
+			lod_index_counts.push_back(lod_indices[level].size());
+		}
+	}
+
+	size_t Mesh::select_lod(float screen_radius, size_t current_level) const
+	{
+		size_t level = std::min(current_level, lod_meshlets.size() - 1);
+
+		// The radius below which level "n" is used is lod_base_radius / 2^(n-1).
+
+		while (level + 1 < lod_meshlets.size() && screen_radius < lod_base_radius / float(1 << level) * (1.f - lod_hysteresis))
+		{
+			level++;
+		}
+
+		while (level > 0 && screen_radius > lod_base_radius / float(1 << (level - 1)) * (1.f + lod_hysteresis))
+		{
+			level--;
+		}
+
+		return level;
+	}
+
+	void Mesh::render(Rasterizer< Color_Buffer >& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, size_t lod, Multisample_Buffer* multisample_buffer) const
+	{
+		Frame_Arena::Scope scope(Frame_Arena::local());
+		Render_Pass        pass;
+
+		prepare_triangles(pass, lod, rasterizer.get_color_buffer().get_width(), rasterizer.get_color_buffer().get_height(), transform_matrix, model_view_matrix, light_grid, rasterizer.get_stats());
+
+		for (size_t triangle = 0; triangle < pass.visible_index_count; triangle += 3)
+		{
+			const int* indices = pass.visible_triangles + triangle;
+
+			// With anti-aliasing the triangle goes to the multisampled target from its unsnapped position.
+
+			if (multisample_buffer)
+			{
+				multisample_buffer->fill_triangle(pass.subpixel_vertices[indices[0]], pass.subpixel_vertices[indices[1]], pass.subpixel_vertices[indices[2]], pass.transformed_colors[indices[0]]);
+				continue;
+			}
+
+			// Se the color of the polygon based on previous calculations
+
+			rasterizer.set_color(pass.transformed_colors[indices[0]]);
+
+			// Fill the polygon.
+
+			rasterizer.fill_convex_polygon_z_buffer(pass.display_vertices, indices, indices + 3);
+		}
+	}
+
+	void Mesh::render_translucent(Transparency_Buffer& transparency_buffer, const vector<int>& z_buffer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, size_t lod, float opacity, Raster_Stats* stats) const
+	{
+		Frame_Arena::Scope scope(Frame_Arena::local());
+		Render_Pass        pass;
+
+		prepare_triangles(pass, lod, transparency_buffer.get_width(), transparency_buffer.get_height(), transform_matrix, model_view_matrix, light_grid, stats);
+
+		// The triangles are accumulated in whatever order they come, the transparency buffer doesn't need them sorted.
+
+		for (size_t triangle = 0; triangle < pass.visible_index_count; triangle += 3)
+		{
+			const int* indices = pass.visible_triangles + triangle;
+
+			transparency_buffer.fill_triangle(pass.display_vertices, indices, pass.transformed_colors[indices[0]], opacity, z_buffer);
+		}
 	}
 
-	void Mesh::render(Rasterizer< Color_Buffer >& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, Light& light_source)
+	void Mesh::prepare_triangles(Render_Pass& pass, size_t lod, unsigned width, unsigned height, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, const Light_Grid& light_grid, Raster_Stats* stats) const
 	{
-		unsigned width = rasterizer.get_color_buffer().get_width();
-		unsigned height = rasterizer.get_color_buffer().get_height();
+		Matrix44 render_transformation = get_display_transformation(width, height);
+
+		// Frustum planes and camera position in model coordinates, so the bounds of the meshlets can be tested as they are.
+
+		Vector4f frustum_planes[6];
+
+		extract_frustum_planes(transform_matrix, frustum_planes);
+
+		Point3f eye(inverse(model_view_matrix)[3]);
+
+		// Compact positions are decoded by the same matrix that transforms them.
+
+		Matrix44 position_matrix = transform_matrix * dequantization;
+
+		// Every visible vertex and triangle gets room in the arena, only the largest mesh rendered decides how much it needs.
+
+		Frame_Arena& arena = Frame_Arena::local();
+
+		pass.transformed_vertices = arena.allocate<Vertex>(vertex_count);
+		pass.subpixel_vertices = arena.allocate<Vertex>(vertex_count);
+		pass.display_vertices = arena.allocate<Point4i>(vertex_count);
+		pass.transformed_colors = arena.allocate<Color>(vertex_count);
+		pass.vertex_marks = arena.allocate<uint8_t>(vertex_count);
+		pass.visible_triangles = arena.allocate<int>(lod_index_counts[lod]);
+		pass.lit_vertices = arena.allocate<int>(vertex_count);
+
+		pass.visible_index_count = 0;
+		pass.lit_vertex_count = 0;
+
+		// The vertices shared by several meshlets are only transformed by the first one that uses them in this call.
+
+		std::memset(pass.vertex_marks, 0, vertex_count);
+
+		const bool vectorized = simd::enabled();
+
+		for (const Meshlet& meshlet : lod_meshlets[lod])
+		{
+			// Whole meshlets out of the view or facing away are skipped before touching any of their vertices.
+
+			if (!is_sphere_in_frustum(frustum_planes, meshlet.center, meshlet.radius))
+			{
+				if (stats) stats->triangles_culled[Raster_Stats::MESHLET_FRUSTUM] += meshlet.triangles.size() / 3;
+				continue;
+			}
+
+			if (meshlet.is_backfacing(eye))
+			{
+				if (stats) stats->triangles_culled[Raster_Stats::MESHLET_BACKFACE] += meshlet.triangles.size() / 3;
+				continue;
+			}
+
+			for (size_t local = 0, count = meshlet.get_vertex_count(); local < count; local++)
+			{
+				int index = meshlet.get_vertex(local);
+
+				if (pass.vertex_marks[index] & TRANSFORMED) continue;
+
+				pass.vertex_marks[index] |= TRANSFORMED;
+
+				//Vertex transformations Local Coords -> Proyected Coords.
+
+				Vertex& vertex = pass.transformed_vertices[index] = transform_vertex(position_matrix, index, vectorized);
+
+				// Proyected coords mess up the w component so we have to divide evyrithing / w to set it to 1.
+
+				float divisor = 1.f / vertex.w;
+
+				vertex.x *= divisor;
+				vertex.y *= divisor;
+				vertex.z *= divisor;
+				vertex.w = 1.f;
+
+				pass.subpixel_vertices[index] = render_transformation * vertex;
+				pass.display_vertices[index] = Point4i(pass.subpixel_vertices[index]);
+			}
+
+			for (size_t triangle = 0, end = meshlet.triangles.size(); triangle < end; triangle += 3)
+			{
+				int indices[3] =
+				{
+					meshlet.get_vertex(meshlet.triangles[triangle + 0]),
+					meshlet.get_vertex(meshlet.triangles[triangle + 1]),
+					meshlet.get_vertex(meshlet.triangles[triangle + 2])
+				};
+
+				if (is_frontface(pass.transformed_vertices, indices))
+				{
+					Point4i clipped_vertices[10];
+
+					unsigned clipped_vertices_count = clip_triangle(pass.display_vertices, indices, indices + 3, clipped_vertices, &width, &height);
+
+					if (clipped_vertices_count >= 3)
+					{
+						std::copy(indices, indices + 3, pass.visible_triangles + pass.visible_index_count);
+						pass.visible_index_count += 3;
+
+						// The triangle is flat shaded with the color of its first vertex, so that's the only one that needs lighting.
+
+						if (!(pass.vertex_marks[indices[0]] & LIT))
+						{
+							pass.vertex_marks[indices[0]] |= LIT;
+							pass.lit_vertices[pass.lit_vertex_count++] = indices[0];
+						}
+					}
+					else if (stats)
+					{
+						stats->triangles_culled[Raster_Stats::CLIPPED]++;
+					}
+				}
+				else if (stats)
+				{
+					stats->triangles_culled[Raster_Stats::BACKFACE]++;
+				}
+			}
+		}
+
+		if (stats)
+		{
+			stats->triangles_submitted += lod_index_counts[lod] / 3;
+			stats->triangles_rasterized += pass.visible_index_count / 3;
+		}
+
+		//Lightning Calculations, only for the vertices whose color is actually going to be used.
+
+		shade_vertices(pass, model_view_matrix, light_grid);
+	}
+
+	void Mesh::shade_vertices(Render_Pass& pass, const Matrix44& model_view_matrix, const Light_Grid& light_grid) const
+	{
+		size_t count = pass.lit_vertex_count;
+
+		if (count == 0) return;
+
+		// Every array is rounded up to a multiple of four, repeating the last vertex, so the loops below don't need a scalar tail.
+
+		size_t padded_count = (count + 3) & ~size_t(3);
+
+		size_t shadow_map_count = light_grid.get_shadow_map_count();
+
+		// Positions, normals, colors, intensities and shadow visibility, one array per component for the vectorized lighting.
+		// They are given back to the arena along with the rest of the buffers of the render call.
+
+		Frame_Arena& arena = Frame_Arena::local();
+
+		float*    lighting_streams = arena.allocate<float>(padded_count * (10 + shadow_map_count));
+		uint32_t* lighting_tiles = arena.allocate<uint32_t>(padded_count);
+
+		float* x           = lighting_streams;
+		float* y           = x + padded_count;
+		float* z           = y + padded_count;
+		float* normal_x    = z + padded_count;
+		float* normal_y    = normal_x + padded_count;
+		float* normal_z    = normal_y + padded_count;
+		float* red         = normal_z + padded_count;
+		float* green       = red + padded_count;
+		float* blue        = green + padded_count;
+		float* intensities = blue + padded_count;
+		float* visibility  = intensities + padded_count;
+
+		bool compact = is_compact();
+
+		for (size_t slot = 0; slot < padded_count; slot++)
+		{
+			int index = pass.lit_vertices[slot < count ? slot : count - 1];
+
+			const Color& color = original_colors[index];
+
+			lighting_tiles[slot] = light_grid.get_tile(pass.display_vertices[index].x, pass.display_vertices[index].y);
 
-		if (!render_matrix_calculated)
+			// Compact vertices are gathered still encoded, the positions are decoded by the transformation below and the normals right after.
+
+			if (compact)
+			{
+				const Quantized_Position& position = quantized_vertices[index];
+				const Encoded_Normal& normal = encoded_normals[index];
+
+				x[slot] = float(position.x);
+				y[slot] = float(position.y);
+				z[slot] = float(position.z);
+
+				normal_x[slot] = float(normal.x) * (1.f / 32767.f);
+				normal_y[slot] = float(normal.y) * (1.f / 32767.f);
+			}
+			else
+			{
+				const Vertex& vertex = original_vertices[index];
+				const Point4f& normal = original_normals[index];
+
+				x[slot] = vertex.x;
+				y[slot] = vertex.y;
+				z[slot] = vertex.z;
+
+				normal_x[slot] = normal.x;
+				normal_y[slot] = normal.y;
+				normal_z[slot] = normal.z;
+			}
+
+			red[slot] = float(color.red());
+			green[slot] = float(color.green());
+			blue[slot] = float(color.blue());
+		}
+
+		if (compact)
 		{
-			Matrix44 identity(1);
-			Matrix44 scaling = scale(identity, float(width / 2), float(height / 2), 100000000.f);
-			Matrix44 translation = translate(identity, Vector3f{ float(width / 2), float(height / 2), 0.f });
-			render_transformation = translation * scaling;
-			render_matrix_calculated = true;
+			decode_normals(normal_x, normal_y, normal_z, padded_count);
 		}
 
-		for (size_t index = 0, number_of_vertices = original_vertices.size(); index < number_of_vertices; index++)
+		// Updating the vertices and normals with the view matrix so they are in camera coords like the lights (w = 0 for the normals,
+		// so only the 3x3 part matters for them). The positions go through the dequantization first, which mustn't touch the normals.
+
+		Matrix44 position_matrix = model_view_matrix * dequantization;
+
+		size_t slot = 0;
+
+	#if MSCENARY_SSE2
+
+		const bool vectorized = simd::enabled();
+
+		__m128 m[4][3];
+		__m128 p[4][3];
+
+		for (int column = 0; column < 4; column++)
 		{
-			//Vertex transformations Local Coords -> Proyected Coords.
+			for (int row = 0; row < 3; row++)
+			{
+				m[column][row] = _mm_set1_ps(model_view_matrix[column][row]);
+				p[column][row] = _mm_set1_ps(position_matrix[column][row]);
+			}
+		}
+
+		for (; vectorized && slot < padded_count; slot += 4)
+		{
+			__m128 v_x = _mm_loadu_ps(x + slot);
+			__m128 v_y = _mm_loadu_ps(y + slot);
+			__m128 v_z = _mm_loadu_ps(z + slot);
+
+			_mm_storeu_ps(x + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0][0], v_x), _mm_mul_ps(p[1][0], v_y)), _mm_add_ps(_mm_mul_ps(p[2][0], v_z), p[3][0])));
+			_mm_storeu_ps(y + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0][1], v_x), _mm_mul_ps(p[1][1], v_y)), _mm_add_ps(_mm_mul_ps(p[2][1], v_z), p[3][1])));
+			_mm_storeu_ps(z + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(p[0][2], v_x), _mm_mul_ps(p[1][2], v_y)), _mm_add_ps(_mm_mul_ps(p[2][2], v_z), p[3][2])));
+
+			__m128 n_x = _mm_loadu_ps(normal_x + slot);
+			__m128 n_y = _mm_loadu_ps(normal_y + slot);
+			__m128 n_z = _mm_loadu_ps(normal_z + slot);
 
-			Vertex& vertex = transformed_vertices[index] = transform_matrix * original_vertices[index];
+			_mm_storeu_ps(normal_x + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][0], n_x), _mm_mul_ps(m[1][0], n_y)), _mm_mul_ps(m[2][0], n_z)));
+			_mm_storeu_ps(normal_y + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][1], n_x), _mm_mul_ps(m[1][1], n_y)), _mm_mul_ps(m[2][1], n_z)));
+			_mm_storeu_ps(normal_z + slot, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][2], n_x), _mm_mul_ps(m[1][2], n_y)), _mm_mul_ps(m[2][2], n_z)));
+		}
 
-			// Proyected coords mess up the w component so we have to divide evyrithing / w to set it to 1.
+	#endif
 
-			float divisor = 1.f / vertex.w;
+		for (; slot < padded_count; slot++)
+		{
+			Point4f vertex = position_matrix * Point4f(x[slot], y[slot], z[slot], 1.f);
+			Point4f normal = model_view_matrix * Point4f(normal_x[slot], normal_y[slot], normal_z[slot], 0.f);
 
-			vertex.x *= divisor;
-			vertex.y *= divisor;
-			vertex.z *= divisor;
-			vertex.w = 1.f;
+			x[slot] = vertex.x;
+			y[slot] = vertex.y;
+			z[slot] = vertex.z;
 
-			display_vertices[index] = Point4i(render_transformation * vertex);
+			normal_x[slot] = normal.x;
+			normal_y[slot] = normal.y;
+			normal_z[slot] = normal.z;
+		}
 
-			//Lightning Calculations, updating the normals with the view matrix so they stay in camera coords. and then setting the colors to their new value based on the light.
+		// The shadow maps are looked up once per vertex and light before the lights are added up.
 
-			Point4f& transformed_normal = model_view_matrix * original_normals[index];
+		light_grid.calculate_shadow_visibility(x, y, z, visibility, padded_count);
+		light_grid.calculate_light_intensities(lighting_tiles, x, y, z, normal_x, normal_y, normal_z, visibility, intensities, padded_count);
 
-			float light_intensity = light_source.calculate_light_intensity(transformed_vertices[index], transformed_normal);
+		// Setting the colors to their new value based on the light.
 
-			float red = (float(original_colors[index].red()) * light_intensity) / 255.f;
+		slot = 0;
 
-			transformed_colors[index].set_red(red);
-			transformed_colors[index].set_green((original_colors[index].green() * light_intensity) / 255.f);
-			transformed_colors[index].set_blue((original_colors[index].blue() * light_intensity) / 255.f);
+	#if MSCENARY_SSE2
+
+		for (; vectorized && slot < count; slot += 4)
+		{
+			__m128 intensity = _mm_loadu_ps(intensities + slot);
+
+			// Truncated to integers and narrowed with saturation down to bytes: red in 0-3, green in 4-7 and blue in 8-11.
+
+			__m128i red_green = _mm_packs_epi32
+			(
+				_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(red + slot), intensity)),
+				_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(green + slot), intensity))
+			);
+
+			__m128i blue_only = _mm_packs_epi32(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(blue + slot), intensity)), _mm_setzero_si128());
+
+			alignas(16) uint8_t bytes[16];
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(bytes), _mm_packus_epi16(red_green, blue_only));
+
+			for (size_t lane = 0; lane < 4 && slot + lane < count; lane++)
+			{
+				Color& color = pass.transformed_colors[pass.lit_vertices[slot + lane]];
+
+				color.red() = bytes[lane];
+				color.green() = bytes[lane + 4];
+				color.blue() = bytes[lane + 8];
+			}
 		}
 
-		for (int* indices = original_indices.data(), *end = indices + original_indices.size(); indices < end; indices += 3)
+	#endif
+
+		for (; slot < count; slot++)
+		{
+			Color& color = pass.transformed_colors[pass.lit_vertices[slot]];
+
+			// Truncated and clamped to bytes like the vectorized loop does, so both give the same colors.
+
+			color.red() = uint8_t(std::min(std::max(red[slot] * intensities[slot], 0.f), 255.f));
+			color.green() = uint8_t(std::min(std::max(green[slot] * intensities[slot], 0.f), 255.f));
+			color.blue() = uint8_t(std::min(std::max(blue[slot] * intensities[slot], 0.f), 255.f));
+		}
+	}
+
+	void Mesh::render_depth(Rasterizer< Depth_Target >& rasterizer, const Matrix44& transform_matrix, const Matrix44& model_view_matrix, bool orthographic) const
+	{
+		unsigned width = rasterizer.get_target().get_width();
+		unsigned height = rasterizer.get_target().get_height();
+
+		Matrix44 depth_transformation = get_display_transformation(width, height);
+
+		Frame_Arena&       arena = Frame_Arena::local();
+		Frame_Arena::Scope scope(arena);
+
+		Vertex*  transformed_vertices = arena.allocate<Vertex>(vertex_count);
+		Point4i* display_vertices = arena.allocate<Point4i>(vertex_count);
+		uint8_t* vertex_marks = arena.allocate<uint8_t>(vertex_count);
+
+		std::memset(vertex_marks, 0, vertex_count);
+
+		const bool vectorized = simd::enabled();
+
+		Vector4f frustum_planes[6];
+
+		extract_frustum_planes(transform_matrix, frustum_planes);
+
+		Point3f eye(inverse(model_view_matrix)[3]);
+
+		// Compact positions are decoded by the same matrix that transforms them.
+
+		Matrix44 position_matrix = transform_matrix * dequantization;
+
+		// The occluders always use the full detail level, a simplified one could cover pixels the real mesh doesn't.
+
+		for (const Meshlet& meshlet : lod_meshlets[0])
 		{
-			if (is_frontface(transformed_vertices.data(), indices))
+			// The cones are tested against a point of view, which an orthographic projection doesn't have.
+
+			if (!is_sphere_in_frustum(frustum_planes, meshlet.center, meshlet.radius) || (!orthographic && meshlet.is_backfacing(eye))) continue;
+
+			for (size_t local = 0, count = meshlet.get_vertex_count(); local < count; local++)
 			{
-				// Se the color of the polygon based on previous calculations
+				int index = meshlet.get_vertex(local);
+
+				if (vertex_marks[index]) continue;
+
+				vertex_marks[index] = TRANSFORMED;
 
-				rasterizer.set_color(transformed_colors[*indices]);
+				Vertex& vertex = transformed_vertices[index] = transform_vertex(position_matrix, index, vectorized);
 
-				Point4i clipped_vertices[10];
+				float divisor = 1.f / vertex.w;
 
-				unsigned clipped_vertices_count = clip_triangle(display_vertices.data(), indices, indices + 3, clipped_vertices, &width, &height);
+				vertex.x *= divisor;
+				vertex.y *= divisor;
+				vertex.z *= divisor;
+				vertex.w = 1.f;
 
-				if (clipped_vertices_count >= 3)
+				display_vertices[index] = Point4i(depth_transformation * vertex);
+			}
+
+			for (size_t triangle = 0, end = meshlet.triangles.size(); triangle < end; triangle += 3)
+			{
+				int indices[3] =
 				{
-					// Fill the polygon.
+					meshlet.get_vertex(meshlet.triangles[triangle + 0]),
+					meshlet.get_vertex(meshlet.triangles[triangle + 1]),
+					meshlet.get_vertex(meshlet.triangles[triangle + 2])
+				};
+
+				// Triangles crossing the near or far planes are left out instead of risking a wrong depth.
+
+				bool inside_depth_range = true;
+
+				for (int index : indices)
+				{
+					float z = transformed_vertices[index].z;
+
+					if (z < -1.f || z > 1.f) inside_depth_range = false;
+				}
+
+				if (inside_depth_range && is_frontface(transformed_vertices, indices))
+				{
+					Point4i clipped_vertices[10];
+
+					if (clip_triangle(display_vertices, indices, indices + 3, clipped_vertices, &width, &height) >= 3)
+					{
+						rasterizer.fill_convex_polygon_z_buffer(display_vertices, indices, indices + 3);
+					}
+				}
+			}
+		}
+	}
+
+	void Mesh::compact()
+	{
+		if (is_compact() || original_vertices.empty()) return;
+
+		size_t vertex_count = original_vertices.size();
+
+		// The positions are quantized across the bounding box, flat axes get any step since all their vertices quantize to 0.
+
+		Point3f min_corner(original_vertices[0]);
+		Point3f max_corner(min_corner);
+
+		for (const Vertex& vertex : original_vertices)
+		{
+			min_corner = glm::min(min_corner, Point3f(vertex));
+			max_corner = glm::max(max_corner, Point3f(vertex));
+		}
 
-					rasterizer.fill_convex_polygon_z_buffer(display_vertices.data(), indices, indices + 3);
+		Vector3f extent = max_corner - min_corner;
+		Vector3f step
+		(
+			extent.x > 0.f ? extent.x / 65535.f : 1.f,
+			extent.y > 0.f ? extent.y / 65535.f : 1.f,
+			extent.z > 0.f ? extent.z / 65535.f : 1.f
+		);
+
+		quantized_vertices.resize(vertex_count);
+		encoded_normals.resize(vertex_count);
+
+		for (size_t index = 0; index < vertex_count; index++)
+		{
+			Vector3f offset = Point3f(original_vertices[index]) - min_corner;
+
+			Quantized_Position& position = quantized_vertices[index];
+
+			position.x = uint16_t(std::min(std::max(offset.x / step.x + 0.5f, 0.f), 65535.f));
+			position.y = uint16_t(std::min(std::max(offset.y / step.y + 0.5f, 0.f), 65535.f));
+			position.z = uint16_t(std::min(std::max(offset.z / step.z + 0.5f, 0.f), 65535.f));
+			position.w = 1;
+
+			// The normal is projected onto the octahedron |x| + |y| + |z| = 1, and the lower half folded over the upper one.
+
+			const Point4f& normal = original_normals[index];
+
+			float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+			float octahedral_x = sum > 0.f ? normal.x / sum : 0.f;
+			float octahedral_y = sum > 0.f ? normal.y / sum : 0.f;
+
+			if (normal.z < 0.f)
+			{
+				float folded_x = (1.f - std::abs(octahedral_y)) * (octahedral_x >= 0.f ? 1.f : -1.f);
+				float folded_y = (1.f - std::abs(octahedral_x)) * (octahedral_y >= 0.f ? 1.f : -1.f);
+
+				octahedral_x = folded_x;
+				octahedral_y = folded_y;
+			}
+
+			encoded_normals[index].x = int16_t(std::round(std::min(std::max(octahedral_x, -1.f), 1.f) * 32767.f));
+			encoded_normals[index].y = int16_t(std::round(std::min(std::max(octahedral_y, -1.f), 1.f) * 32767.f));
+		}
+
+		Matrix44 identity(1);
+
+		dequantization = translate(identity, Vector3f(min_corner)) * scale(identity, step);
+
+		// The meshlets are all the rendering needs of the indices, the buffers of the levels only served to build them.
+
+		if (vertex_count <= 0x10000)
+		{
+			for (vector<Meshlet>& meshlets : lod_meshlets)
+			{
+				for (Meshlet& meshlet : meshlets)
+				{
+					meshlet.compact();
 				}
 			}
 		}
+
+		Vertex_Buffer().swap(original_vertices);
+		vector<Point4f>().swap(original_normals);
+		vector<Index_Buffer>().swap(lod_indices);
 	}
 
-	bool Mesh::is_frontface(const Vertex* const projected_vertices, const int* const indices)
+	Mesh::Vertex Mesh::transform_vertex(const Matrix44& matrix, int index, bool vectorized) const
+	{
+	#if MSCENARY_SSE2
+
+		if (vectorized)
+		{
+			__m128 point;
+
+			if (is_compact())
+			{
+				// The four 16 bit components are widened and converted to floats, w included, so the point comes out ready to transform.
+
+				__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&quantized_vertices[index]));
+
+				point = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+			}
+			else
+			{
+				point = _mm_loadu_ps(&original_vertices[index].x);
+			}
+
+			__m128 result = _mm_add_ps
+			(
+				_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&matrix[0][0]), _mm_shuffle_ps(point, point, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(_mm_loadu_ps(&matrix[1][0]), _mm_shuffle_ps(point, point, _MM_SHUFFLE(1, 1, 1, 1)))),
+				_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&matrix[2][0]), _mm_shuffle_ps(point, point, _MM_SHUFFLE(2, 2, 2, 2))), _mm_mul_ps(_mm_loadu_ps(&matrix[3][0]), _mm_shuffle_ps(point, point, _MM_SHUFFLE(3, 3, 3, 3))))
+			);
+
+			Vertex vertex;
+
+			_mm_storeu_ps(&vertex.x, result);
+
+			return vertex;
+		}
+
+	#endif
+
+		if (is_compact())
+		{
+			const Quantized_Position& position = quantized_vertices[index];
+
+			return matrix * Vertex(float(position.x), float(position.y), float(position.z), float(position.w));
+		}
+
+		return matrix * original_vertices[index];
+	}
+
+	Matrix44 Mesh::get_display_transformation(unsigned width, unsigned height)
+	{
+		Matrix44 identity(1);
+		Matrix44 scaling = scale(identity, float(width / 2), float(height / 2), 100000000.f);
+		Matrix44 translation = translate(identity, Vector3f{ float(width / 2), float(height / 2), 0.f });
+
+		return translation * scaling;
+	}
+
+	bool Mesh::is_frontface(const Vertex* const projected_vertices, const int* const indices) const
 	{
 		const Vertex& v0 = projected_vertices[indices[0]];
 		const Vertex& v1 = projected_vertices[indices[1]];
@@ -145,7 +819,7 @@ namespace MScenary
 		return ((v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]) < 0.f);
 	}
 
-	unsigned Mesh::clip_triangle(Point4i* vertices, const int* init, const int* end, Point4i* clipped_vertices, const unsigned* width, const unsigned* height)
+	unsigned Mesh::clip_triangle(Point4i* vertices, const int* init, const int* end, Point4i* clipped_vertices, const unsigned* width, const unsigned* height) const
 	{
 		unsigned int clipped_vertices_count = 0;
 
@@ -166,4 +840,40 @@ namespace MScenary
 		// Return the number of vertices inside the screen
 		return clipped_vertices_count;
 	}
+
+	size_t Mesh::get_source_bytes() const
+	{
+		size_t bytes = sizeof(Mesh) + get_allocated_bytes(original_normals) + get_allocated_bytes(original_vertices) + get_allocated_bytes(original_colors)
+			+ get_allocated_bytes(lod_indices) + get_allocated_bytes(lod_index_counts) + get_allocated_bytes(lod_meshlets)
+			+ get_allocated_bytes(quantized_vertices) + get_allocated_bytes(encoded_normals);
+
+		for (const Index_Buffer& indices : lod_indices)
+		{
+			bytes += get_allocated_bytes(indices);
+		}
+
+		for (const vector<Meshlet>& meshlets : lod_meshlets)
+		{
+			bytes += get_allocated_bytes(meshlets);
+
+			for (const Meshlet& meshlet : meshlets)
+			{
+				bytes += meshlet.get_allocated_bytes();
+			}
+		}
+
+		return bytes;
+	}
+
+	size_t Mesh::get_scratch_bytes(size_t shadow_map_count) const
+	{
+		// The same buffers prepare_triangles() and the lighting take, with every vertex and triangle of the first level visible.
+
+		size_t padded_count = (vertex_count + 3) & ~size_t(3);
+		size_t index_count = lod_index_counts.empty() ? 0 : lod_index_counts[0];
+
+		return vertex_count * (2 * sizeof(Vertex) + sizeof(Point4i) + sizeof(Color) + sizeof(uint8_t) + sizeof(int))
+			+ index_count * sizeof(int)
+			+ padded_count * ((10 + shadow_map_count) * sizeof(float) + sizeof(uint32_t));
+	}
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Mesh_Simplifier.hpp"
+
+#include <unordered_map>
+
+namespace MScenary
+{
+	Mesh_Simplifier::Quadric::Quadric()
+	{
+		for (double& value : a) value = 0.0;
+	}
+
+	void Mesh_Simplifier::Quadric::add_plane(double nx, double ny, double nz, double d, double weight)
+	{
+		a[0] += weight * nx * nx; a[1] += weight * nx * ny; a[2] += weight * nx * nz; a[3] += weight * nx * d;
+		                          a[4] += weight * ny * ny; a[5] += weight * ny * nz; a[6] += weight * ny * d;
+		                                                    a[7] += weight * nz * nz; a[8] += weight * nz * d;
+		                                                                              a[9] += weight * d  * d;
+	}
+
+	void Mesh_Simplifier::Quadric::add(const Quadric& other)
+	{
+		for (size_t index = 0; index < 10; index++) a[index] += other.a[index];
+	}
+
+	double Mesh_Simplifier::Quadric::evaluate(const Point3f& point) const
+	{
+		double x = point.x, y = point.y, z = point.z;
+
+		// v^T * Q * v with v = (x, y, z, 1)
+
+		return  a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+			  + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+			  + a[7] * z * z + 2 * a[8] * z
+			  + a[9];
+	}
+
+	Mesh_Simplifier::Mesh_Simplifier(const vector<Point4f>& vertices, const vector<int>& indices)
+		:
+		triangles(indices),
+		triangle_alive(indices.size() / 3, true),
+		alive_triangles(indices.size() / 3)
+	{
+		size_t number_of_vertices = vertices.size();
+
+		positions.resize(number_of_vertices);
+		quadrics.resize(number_of_vertices);
+		vertex_triangles.resize(number_of_vertices);
+		versions.assign(number_of_vertices, 0);
+		vertex_alive.assign(number_of_vertices, true);
+
+		for (size_t index = 0; index < number_of_vertices; index++)
+		{
+			positions[index] = Point3f(vertices[index]);
+		}
+
+		// Every triangle adds its plane to its three vertices.
+		// Edges that only belong to one triangle are counted too, they are the borders of the mesh.
+
+		std::unordered_map<uint64_t, int> edge_uses;
+
+		for (size_t triangle = 0; triangle < alive_triangles; triangle++)
+		{
+			const int* corners = &triangles[triangle * 3];
+
+			const Point3f& p0 = positions[corners[0]];
+			const Point3f& p1 = positions[corners[1]];
+			const Point3f& p2 = positions[corners[2]];
+
+			Vector3f normal = glm::cross(p1 - p0, p2 - p0);
+			float    length = glm::length(normal);
+
+			if (length > 0.f)
+			{
+				normal = normal / length;
+
+				for (size_t corner = 0; corner < 3; corner++)
+				{
+					quadrics[corners[corner]].add_plane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), 1.0);
+				}
+			}
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				vertex_triangles[corners[corner]].push_back(int(triangle));
+
+				uint32_t v0 = uint32_t(corners[corner]);
+				uint32_t v1 = uint32_t(corners[(corner + 1) % 3]);
+
+				edge_uses[v0 < v1 ? (uint64_t(v0) << 32 | v1) : (uint64_t(v1) << 32 | v0)]++;
+			}
+		}
+
+		// Border edges get a heavily weighted plane perpendicular to their triangle so the outline of the mesh
+		// (and the seams between vertices with split normals) stays where it is.
+
+		for (size_t triangle = 0; triangle < alive_triangles; triangle++)
+		{
+			const int* corners = &triangles[triangle * 3];
+
+			const Point3f& p0 = positions[corners[0]];
+			Vector3f face_normal = glm::cross(positions[corners[1]] - p0, positions[corners[2]] - p0);
+
+			if (glm::dot(face_normal, face_normal) == 0.f) continue;
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t v0 = uint32_t(corners[corner]);
+				uint32_t v1 = uint32_t(corners[(corner + 1) % 3]);
+
+				if (edge_uses[v0 < v1 ? (uint64_t(v0) << 32 | v1) : (uint64_t(v1) << 32 | v0)] != 1) continue;
+
+				Vector3f normal = glm::cross(positions[v1] - positions[v0], face_normal);
+				float    length = glm::length(normal);
+
+				if (length == 0.f) continue;
+
+				normal = normal / length;
+
+				double d = -glm::dot(normal, positions[v0]);
+
+				quadrics[v0].add_plane(normal.x, normal.y, normal.z, d, 10.0);
+				quadrics[v1].add_plane(normal.x, normal.y, normal.z, d, 10.0);
+			}
+		}
+
+		for (size_t vertex = 0; vertex < number_of_vertices; vertex++)
+		{
+			queue_collapses(int(vertex));
+		}
+	}
+
+	size_t Mesh_Simplifier::simplify(size_t target_triangle_count, float max_error)
+	{
+		while (alive_triangles > target_triangle_count && !candidates.empty())
+		{
+			Collapse collapse = candidates.top();
+
+			if (collapse.cost > max_error) break;
+
+			candidates.pop();
+
+			int from = collapse.from;
+			int to = collapse.to;
+
+			// Skip the candidates queued before any of both vertices changed, there is a newer one in the queue.
+
+			if (!vertex_alive[from] || !vertex_alive[to]) continue;
+			if (versions[from] != collapse.from_version || versions[to] != collapse.to_version) continue;
+
+			if (!is_collapse_valid(from, to)) continue;
+
+			// The triangles that share the edge disappear and the rest of the triangles around "from" move onto "to".
+
+			for (int triangle : vertex_triangles[from])
+			{
+				if (!triangle_alive[triangle]) continue;
+
+				int* corners = &triangles[size_t(triangle) * 3];
+
+				if (corners[0] == to || corners[1] == to || corners[2] == to)
+				{
+					triangle_alive[triangle] = false;
+					alive_triangles--;
+				}
+				else
+				{
+					for (size_t corner = 0; corner < 3; corner++)
+					{
+						if (corners[corner] == from) corners[corner] = to;
+					}
+
+					vertex_triangles[to].push_back(triangle);
+				}
+			}
+
+			vertex_alive[from] = false;
+			vertex_triangles[from].clear();
+
+			quadrics[to].add(quadrics[from]);
+			versions[to]++;
+
+			queue_collapses(to);
+		}
+
+		return alive_triangles;
+	}
+
+	void Mesh_Simplifier::get_indices(vector<int>& indices) const
+	{
+		indices.clear();
+		indices.reserve(alive_triangles * 3);
+
+		for (size_t triangle = 0, number_of_triangles = triangle_alive.size(); triangle < number_of_triangles; triangle++)
+		{
+			if (triangle_alive[triangle])
+			{
+				indices.push_back(triangles[triangle * 3 + 0]);
+				indices.push_back(triangles[triangle * 3 + 1]);
+				indices.push_back(triangles[triangle * 3 + 2]);
+			}
+		}
+	}
+
+	void Mesh_Simplifier::queue_collapses(int vertex)
+	{
+		for (int triangle : vertex_triangles[vertex])
+		{
+			if (!triangle_alive[triangle]) continue;
+
+			const int* corners = &triangles[size_t(triangle) * 3];
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				int neighbour = corners[corner];
+
+				if (neighbour == vertex) continue;
+
+				Quadric quadric = quadrics[vertex];
+				quadric.add(quadrics[neighbour]);
+
+				candidates.push({ quadric.evaluate(positions[neighbour]), vertex, neighbour, versions[vertex], versions[neighbour] });
+				candidates.push({ quadric.evaluate(positions[vertex]), neighbour, vertex, versions[neighbour], versions[vertex] });
+			}
+		}
+	}
+
+	bool Mesh_Simplifier::is_collapse_valid(int from, int to) const
+	{
+		for (int triangle : vertex_triangles[from])
+		{
+			if (!triangle_alive[triangle]) continue;
+
+			const int* corners = &triangles[size_t(triangle) * 3];
+
+			if (corners[0] == to || corners[1] == to || corners[2] == to) continue;
+
+			Point3f before[3];
+			Point3f after[3];
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				before[corner] = positions[corners[corner]];
+				after[corner] = corners[corner] == from ? positions[to] : before[corner];
+			}
+
+			Vector3f normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+			Vector3f normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+			if (glm::dot(normal_before, normal_after) <= 0.f) return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,205 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MScenary
+{
+	void Meshlet::build(const vector<Point4f>& positions, const vector<int>& indices, vector<Meshlet>& meshlets)
+	{
+		size_t number_of_triangles = indices.size() / 3;
+
+		meshlets.clear();
+
+		// Triangles around every vertex, to grow the meshlets through neighbouring triangles.
+
+		vector<vector<int>> vertex_triangles(positions.size());
+
+		for (size_t triangle = 0; triangle < number_of_triangles; triangle++)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				vertex_triangles[indices[triangle * 3 + corner]].push_back(int(triangle));
+			}
+		}
+
+		// Facing direction of every triangle. The vertices are stored with the Y axis flipped, which turns the winding around,
+		// so the side a triangle is seen from is the opposite of cross(v1 - v0, v2 - v0) (see Mesh::is_frontface).
+
+		vector<Vector3f> triangle_normals(number_of_triangles);
+
+		for (size_t triangle = 0; triangle < number_of_triangles; triangle++)
+		{
+			const Point3f p0(positions[indices[triangle * 3 + 0]]);
+			const Point3f p1(positions[indices[triangle * 3 + 1]]);
+			const Point3f p2(positions[indices[triangle * 3 + 2]]);
+
+			Vector3f normal = glm::cross(p2 - p0, p1 - p0);
+			float    length = glm::length(normal);
+
+			triangle_normals[triangle] = length > 0.f ? normal / length : Vector3f(0.f, 0.f, 0.f);
+		}
+
+		vector<bool> assigned(number_of_triangles, false);
+		vector<int>  local_index(positions.size(), -1);
+		vector<int>  candidates;
+
+		for (size_t seed = 0; seed < number_of_triangles; seed++)
+		{
+			if (assigned[seed]) continue;
+
+			Meshlet  meshlet;
+			Vector3f normal_sum(0.f, 0.f, 0.f);
+
+			candidates.assign(1, int(seed));
+
+			// Greedy growth: among the triangles that touch the meshlet, take the one that adds the fewest new vertices and
+			// faces the most like the triangles already in it, so the normal cones stay narrow enough to cull.
+
+			while (!candidates.empty() && meshlet.triangles.size() < max_triangles * 3)
+			{
+				int   best = -1;
+				float best_score = -std::numeric_limits<float>::max();
+
+				Vector3f axis = glm::dot(normal_sum, normal_sum) > 0.f ? glm::normalize(normal_sum) : Vector3f(0.f, 0.f, 0.f);
+
+				for (size_t candidate = 0; candidate < candidates.size(); )
+				{
+					int triangle = candidates[candidate];
+
+					size_t new_vertices = 0;
+
+					for (size_t corner = 0; corner < 3; corner++)
+					{
+						if (local_index[indices[size_t(triangle) * 3 + corner]] < 0) new_vertices++;
+					}
+
+					// Triangles already taken or that don't fit anymore are dropped from the candidates.
+
+					if (assigned[triangle] || meshlet.vertices.size() + new_vertices > max_vertices)
+					{
+						candidates[candidate] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					float score = glm::dot(triangle_normals[triangle], axis) - 0.5f * float(new_vertices);
+
+					if (score > best_score)
+					{
+						best_score = score;
+						best = triangle;
+					}
+
+					candidate++;
+				}
+
+				if (best < 0) break;
+
+				// Once the meshlet is big enough, stop before a triangle that would open the normal cone too much.
+
+				if (meshlet.triangles.size() >= min_triangles * 3 && glm::dot(triangle_normals[best], axis) < min_normal_alignment) break;
+
+				assigned[best] = true;
+				normal_sum += triangle_normals[best];
+
+				for (size_t corner = 0; corner < 3; corner++)
+				{
+					int vertex = indices[size_t(best) * 3 + corner];
+
+					if (local_index[vertex] < 0)
+					{
+						local_index[vertex] = int(meshlet.vertices.size());
+						meshlet.vertices.push_back(vertex);
+
+						for (int neighbour : vertex_triangles[vertex])
+						{
+							if (!assigned[neighbour]) candidates.push_back(neighbour);
+						}
+					}
+
+					meshlet.triangles.push_back(uint8_t(local_index[vertex]));
+				}
+			}
+
+			for (int vertex : meshlet.vertices) local_index[vertex] = -1;
+
+			// Bounding sphere centered in the bounding box of the vertices.
+
+			Point3f min_corner(positions[meshlet.vertices[0]]);
+			Point3f max_corner(min_corner);
+
+			for (int vertex : meshlet.vertices)
+			{
+				min_corner = glm::min(min_corner, Point3f(positions[vertex]));
+				max_corner = glm::max(max_corner, Point3f(positions[vertex]));
+			}
+
+			meshlet.center = (min_corner + max_corner) * 0.5f;
+			meshlet.radius = 0.f;
+
+			for (int vertex : meshlet.vertices)
+			{
+				meshlet.radius = std::max(meshlet.radius, glm::length(Point3f(positions[vertex]) - meshlet.center));
+			}
+
+			// Normal cone around the average facing direction.
+
+			Vector3f axis = normal_sum;
+
+			float axis_length = glm::length(axis);
+			float min_dot = -1.f;
+
+			if (axis_length > 0.f)
+			{
+				axis = axis / axis_length;
+				min_dot = 1.f;
+
+				for (size_t index = 0; index < meshlet.triangles.size(); index += 3)
+				{
+					// Triangles of the meshlet are found again through their first corner, any triangle in the mesh with the
+					// same three vertices faces the same way.
+
+					const Point3f p0(positions[meshlet.vertices[meshlet.triangles[index + 0]]]);
+					const Point3f p1(positions[meshlet.vertices[meshlet.triangles[index + 1]]]);
+					const Point3f p2(positions[meshlet.vertices[meshlet.triangles[index + 2]]]);
+
+					Vector3f normal = glm::cross(p2 - p0, p1 - p0);
+					float    length = glm::length(normal);
+
+					if (length > 0.f) min_dot = std::min(min_dot, glm::dot(normal / length, axis));
+				}
+			}
+
+			// If the normals spread over a half space or more there is no point the whole meshlet is hidden from.
+
+			meshlet.cone_axis = axis;
+			meshlet.cone_cutoff = min_dot <= 0.f ? 1.f : std::sqrt(1.f - min_dot * min_dot);
+
+			meshlets.push_back(std::move(meshlet));
+		}
+	}
+
+	bool Meshlet::compact()
+	{
+		if (vertices.empty()) return false;
+
+		for (int index : vertices)
+		{
+			if (index < 0 || index > 0xFFFF) return false;
+		}
+
+		short_vertices.assign(vertices.begin(), vertices.end());
+
+		vector<int>().swap(vertices);
+
+		return true;
+	}
+}
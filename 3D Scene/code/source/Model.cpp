@@ -6,11 +6,14 @@
 
 #include "../header/Model.hpp"
 #include "../header/Scene.hpp"
+#include "../header/Scene_View.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <limits>
+
 namespace MScenary
 {
 	Model::Model(Scene* given_scene, const char* mesh_file_path) : Node(given_scene)
@@ -47,15 +50,88 @@ namespace MScenary
 		}
 	}
 
-	void Model::render(const Matrix44& projection_matrix, const Matrix44& view_matrix, Light& light_source)
+	void Model::submit(Scene_View& view) const
 	{
-		Matrix44 transform_matrix = get_transform()->get_transform_matrix();
+		const Matrix44& projection_matrix = view.get_projection_matrix();
+		const Matrix44& view_matrix = view.get_view_matrix();
+		const Matrix44& transform_matrix = get_world_matrix();
+
+		Matrix44 model_view_matrix = view_matrix * transform_matrix;
+
+		float pixels_per_unit = view.get_pixels_per_unit();
+		float model_scale = extract_max_scale(model_view_matrix);
 
-		for each (auto mesh in meshes)
+		const Occlusion_Buffer& occlusion_buffer = view.get_occlusion_buffer();
+		Render_Queue&           render_queue = view.get_render_queue();
+
+		for (const auto& mesh : meshes)
 		{
+			// The meshes hidden behind the occluders are skipped before any of their vertices is processed.
+
+			if (!occluder && view.is_occlusion_culling_enabled() && occlusion_buffer.is_occluded(mesh->get_bounding_center(), mesh->get_bounding_radius(), projection_matrix * transform_matrix))
+			{
+				if (Raster_Stats* stats = view.get_frame_stats()) stats->meshes_occluded++;
+				continue;
+			}
+
+			// Pick the level of detail from the projected size of the bounding sphere (the camera looks towards -z).
+
+			Point4f center = model_view_matrix * Point4f(mesh->get_bounding_center(), 1.f);
+			float radius = mesh->get_bounding_radius() * model_scale;
+			float distance = -center.z;
+
+			size_t lod = view.select_lod(*mesh, distance > radius ? radius * pixels_per_unit / distance : std::numeric_limits<float>::max());
+
 			//Coord.Escena -> Coord.Camara -> Coord.Project
 
-			mesh->render(scene->get_rasterizer(), projection_matrix * transform_matrix, view_matrix * transform_matrix, light_source);
+			if (opacity < 1.f)
+			{
+				render_queue.submit({ mesh.get(), projection_matrix * transform_matrix, model_view_matrix, lod, opacity }, distance - radius, Render_Queue::TRANSLUCENT);
+			}
+			else
+			{
+				render_queue.submit({ mesh.get(), projection_matrix * transform_matrix, model_view_matrix, lod }, distance - radius);
+			}
+		}
+	}
+
+	void Model::render_occluder(Scene_View& view) const
+	{
+		if (!occluder) return;
+
+		const Matrix44& transform_matrix = get_world_matrix();
+
+		for (const auto& mesh : meshes)
+		{
+			mesh->render_depth(view.get_occlusion_buffer().get_rasterizer(), view.get_projection_matrix() * transform_matrix, view.get_view_matrix() * transform_matrix);
+		}
+	}
+
+	void Model::collect_shadow_casters(vector<Shadow_Caster>& casters)
+	{
+		if (!shadow_caster) return;
+
+		for (auto& mesh : meshes)
+		{
+			casters.push_back({ mesh.get(), get_world_matrix() });
 		}
 	}
-}
\ No newline at end of file
+
+	void Model::report_memory(Memory_Report& report, const std::string& name) const
+	{
+		report.begin_group(name);
+
+		Node::report_memory(report, "node");
+
+		size_t shadow_map_count = scene ? scene->get_shadow_map_count() : 0;
+
+		for (size_t index = 0; index < meshes.size(); index++)
+		{
+			const Mesh& mesh = *meshes[index];
+
+			report.add("mesh " + std::to_string(index) + " (" + std::to_string(mesh.get_vertex_count()) + " vertices)", mesh.get_source_bytes(), 0, mesh.get_scratch_bytes(shadow_map_count));
+		}
+
+		report.end_group();
+	}
+}
@@ -0,0 +1,490 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Multisample_Buffer.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace MScenary
+{
+	namespace
+	{
+		// Rotated grid of four samples, with every sample on its own row and column of the pixel.
+
+		const float sample_x[Multisample_Buffer::sample_count] = { 0.375f, 0.875f, 0.125f, 0.625f };
+		const float sample_y[Multisample_Buffer::sample_count] = { 0.125f, 0.375f, 0.625f, 0.875f };
+
+		const float sample_min = 0.125f;	// Smallest offset of a sample inside the pixel.
+		const float sample_max = 0.875f;	// Largest offset of a sample inside the pixel.
+
+		const unsigned full_mask = (1u << Multisample_Buffer::sample_count) - 1;
+
+		// Margin kept from the limits of the runs found analytically, so the rounding of the floats can't mark a partial pixel as full.
+
+		const float margin = 1.f / 64.f;
+
+		/**
+		 * @brief Edge of a triangle as the function A * x + B * y + C, positive inside the triangle.
+		 */
+		struct Edge
+		{
+			float a, b, c;
+			bool  owned;	///< Whether the samples exactly on the edge belong to the triangle, so shared edges are drawn only once.
+
+			float evaluate(float x, float y) const
+			{
+				return a * x + b * y + c;
+			}
+
+			bool contains(float x, float y) const
+			{
+				float value = evaluate(x, y);
+
+				return value > 0.f || (value == 0.f && owned);
+			}
+		};
+	}
+
+	Multisample_Buffer::Multisample_Buffer(unsigned width, unsigned height)
+		:
+		width(width),
+		height(height),
+		colors(size_t(width) * height),
+		depths(size_t(width) * height, std::numeric_limits<float>::max()),
+		blocks(size_t(width) * height, -1),
+		stats(nullptr),
+		overdraw(nullptr)
+	{
+		pool.reserve(size_t(width) * height / 8);
+
+		reset_scissor();
+	}
+
+	void Multisample_Buffer::set_scissor(int left, int top, int right, int bottom)
+	{
+		scissor_left = std::max(left, 0);
+		scissor_top = std::max(top, 0);
+		scissor_right = std::min(right, int(width));
+		scissor_bottom = std::min(bottom, int(height));
+	}
+
+	void Multisample_Buffer::clear(const Rgb888& color)
+	{
+		if (!has_scissor())
+		{
+			std::fill(colors.begin(), colors.end(), color);
+			std::fill(depths.begin(), depths.end(), std::numeric_limits<float>::max());
+
+			for (const Sample_Block& block : pool)
+			{
+				blocks[block.pixel] = -1;
+			}
+
+			pool.clear();
+			return;
+		}
+
+		for (int y = scissor_top; y < scissor_bottom; y++)
+		{
+			size_t begin = size_t(y) * width + scissor_left;
+			size_t end = size_t(y) * width + scissor_right;
+
+			std::fill(colors.begin() + begin, colors.begin() + end, color);
+			std::fill(depths.begin() + begin, depths.begin() + end, std::numeric_limits<float>::max());
+		}
+
+		// The edge pixels outside the scissor keep their samples, so their blocks are packed at the front of the pool and renumbered.
+
+		size_t kept = 0;
+
+		for (size_t index = 0; index < pool.size(); index++)
+		{
+			uint32_t pixel = pool[index].pixel;
+
+			if (blocks[pixel] != int32_t(index)) continue;
+
+			if (inside_scissor(pixel))
+			{
+				blocks[pixel] = -1;
+				continue;
+			}
+
+			blocks[pixel] = int32_t(kept);
+			pool[kept++] = pool[index];
+		}
+
+		pool.resize(kept);
+	}
+
+	void Multisample_Buffer::fill_triangle(const Point4f& v0, const Point4f& v1, const Point4f& v2, const Rgb888& color)
+	{
+		if (stats)
+			fill< true >(v0, v1, v2, color);
+		else
+			fill< false >(v0, v1, v2, color);
+	}
+
+	template< bool COUNT >
+	void Multisample_Buffer::fill(const Point4f& v0, const Point4f& v1, const Point4f& v2, const Rgb888& color)
+	{
+		const Point4f* vertices[3] = { &v0, &v1, &v2 };
+
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+		if (area == 0.f) return;
+
+		// The edges are built for a positive area, so the other winding is reversed first.
+
+		if (area < 0.f)
+		{
+			std::swap(vertices[1], vertices[2]);
+			area = -area;
+		}
+
+		const Point4f& a = *vertices[0];
+		const Point4f& b = *vertices[1];
+		const Point4f& c = *vertices[2];
+
+		Edge edges[3];
+
+		for (unsigned index = 0; index < 3; index++)
+		{
+			const Point4f& start = *vertices[index];
+			const Point4f& end = *vertices[(index + 1) % 3];
+
+			Edge& edge = edges[index];
+
+			edge.a = start.y - end.y;
+			edge.b = end.x - start.x;
+			edge.c = -(edge.a * start.x + edge.b * start.y);
+			edge.owned = edge.a > 0.f || (edge.a == 0.f && edge.b < 0.f);
+		}
+
+		// Depth as a plane over the screen, so every sample gets its own.
+
+		float z_dx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+		float z_dy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+		float z_0 = a.z - z_dx * a.x - z_dy * a.y;
+
+		int x_min = std::max(int(std::floor(std::min(std::min(a.x, b.x), c.x))), scissor_left);
+		int x_max = std::min(int(std::ceil(std::max(std::max(a.x, b.x), c.x))), scissor_right);
+		int y_min = std::max(int(std::floor(std::min(std::min(a.y, b.y), c.y))), scissor_top);
+		int y_max = std::min(int(std::ceil(std::max(std::max(a.y, b.y), c.y))), scissor_bottom);
+
+		uint32_t packed_color = pack(color);
+
+		// The counts are kept in locals and added to the stats at the end.
+
+		unsigned spans = 0, tested = 0, passed_pixels = 0;
+
+		for (int y = y_min; y < y_max; y++)
+		{
+			// Every edge limits the run of pixels whose samples are all inside it and the run of those that may have some inside.
+			// Intersecting them gives the interior of the row, which is filled without looking at the samples, and the pixels at
+			// both ends of it, which are the only ones whose coverage has to be found sample by sample.
+
+			int   any_begin = x_min, any_end = x_max;
+			int   full_begin = x_min, full_end = x_max;
+			float row_y = float(y);
+
+			for (const Edge& edge : edges)
+			{
+				float row = edge.b * row_y + edge.c;
+				float lowest = row + edge.b * (edge.b > 0.f ? sample_min : sample_max);
+				float highest = row + edge.b * (edge.b > 0.f ? sample_max : sample_min);
+
+				if (edge.a > 0.f)
+				{
+					lowest += edge.a * sample_min;
+					highest += edge.a * sample_max;
+
+					any_begin = std::max(any_begin, int(std::floor(-highest / edge.a)));
+					full_begin = std::max(full_begin, int(std::floor(-lowest / edge.a + margin)) + 1);
+				}
+				else if (edge.a < 0.f)
+				{
+					lowest += edge.a * sample_max;
+					highest += edge.a * sample_min;
+
+					any_end = std::min(any_end, int(std::ceil(-highest / edge.a)) + 1);
+					full_end = std::min(full_end, int(std::ceil(-lowest / edge.a - margin)));
+				}
+				else
+				{
+					if (highest < 0.f) any_end = any_begin;
+					if (lowest <= margin) full_end = full_begin;
+				}
+			}
+
+			if (any_begin >= any_end) continue;
+
+			if (COUNT) spans++;
+
+			full_begin = std::min(std::max(full_begin, any_begin), any_end);
+			full_end = std::max(std::min(full_end, any_end), full_begin);
+
+			uint32_t row_offset = uint32_t(y) * width;
+			float    row_z = z_0 + z_dy * row_y;
+
+			for (int x = any_begin; x < any_end; x++)
+			{
+				uint32_t pixel = row_offset + uint32_t(x);
+				float    pixel_x = float(x);
+
+				if (x >= full_begin && x < full_end)
+				{
+					// Interior pixel: a compressed one is tested with the depth at its center, otherwise every sample is tested.
+
+					int32_t block_index = blocks[pixel];
+
+					if (COUNT) tested++;
+
+					if (block_index < 0)
+					{
+						float z = row_z + z_dx * (pixel_x + 0.5f) + z_dy * 0.5f;
+
+						if (z < depths[pixel])
+						{
+							depths[pixel] = z;
+							colors[pixel] = color;
+
+							if (COUNT)
+							{
+								passed_pixels++;
+
+								if (overdraw) overdraw[pixel]++;
+							}
+						}
+					}
+					else
+					{
+						Sample_Block& block = pool[block_index];
+						unsigned      written = 0;
+
+						for (unsigned sample = 0; sample < sample_count; sample++)
+						{
+							float z = row_z + z_dx * (pixel_x + sample_x[sample]) + z_dy * sample_y[sample];
+
+							if (z < block.depth[sample])
+							{
+								block.depth[sample] = z;
+								block.color[sample] = packed_color;
+								written |= 1u << sample;
+							}
+						}
+
+						if (COUNT && written != 0)
+						{
+							passed_pixels++;
+
+							if (overdraw) overdraw[pixel]++;
+						}
+
+						// Once the triangle wins every sample the pixel is a single color again and can go back to being compressed.
+
+						if (written == full_mask)
+						{
+							blocks[pixel] = -1;
+							depths[pixel] = row_z + z_dx * (pixel_x + 0.5f) + z_dy * 0.5f;
+							colors[pixel] = color;
+						}
+					}
+
+					continue;
+				}
+
+				// Edge pixel.
+
+				unsigned coverage = 0;
+
+				for (unsigned sample = 0; sample < sample_count; sample++)
+				{
+					float sx = pixel_x + sample_x[sample];
+					float sy = row_y + sample_y[sample];
+
+					if (edges[0].contains(sx, sy) && edges[1].contains(sx, sy) && edges[2].contains(sx, sy))
+					{
+						coverage |= 1u << sample;
+					}
+				}
+
+				if (COUNT && coverage != 0) tested++;
+
+				if (coverage != 0)
+				{
+					float sample_depths[sample_count];
+					unsigned passed = 0;
+
+					int32_t block_index = blocks[pixel];
+
+					for (unsigned sample = 0; sample < sample_count; sample++)
+					{
+						if (coverage & (1u << sample))
+						{
+							sample_depths[sample] = row_z + z_dx * (pixel_x + sample_x[sample]) + z_dy * sample_y[sample];
+
+							float current = block_index < 0 ? depths[pixel] : pool[block_index].depth[sample];
+
+							if (sample_depths[sample] < current) passed |= 1u << sample;
+						}
+					}
+
+					if (passed != 0)
+					{
+						Sample_Block& block = block_index < 0 ? expand(pixel) : pool[block_index];
+
+						if (COUNT)
+						{
+							passed_pixels++;
+
+							if (overdraw) overdraw[pixel]++;
+						}
+
+						for (unsigned sample = 0; sample < sample_count; sample++)
+						{
+							if (passed & (1u << sample))
+							{
+								block.depth[sample] = sample_depths[sample];
+								block.color[sample] = packed_color;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (COUNT)
+		{
+			stats->spans += spans;
+			stats->pixels_tested += tested;
+			stats->pixels_passed += passed_pixels;
+			stats->pixels_written += passed_pixels;
+		}
+	}
+
+	void Multisample_Buffer::resolve(argb::Color_Buffer<Rgb888>& color_buffer) const
+	{
+		// The compressed pixels already have their final color and are laid out like the color buffer, so they are copied in one go.
+
+		bool scissored = has_scissor();
+
+		if (!scissored)
+		{
+			std::memcpy(color_buffer.pixels(), colors.data(), colors.size() * sizeof(Rgb888));
+		}
+		else for (int y = scissor_top; y < scissor_bottom; y++)
+		{
+			size_t begin = size_t(y) * width + scissor_left;
+
+			std::memcpy(color_buffer.pixels() + begin, colors.data() + begin, size_t(scissor_right - scissor_left) * sizeof(Rgb888));
+		}
+
+		// Then the edge pixels are overwritten with the average of their samples.
+
+		Rgb888* pixels = color_buffer.pixels();
+
+	#if MSCENARY_SSE2
+		const bool vectorized = simd::enabled();
+	#endif
+
+		for (size_t index = 0; index < pool.size(); index++)
+		{
+			const Sample_Block& block = pool[index];
+
+			// Blocks left behind by pixels that went back to being compressed, and those of the pixels kept from the last frame.
+
+			if (blocks[block.pixel] != int32_t(index)) continue;
+			if (scissored && !inside_scissor(block.pixel)) continue;
+
+			uint32_t average;
+
+		#if MSCENARY_SSE2
+
+			if (vectorized)
+			{
+				// The four samples widen to 16 bits in two registers, whose sum is folded once more to add the four colors of every channel.
+
+				__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block.color));
+				__m128i zero = _mm_setzero_si128();
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(samples, zero), _mm_unpackhi_epi8(samples, zero));
+
+				sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+
+				average = uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum)));
+			}
+			else
+		#endif
+			{
+				uint32_t red = 2, green = 2, blue = 2;
+
+				for (uint32_t sample : block.color)
+				{
+					red += sample & 0xFF;
+					green += (sample >> 8) & 0xFF;
+					blue += (sample >> 16) & 0xFF;
+				}
+
+				average = (red >> 2) | ((green >> 2) << 8) | ((blue >> 2) << 16);
+			}
+
+			Rgb888& pixel = pixels[block.pixel];
+
+			pixel.red() = uint8_t(average);
+			pixel.green() = uint8_t(average >> 8);
+			pixel.blue() = uint8_t(average >> 16);
+		}
+	}
+
+	void Multisample_Buffer::resolve_depth(vector<int>& z_buffer) const
+	{
+		// The cleared depth doesn't fit in an int, so everything from the largest int on becomes the cleared value of the z-buffer.
+
+		const float farthest = float(std::numeric_limits<int>::max());
+
+		for (int y = scissor_top; y < scissor_bottom; y++)
+		{
+			for (size_t index = size_t(y) * width + scissor_left, end = size_t(y) * width + scissor_right; index < end; index++)
+			{
+				float depth = depths[index];
+
+				if (blocks[index] >= 0)
+				{
+					const Sample_Block& block = pool[blocks[index]];
+
+					depth = std::min(std::min(block.depth[0], block.depth[1]), std::min(block.depth[2], block.depth[3]));
+				}
+
+				z_buffer[index] = depth < farthest ? int(depth) : std::numeric_limits<int>::max();
+			}
+		}
+	}
+
+	Multisample_Buffer::Sample_Block& Multisample_Buffer::expand(uint32_t pixel)
+	{
+		blocks[pixel] = int32_t(pool.size());
+
+		pool.emplace_back();
+
+		Sample_Block& block = pool.back();
+		uint32_t      color = pack(colors[pixel]);
+
+		for (unsigned sample = 0; sample < sample_count; sample++)
+		{
+			block.depth[sample] = depths[pixel];
+			block.color[sample] = color;
+		}
+
+		block.pixel = pixel;
+
+		return block;
+	}
+}
@@ -0,0 +1,102 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Occlusion_Buffer.hpp"
+#include "../header/Mesh.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace MScenary
+{
+	Occlusion_Buffer::Occlusion_Buffer(unsigned width, unsigned height)
+		:
+		target(width, height),
+		rasterizer(target),
+		occluder_depth(width * height, std::numeric_limits<int>::max())
+	{
+	}
+
+	void Occlusion_Buffer::update()
+	{
+		// Every pixel takes the farthest depth of the 3x3 pixels around it. That shrinks the occluders by a pixel
+		// on every side, so the pixels at their edges that are only partially covered don't hide anything.
+
+		int width = int(target.get_width());
+		int height = int(target.get_height());
+
+		const int* depth = rasterizer.get_z_buffer().data();
+
+		for (int y = 0; y < height; y++)
+		{
+			int y_min = std::max(y - 1, 0);
+			int y_max = std::min(y + 1, height - 1);
+
+			for (int x = 0; x < width; x++)
+			{
+				int x_min = std::max(x - 1, 0);
+				int x_max = std::min(x + 1, width - 1);
+
+				int farthest = std::numeric_limits<int>::min();
+
+				for (int row = y_min; row <= y_max; row++)
+				{
+					for (int column = x_min; column <= x_max; column++)
+					{
+						farthest = std::max(farthest, depth[row * width + column]);
+					}
+				}
+
+				occluder_depth[y * width + x] = farthest;
+			}
+		}
+	}
+
+	bool Occlusion_Buffer::is_occluded(const Point3f& center, float radius, const Matrix44& transform_matrix) const
+	{
+		// Anything reaching the camera plane can't be bounded on screen, so it's never taken as hidden.
+
+		Projected_Bounds projected = project_sphere_bounds(center, radius, transform_matrix);
+
+		if (projected.crosses_camera_plane || projected.z_min < -1.f) return false;
+
+		// The display transformation only scales and moves every axis, so the corners of the box stay the corners on screen.
+
+		Matrix44 display_transformation = Mesh::get_display_transformation(target.get_width(), target.get_height());
+
+		Point4f display_min = display_transformation * Point4f(projected.x_min, projected.y_min, projected.z_min, 1.f);
+		Point4f display_max = display_transformation * Point4f(projected.x_max, projected.y_max, projected.z_min, 1.f);
+
+		float x_min = display_min.x, x_max = display_max.x;
+		float y_min = display_min.y, y_max = display_max.y;
+		float z_min = display_min.z;
+
+		int width = int(target.get_width());
+		int height = int(target.get_height());
+
+		// What is out of the screen is left to the frustum culling.
+
+		if (x_max < 0.f || y_max < 0.f || x_min >= float(width) || y_min >= float(height)) return false;
+
+		int left = std::max(int(x_min), 0);
+		int top = std::max(int(y_min), 0);
+		int right = std::min(int(x_max), width - 1);
+		int bottom = std::min(int(y_max), height - 1);
+		int nearest = int(z_min);
+
+		for (int y = top; y <= bottom; y++)
+		{
+			const int* depth = occluder_depth.data() + y * width;
+
+			for (int x = left; x <= right; x++)
+			{
+				if (nearest < depth[x]) return false;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,33 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Post_Process.hpp"
+
+#include <algorithm>
+
+namespace MScenary
+{
+	void Post_Process::for_each_band(unsigned rows, const std::function<void(unsigned, unsigned)>& function) const
+	{
+		unsigned band_count = (rows + band_height - 1) / band_height;
+
+		auto process_band = [&](unsigned band)
+		{
+			function(band * band_height, std::min((band + 1) * band_height, rows));
+		};
+
+		if (thread_pool)
+		{
+			thread_pool->for_each(band_count, process_band);
+			return;
+		}
+
+		for (unsigned band = 0; band < band_count; band++)
+		{
+			process_band(band);
+		}
+	}
+}
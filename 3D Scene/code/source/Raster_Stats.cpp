@@ -0,0 +1,100 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Raster_Stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace MScenary
+{
+	Raster_Stats& Raster_Stats::operator += (const Raster_Stats& other)
+	{
+		meshes_submitted += other.meshes_submitted;
+		meshes_occluded += other.meshes_occluded;
+		meshes_unchanged += other.meshes_unchanged;
+
+		triangles_submitted += other.triangles_submitted;
+		triangles_rasterized += other.triangles_rasterized;
+
+		for (unsigned reason = 0; reason < CULL_REASON_COUNT; reason++)
+		{
+			triangles_culled[reason] += other.triangles_culled[reason];
+		}
+
+		spans += other.spans;
+		pixels_tested += other.pixels_tested;
+		pixels_passed += other.pixels_passed;
+		pixels_written += other.pixels_written;
+
+		return *this;
+	}
+
+	const char* Raster_Stats::get_cull_reason_name(Cull_Reason reason)
+	{
+		static const char* const names[CULL_REASON_COUNT] = { "meshlet_frustum", "meshlet_backface", "backface", "clipped" };
+
+		return reason < CULL_REASON_COUNT ? names[reason] : "unknown";
+	}
+
+	void Overdraw_Map::resize(unsigned new_width, unsigned new_height)
+	{
+		if (new_width == width && new_height == height) return;
+
+		width = new_width;
+		height = new_height;
+
+		counts.assign(size_t(width) * height, 0);
+	}
+
+	void Overdraw_Map::clear()
+	{
+		std::fill(counts.begin(), counts.end(), uint16_t(0));
+	}
+
+	float Overdraw_Map::get_average() const
+	{
+		uint64_t shaded = 0;
+		uint64_t covered = 0;
+
+		for (uint16_t count : counts)
+		{
+			shaded += count;
+			covered += count > 0;
+		}
+
+		return covered > 0 ? float(double(shaded) / double(covered)) : 0.f;
+	}
+
+	void Overdraw_Map::resolve(argb::Color_Buffer< Rgb888 >& target) const
+	{
+		assert(target.get_width() == width && target.get_height() == height);
+
+		// One color for every count up to 7 and the last one for anything above, so the steps can be told apart at a glance.
+
+		static const Rgb888 ramp[] =
+		{
+			Rgb888(0.0f, 0.0f, 0.0f),
+			Rgb888(0.0f, 0.0f, 0.6f),
+			Rgb888(0.0f, 0.5f, 1.0f),
+			Rgb888(0.0f, 0.8f, 0.3f),
+			Rgb888(0.7f, 0.9f, 0.0f),
+			Rgb888(1.0f, 0.8f, 0.0f),
+			Rgb888(1.0f, 0.4f, 0.0f),
+			Rgb888(1.0f, 0.0f, 0.0f),
+			Rgb888(1.0f, 1.0f, 1.0f),
+		};
+
+		constexpr uint16_t last = uint16_t(sizeof(ramp) / sizeof(ramp[0]) - 1);
+
+		Rgb888* pixels = target.pixels();
+
+		for (size_t index = 0, size = counts.size(); index < size; index++)
+		{
+			pixels[index] = ramp[std::min(counts[index], last)];
+		}
+	}
+}
@@ -0,0 +1,83 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Render_Queue.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace MScenary
+{
+	void Render_Queue::submit(const Draw_Item& item, float view_depth, Layer layer, uint32_t state)
+	{
+		uint64_t key = (uint64_t(layer) << 60) | (uint64_t(state & 0x0FFFFFFF) << 32) | quantize_depth(view_depth);
+
+		entries.push_back({ key, uint32_t(items.size()) });
+		items.push_back(item);
+	}
+
+	void Render_Queue::sort()
+	{
+		size_t count = entries.size();
+
+		if (count < 2) return;
+
+		sort_buffer.resize(count);
+
+		Sort_Entry* source = entries.data();
+		Sort_Entry* target = sort_buffer.data();
+
+		// Least significant digit radix sort, a byte per pass. It's stable, so items with equal keys keep the order they were submitted in.
+
+		for (unsigned shift = 0; shift < 64; shift += 8)
+		{
+			size_t histogram[256] = {};
+
+			for (size_t index = 0; index < count; index++)
+			{
+				histogram[(source[index].key >> shift) & 0xFF]++;
+			}
+
+			// If every key has the same byte here the pass wouldn't move anything.
+
+			if (histogram[(source[0].key >> shift) & 0xFF] == count) continue;
+
+			size_t offset = 0;
+
+			for (size_t& bucket : histogram)
+			{
+				size_t bucket_count = bucket;
+				bucket = offset;
+				offset += bucket_count;
+			}
+
+			for (size_t index = 0; index < count; index++)
+			{
+				target[histogram[(source[index].key >> shift) & 0xFF]++] = source[index];
+			}
+
+			std::swap(source, target);
+		}
+
+		if (source != entries.data())
+		{
+			std::memcpy(entries.data(), source, count * sizeof(Sort_Entry));
+		}
+	}
+
+	uint32_t Render_Queue::quantize_depth(float view_depth)
+	{
+		// Anything behind the camera goes first, as if it was right on it.
+
+		if (!(view_depth > 0.f)) return 0;
+
+		uint32_t bits;
+
+		std::memcpy(&bits, &view_depth, sizeof(bits));
+
+		return bits;
+	}
+}
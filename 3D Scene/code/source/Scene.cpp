@@ -9,36 +9,151 @@
 #include "../header/Ship.hpp"
 #include "../header/Camera.hpp"
 #include "../header/Light.hpp"
+#include "../header/Frame_Arena.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 
 namespace MScenary
 {
-	Scene::Scene(unsigned width, unsigned height)
+	Scene::Scene(unsigned width, unsigned height, bool offline)
 		:
-		color_buffer(width, height),
-		rasterizer(color_buffer)
+		window_buffer(width, height),
+		main_view(width, height),
+		window_views(1, &main_view),
+		dynamic_resolution(width, height)
 	{
-		window = new sf::Window(sf::VideoMode(width, height), "PG - Practica 1 - Martin Perez", sf::Style::Titlebar | sf::Style::Close);
+		if (!offline)
+		{
+			window.reset(new sf::Window(sf::VideoMode(width, height), "PG - Practica 1 - Martin Perez", sf::Style::Titlebar | sf::Style::Close));
 
-		window->setVerticalSyncEnabled(true);
+			window->setVerticalSyncEnabled(true);
+		}
 
 		initialize_scene();
 	}
 
 	void Scene::run()
 	{
+		if (!window) return;
+
 		exit = false;
 
 		do
 		{
 			process_input();
 
+			// Only the work of the frame is measured, the wait for the vertical sync in display() would hide any load.
+
+			auto frame_start = std::chrono::steady_clock::now();
+
 			update();
 			render();
 
+			float frame_time = std::chrono::duration<float>(std::chrono::steady_clock::now() - frame_start).count();
+
+			if (dynamic_scaling && dynamic_resolution.record_frame(frame_time))
+			{
+				main_view.resize(dynamic_resolution.get_width(), dynamic_resolution.get_height());
+			}
+
+			// The reports only see the moment they're taken. The targets and the frame buffers are the only memory that grows once
+			// the scene is built, so their bytes are added up every frame to keep the peak and the report is only built when asked for.
+
+			peak_frame_bytes = std::max(peak_frame_bytes, get_frame_bytes());
+
 			window->display();
 		} while (not exit);
 	}
 
+	void Scene::set_dynamic_resolution(bool state, float frame_budget)
+	{
+		dynamic_scaling = state;
+		dynamic_resolution.set_frame_budget(frame_budget);
+
+		if (state)
+		{
+			main_view.resize(dynamic_resolution.get_width(), dynamic_resolution.get_height());
+		}
+		else
+		{
+			main_view.resize(window_buffer.get_width(), window_buffer.get_height());
+		}
+	}
+
+	std::unique_ptr<Post_Process> Scene::remove_post_process(const Post_Process* post_process)
+	{
+		auto found = std::find_if(post_processes.begin(), post_processes.end(), [&](const std::unique_ptr<Post_Process>& pass) { return pass.get() == post_process; });
+
+		if (found == post_processes.end()) return nullptr;
+
+		std::unique_ptr<Post_Process> pass = std::move(*found);
+
+		post_processes.erase(found);
+
+		return pass;
+	}
+
+	Memory_Report Scene::report_memory()
+	{
+		Memory_Report report;
+
+		report.begin_group("nodes");
+
+		for (auto& node : entities)
+		{
+			node.second->report_memory(report, node.first);
+		}
+
+		report.end_group();
+
+		report.begin_group("targets");
+
+		report.add("window buffer", 0, window_buffer.get_allocated_bytes());
+		report.add("dynamic resolution", 0, dynamic_resolution.get_allocated_bytes());
+
+		for (auto& post_process : post_processes)
+		{
+			report.add("post process", 0, post_process->get_allocated_bytes());
+		}
+
+		report.add("frame arena", 0, Frame_Arena::local().get_capacity());
+		report.add("frame lists", 0, get_allocated_bytes(lights) + get_allocated_bytes(shadow_casters));
+
+		report.end_group();
+
+		main_view.report_memory(report, "main view");
+
+		// The rest of the scene has the same size as when the peak of the frame buffers was reached.
+
+		size_t frame_bytes = get_frame_bytes();
+
+		peak_frame_bytes = std::max(peak_frame_bytes, frame_bytes);
+
+		report.set_peaks(report.get_total_bytes() - frame_bytes + peak_frame_bytes, Memory_Report::query_peak_resident_bytes());
+
+		return report;
+	}
+
+	size_t Scene::get_shadow_map_count() const
+	{
+		return size_t(std::count_if(lights.begin(), lights.end(), [](const Light* light) { return light->get_shadow_map() != nullptr; }));
+	}
+
+	size_t Scene::get_frame_bytes() const
+	{
+		size_t bytes = window_buffer.get_allocated_bytes() + dynamic_resolution.get_allocated_bytes();
+
+		for (auto& post_process : post_processes)
+		{
+			bytes += post_process->get_allocated_bytes();
+		}
+
+		return bytes + Frame_Arena::local().get_capacity() + get_allocated_bytes(lights) + get_allocated_bytes(shadow_casters) + main_view.get_allocated_bytes();
+	}
+
 	void Scene::process_input()
 	{
 		sf::Event event;
@@ -46,6 +161,12 @@ namespace MScenary
 		while (window->pollEvent(event))
 		{
 			if (event.type == sf::Event::Closed) exit = true;
+
+			if (event.type != sf::Event::KeyPressed) continue;
+
+			if (event.key.code == sf::Keyboard::M) dump_memory(std::cout);
+			if (event.key.code == sf::Keyboard::N) set_multisampling(!main_view.is_multisampling_enabled());
+			if (event.key.code == sf::Keyboard::I) set_incremental_rendering(!main_view.is_incremental_rendering_enabled());
 		}
 	}
 
@@ -67,23 +188,135 @@ namespace MScenary
 
 	void Scene::render()
 	{
-		rasterizer.clear();
-
 		Camera& camera = dynamic_cast<Camera&>(*entities["camera"]);
 
-        Matrix44 camera_view_matrix = camera.get_view_matrix();
-        Matrix44 projection_matrix = camera.get_projection_matrix(); 
+		main_view.set_camera(camera.get_view_matrix(), camera.get_perspective_matrix());
 
-		Light& light = dynamic_cast<Light&>(*entities["light"]);
+		// With a frame ring the frame ends up in a slot of it without any copy: rendered into it at the size of the window,
+		// or scaled up into it otherwise. The window shows the frame from there.
 
-        light.apply_view_transform(camera_view_matrix);
+		Rgb888* slot = frame_ring ? frame_ring->acquire_slot() : nullptr;
 
-		for each (auto node in entities)
+		bool full_resolution = main_view.get_width() == window_buffer.get_width() && main_view.get_height() == window_buffer.get_height();
+
+		main_view.set_target_memory(full_resolution ? slot : nullptr);
+		window_buffer.set_memory(full_resolution ? nullptr : slot);
+
+		render_views(window_views);
+
+		Color_Buffer& color_buffer = main_view.get_color_buffer();
+
+		// At a smaller resolution the frame is scaled up to the window.
+
+		if (full_resolution)
+		{
+			color_buffer.blit_to_window();
+		}
+		else
 		{
-			node.second->render(projection_matrix, camera_view_matrix, light);
+			dynamic_resolution.upscale(color_buffer, window_buffer);
+			window_buffer.blit_to_window();
 		}
 
-		color_buffer.blit_to_window();
+		if (slot) frame_ring->publish();
+	}
+
+	void Scene::render_views(const vector<Scene_View*>& views)
+	{
+		// Every render call gives its scratch data back to the arena when it returns, the reset only merges the blocks the
+		// last frame had to chain, so from then on a single block fits the largest mesh. The views have arenas of their own.
+
+		Frame_Arena::local().reset();
+
+		// What doesn't depend on the camera is done once for every view: the matrices of the nodes, the lights and the shadows.
+
+		lights.clear();
+		shadow_casters.clear();
+
+		for (auto& node : entities)
+		{
+			node.second->update_world_matrix();
+		}
+
+		for (auto& node : entities)
+		{
+			node.second->collect_shadow_casters(shadow_casters);
+
+			if (Light* light = dynamic_cast<Light*>(node.second.get()))
+			{
+				light->update_world_position();
+				lights.push_back(light);
+			}
+		}
+
+		// The shadow maps are only rendered again when their light or any caster has moved, and the whole of every view
+		// has to be drawn again then. So do the post-processes, which work on the finished image in place.
+
+		bool redraw = !post_processes.empty();
+
+		for (Light* light : lights)
+		{
+			if (light->get_shadow_map())
+			{
+				redraw |= light->get_shadow_map()->update(*light, shadow_casters);
+			}
+		}
+
+		// The references take the levels of detail the views would pick, which depend on the ones they picked last, so those
+		// are kept before the views draw the frame.
+
+		if (cross_check)
+		{
+			cross_check->begin_frame();
+
+			for (size_t index = 0; index < views.size(); index++)
+			{
+				cross_check->keep_lods(index, *views[index]);
+			}
+		}
+
+		// Then the views are drawn in parallel, every thread of the pool taking the next free view until none is left. The nodes
+		// and the meshes are only read, everything a view writes is its own.
+
+		thread_pool.for_each(unsigned(views.size()), [&](unsigned view)
+		{
+			views[view]->render(entities, lights, redraw);
+		});
+
+		// The post-processes keep scratch data of their own and already split every image between threads, so they go one view after another.
+
+		for (Scene_View* view : views)
+		{
+			for (auto& post_process : post_processes)
+			{
+				post_process->apply(view->get_color_buffer());
+			}
+		}
+
+		if (cross_check) cross_check_views(views);
+	}
+
+	void Scene::cross_check_views(const vector<Scene_View*>& views)
+	{
+		// The reference paths are the plain loops instead of the vectorized ones, on this thread alone, so nothing in them
+		// depends on the order the threads take the views in. The override only changes this thread and the jobs it gives the
+		// pool, like the post-processes. The shadow maps and the lights are the ones already updated.
+
+		simd::Override plain_loops(false);
+
+		for (size_t index = 0; index < views.size(); index++)
+		{
+			Scene_View& reference = cross_check->prepare_reference(index, *views[index]);
+
+			reference.render(entities, lights, true);
+
+			for (auto& post_process : post_processes)
+			{
+				post_process->apply(reference.get_color_buffer());
+			}
+
+			cross_check->compare(*views[index], reference);
+		}
 	}
 
 	void Scene::initialize_scene()
@@ -96,18 +329,25 @@ namespace MScenary
 
 		auto light = std::make_shared<Light>(this, 4.f, 0.3f);
 		light->get_transform()->set_position(0.f, 3.f, 0.f);
+		light->set_animated(true);
+		light->enable_shadows();
 
         add_node("light", light);
 
 		auto island = std::make_shared<Model>(this, "../../assets/main_island.obj");
         island->get_transform()->set_position(0.f, 2.f, -7.f);
         island->get_transform()->set_scale(0.2f);
+        island->set_occluder(true);
+        island->set_shadow_caster(true);
+        island->compact_geometry();
 
         add_node("island", island);
 
 		auto ship = std::make_shared<Ship>(this, "../../assets/ship.obj", 0.5f, 0.01f);
         ship->get_transform()->set_transform_parent(island->get_transform());
         ship->get_transform()->set_position(6.f, 0.f, 6.f);
+        ship->set_shadow_caster(true);
+        ship->compact_geometry();
 
         add_node("ship", ship);
 
@@ -115,13 +355,20 @@ namespace MScenary
         cloud1->get_transform()->set_transform_parent(island->get_transform());
         cloud1->get_transform()->set_position(20.f, -7.f, 0.f);
 
+        cloud1->set_opacity(0.6f);
+        cloud1->compact_geometry();
+
         add_node("cloud1", cloud1);
        
         auto cloud2 = std::make_shared<Model>(this, "../../assets/cloud.obj");
         cloud2->get_transform()->set_transform_parent(island->get_transform());
         cloud2->get_transform()->set_position(-27.f, -1.f, 0.f);
 
+        cloud2->set_opacity(0.6f);
+        cloud2->compact_geometry();
+
         add_node("cloud2", cloud2);
 
+        set_dynamic_resolution(true);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,284 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Scene_View.hpp"
+#include "../header/Node.hpp"
+#include "../header/Light.hpp"
+#include "../header/Mesh.hpp"
+
+namespace MScenary
+{
+	Scene_View::Scene_View(unsigned width, unsigned height)
+		:
+		view_matrix(1),
+		perspective_matrix(1),
+		projection_matrix(1),
+		drawn_view_matrix(1),
+		drawn_projection_matrix(1)
+	{
+		resize(width, height);
+	}
+
+	void Scene_View::resize(unsigned width, unsigned height)
+	{
+		if (targets && targets->color_buffer.get_width() == width && targets->color_buffer.get_height() == height) return;
+
+		// The rasterizer keeps a reference to its color buffer, so everything is created again together.
+
+		targets = std::make_unique<Frame_Targets>(width, height);
+
+		dirty_region.invalidate();
+	}
+
+	size_t Scene_View::select_lod(const Mesh& mesh, float screen_radius)
+	{
+		size_t& level = mesh_lods[&mesh];
+
+		level = mesh.select_lod(screen_radius, level);
+
+		return level;
+	}
+
+	void Scene_View::render(const std::map<std::string, std::shared_ptr<Node>>& nodes, const vector<Light*>& lights, bool redraw)
+	{
+		// The meshes take their scratch data from the arena of the view, so it keeps the size it grew into whatever thread draws it.
+
+		Frame_Arena::Binding binding(arena);
+
+		arena.reset();
+
+		unsigned width = get_width();
+		unsigned height = get_height();
+
+		// One frame every stats interval is counted. The others give the rasterizers no stats, so they run their loops without counting.
+
+		bool sampled = stats_interval > 0 && stats_countdown == 0;
+
+		if (stats_interval > 0) stats_countdown = sampled ? stats_interval - 1 : stats_countdown - 1;
+
+		frame_stats = sampled ? &stats : nullptr;
+
+		uint16_t* overdraw_counts = nullptr;
+
+		if (sampled)
+		{
+			stats.clear();
+
+			if (overdraw)
+			{
+				overdraw_map.resize(width, height);
+				overdraw_map.clear();
+
+				overdraw_counts = overdraw_map.get_counts();
+			}
+		}
+
+		if (multisampling && !targets->multisample_buffer)
+		{
+			targets->multisample_buffer = std::make_unique<Multisample_Buffer>(width, height);
+		}
+
+		targets->rasterizer.set_stats(frame_stats, overdraw_counts);
+
+		if (targets->multisample_buffer) targets->multisample_buffer->set_stats(frame_stats, overdraw_counts);
+
+		// Every light is taken to camera coords and assigned to the screen tiles it reaches, so the meshes only evaluate the lights near them.
+
+		light_state.clear();
+
+		for (const Light* light : lights)
+		{
+			Vector3f position = light->calculate_view_position(view_matrix);
+			Vector3f direction = light->calculate_view_direction(view_matrix);
+
+			light_state.insert(light_state.end(), { position.x, position.y, position.z, direction.x, direction.y, direction.z });
+			light_state.insert(light_state.end(), { light->get_intensity(), light->get_ambient_intensity(), light->get_range() });
+		}
+
+		light_grid.build(lights, view_matrix, projection_matrix, width, height);
+
+		// The occluders go first into the occlusion buffer, so the rest of the nodes can be tested against them.
+
+		occlusion_buffer.clear();
+
+		if (occlusion_culling)
+		{
+			for (auto& node : nodes)
+			{
+				node.second->render_occluder(*this);
+			}
+		}
+
+		occlusion_buffer.update();
+
+		// Every node adds what it has to draw to the queue, which is then sorted so the nearest meshes fill the z-buffer first
+		// and as many pixels as possible behind them are rejected before being shaded, whatever the order of the nodes.
+
+		render_queue.clear();
+
+		for (auto& node : nodes)
+		{
+			node.second->submit(*this);
+		}
+
+		render_queue.sort();
+
+		// The camera and the lights change the color of every pixel, so with any of them the whole frame is drawn again.
+		// Otherwise only the meshes that changed mark what to draw.
+
+		dirty_region.begin_frame(width, height);
+
+		if (!incremental_rendering || redraw || light_state != drawn_light_state || view_matrix != drawn_view_matrix || projection_matrix != drawn_projection_matrix)
+		{
+			dirty_region.invalidate();
+		}
+
+		drawn_view_matrix = view_matrix;
+		drawn_projection_matrix = projection_matrix;
+		drawn_light_state.swap(light_state);
+
+		for (size_t index = 0; index < render_queue.size(); index++)
+		{
+			dirty_region.add_item(render_queue[index]);
+		}
+
+		dirty_region.end_frame();
+
+		const Screen_Rect& region = dirty_region.get_bounds();
+
+		if (!region.is_empty())
+		{
+			draw_region(region);
+		}
+		else if (frame_stats)
+		{
+			frame_stats->meshes_unchanged += render_queue.size();
+		}
+	}
+
+	void Scene_View::draw_region(const Screen_Rect& region)
+	{
+		Color_Buffer&               color_buffer = targets->color_buffer;
+		Rasterizer< Color_Buffer >& rasterizer = targets->rasterizer;
+		Multisample_Buffer*         multisample_buffer = multisampling ? targets->multisample_buffer.get() : nullptr;
+
+		rasterizer.set_scissor(region.left, region.top, region.right, region.bottom);
+
+		// With anti-aliasing nothing is drawn into the color buffer until the resolve, so only the multisampled target is cleared,
+		// to the same background as the rasterizer.
+
+		if (multisample_buffer)
+		{
+			multisample_buffer->set_scissor(region.left, region.top, region.right, region.bottom);
+			multisample_buffer->clear(Color(0.f, 0.6f, 0.8f));
+		}
+		else
+		{
+			rasterizer.clear();
+		}
+
+		size_t index = 0;
+
+		for (; index < render_queue.size() && render_queue.get_layer(index) == Render_Queue::OPAQUE; index++)
+		{
+			const Draw_Item& item = render_queue[index];
+
+			if (!dirty_region.intersects(item))
+			{
+				if (frame_stats) frame_stats->meshes_unchanged++;
+				continue;
+			}
+
+			if (frame_stats) frame_stats->meshes_submitted++;
+
+			item.mesh->render(rasterizer, item.transform_matrix, item.model_view_matrix, light_grid, item.lod, multisample_buffer);
+		}
+
+		bool translucent = index < render_queue.size();
+
+		if (multisample_buffer)
+		{
+			multisample_buffer->resolve(color_buffer);
+
+			// The translucent meshes are tested against the depth of the opaque ones, which is only in the multisampled target.
+
+			if (translucent) multisample_buffer->resolve_depth(rasterizer.get_z_buffer());
+		}
+
+		// The translucent meshes come after the opaque ones in the queue, in any order.
+
+		if (translucent)
+		{
+			if (!targets->transparency_buffer)
+			{
+				targets->transparency_buffer = std::make_unique<Transparency_Buffer>(color_buffer.get_width(), color_buffer.get_height());
+			}
+
+			Transparency_Buffer& transparency_buffer = *targets->transparency_buffer;
+
+			transparency_buffer.set_scissor(region.left, region.top, region.right, region.bottom);
+			transparency_buffer.clear();
+
+			for (; index < render_queue.size(); index++)
+			{
+				const Draw_Item& item = render_queue[index];
+
+				if (!dirty_region.intersects(item))
+				{
+					if (frame_stats) frame_stats->meshes_unchanged++;
+					continue;
+				}
+
+				if (frame_stats) frame_stats->meshes_submitted++;
+
+				item.mesh->render_translucent(transparency_buffer, rasterizer.get_z_buffer(), item.transform_matrix, item.model_view_matrix, light_grid, item.lod, item.opacity, frame_stats);
+			}
+
+			transparency_buffer.composite(color_buffer);
+		}
+	}
+
+	void Scene_View::report_memory(Memory_Report& report, const std::string& name) const
+	{
+		report.begin_group(name);
+
+		report.add("view", 0, sizeof(Scene_View));
+
+		if (targets)
+		{
+			report.add("color buffer", 0, targets->color_buffer.get_allocated_bytes());
+			report.add("rasterizer", 0, sizeof(Frame_Targets) + targets->rasterizer.get_allocated_bytes());
+			report.add("multisample buffer", 0, targets->multisample_buffer ? sizeof(Multisample_Buffer) + targets->multisample_buffer->get_allocated_bytes() : 0);
+			report.add("transparency buffer", 0, targets->transparency_buffer ? sizeof(Transparency_Buffer) + targets->transparency_buffer->get_allocated_bytes() : 0);
+		}
+
+		report.add("occlusion buffer", 0, occlusion_buffer.get_allocated_bytes());
+		report.add("light grid", 0, light_grid.get_allocated_bytes());
+		report.add("render queue", 0, render_queue.get_allocated_bytes());
+		report.add("dirty region", 0, dirty_region.get_allocated_bytes() + MScenary::get_allocated_bytes(drawn_light_state) + MScenary::get_allocated_bytes(light_state));
+		report.add("frame arena (high water " + std::to_string(arena.get_high_water() >> 10) + " KiB)", 0, arena.get_capacity());
+		report.add("overdraw map", 0, overdraw_map.get_allocated_bytes());
+
+		report.end_group();
+	}
+
+	size_t Scene_View::get_allocated_bytes() const
+	{
+		size_t bytes = sizeof(Scene_View);
+
+		if (targets)
+		{
+			bytes += targets->color_buffer.get_allocated_bytes() + sizeof(Frame_Targets) + targets->rasterizer.get_allocated_bytes();
+
+			if (targets->multisample_buffer) bytes += sizeof(Multisample_Buffer) + targets->multisample_buffer->get_allocated_bytes();
+			if (targets->transparency_buffer) bytes += sizeof(Transparency_Buffer) + targets->transparency_buffer->get_allocated_bytes();
+		}
+
+		return bytes + occlusion_buffer.get_allocated_bytes() + light_grid.get_allocated_bytes() + render_queue.get_allocated_bytes()
+			+ dirty_region.get_allocated_bytes() + MScenary::get_allocated_bytes(drawn_light_state) + MScenary::get_allocated_bytes(light_state)
+			+ arena.get_capacity() + overdraw_map.get_allocated_bytes();
+	}
+}
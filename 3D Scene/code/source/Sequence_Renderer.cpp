@@ -0,0 +1,363 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Sequence_Renderer.hpp"
+#include "../header/Scene.hpp"
+#include "../header/Camera.hpp"
+#include "../header/Fxaa.hpp"
+#include "../header/Transform.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace MScenary
+{
+	Sequence_Renderer::Sequence_Renderer(Scene& scene, unsigned width, unsigned height, unsigned frame_rate)
+		:
+		scene(scene),
+		width(width),
+		height(height),
+		frame_rate(std::max(frame_rate, 1u)),
+		batch_size(std::max(std::thread::hardware_concurrency(), 1u)),
+		view_limit(batch_size + 2),
+		multisampling(false),
+		fxaa(false),
+		finished(false),
+		failed(false)
+	{
+		std::string id = "camera";
+
+		Camera& camera = dynamic_cast<Camera&>(*scene.get_node_by_id(id));
+
+		perspective_matrix = camera.get_perspective_matrix();
+	}
+
+	void Sequence_Renderer::add_keyframe(float time, const Vector3f& position, const Vector3f& rotation)
+	{
+		Camera_Keyframe keyframe = { time, position, rotation };
+
+		auto after = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float time, const Camera_Keyframe& keyframe) { return time < keyframe.time; });
+
+		keyframes.insert(after, keyframe);
+	}
+
+	void Sequence_Renderer::set_batch_size(unsigned frames)
+	{
+		batch_size = std::max(frames, 1u);
+	}
+
+	void Sequence_Renderer::set_view_limit(unsigned limit)
+	{
+		view_limit = std::max(limit, 1u);
+
+		// Nothing is being drawn or written between sequences, every view is free.
+
+		while (views.size() > view_limit)
+		{
+			free_views.erase(std::find(free_views.begin(), free_views.end(), views.back().get()));
+			views.pop_back();
+		}
+	}
+
+	unsigned Sequence_Renderer::get_frame_count() const
+	{
+		if (keyframes.empty()) return 0;
+
+		return unsigned((keyframes.back().time - keyframes.front().time) * float(frame_rate)) + 1;
+	}
+
+	bool Sequence_Renderer::render(const std::string& path, Output_Format format)
+	{
+		unsigned frame_count = get_frame_count();
+
+		if (frame_count == 0) return false;
+
+		std::ofstream stream;
+
+		if (format == Y4M_STREAM)
+		{
+			stream.open(path, std::ios::binary);
+
+			// 4:2:0 with the chroma centered between the lumas, full range since the frames use every code from 0 to 255.
+
+			stream << "YUV4MPEG2 W" << width << " H" << height << " F" << frame_rate << ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+
+			if (!stream) return false;
+		}
+
+		Post_Process* fxaa_pass = nullptr;
+
+		if (fxaa)
+		{
+			std::unique_ptr<Post_Process> pass = std::make_unique<Fxaa>();
+
+			fxaa_pass = pass.get();
+			scene.add_post_process(std::move(pass));
+		}
+
+		finished = false;
+		failed = false;
+
+		std::thread writer;
+
+		if (format != NO_OUTPUT)
+		{
+			writer = std::thread([this, &path, format, &stream]() { write_frames(path, format, stream); });
+		}
+
+		for (unsigned first_frame = 0; first_frame < frame_count && !failed; first_frame += unsigned(batch.size()))
+		{
+			take_views(frame_count - first_frame);
+
+			for (unsigned index = 0; index < batch.size(); index++)
+			{
+				Scene_View& view = *batch[index];
+				Matrix44    view_matrix = sample_view_matrix(keyframes.front().time + float(first_frame + index) / float(frame_rate));
+
+				// Every frame is drawn whole, nothing is left from the last frame the view drew.
+
+				view.resize(width, height);
+				view.set_multisampling(multisampling);
+				view.set_incremental_rendering(false);
+				view.set_camera(view_matrix, perspective_matrix);
+			}
+
+			scene.render_views(batch);
+
+			if (format == NO_OUTPUT)
+			{
+				give_views(batch);
+				continue;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				for (unsigned index = 0; index < batch.size(); index++)
+				{
+					pending_frames.push_back(Pending_Frame{ batch[index], first_frame + index });
+				}
+			}
+
+			frame_pending.notify_one();
+		}
+
+		if (writer.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				finished = true;
+			}
+
+			frame_pending.notify_one();
+			writer.join();
+		}
+
+		if (fxaa_pass) scene.remove_post_process(fxaa_pass);
+
+		return !failed;
+	}
+
+	void Sequence_Renderer::take_views(unsigned frames)
+	{
+		unsigned count = std::min(batch_size, frames);
+
+		batch.clear();
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (batch.size() < count)
+		{
+			if (!free_views.empty())
+			{
+				batch.push_back(free_views.back());
+				free_views.pop_back();
+			}
+			else if (views.size() < view_limit)
+			{
+				// Only this thread creates views, the writer just gives back the ones it's done with.
+
+				views.push_back(std::make_unique<Scene_View>(width, height));
+				batch.push_back(views.back().get());
+			}
+			else if (batch.empty())
+			{
+				view_freed.wait(lock, [this]() { return !free_views.empty(); });
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	void Sequence_Renderer::give_views(const vector<Scene_View*>& given)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		free_views.insert(free_views.end(), given.begin(), given.end());
+	}
+
+	void Sequence_Renderer::write_frames(const std::string& path, Output_Format format, std::ofstream& stream)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (;;)
+		{
+			frame_pending.wait(lock, [this]() { return finished || !pending_frames.empty(); });
+
+			if (pending_frames.empty()) return;
+
+			Pending_Frame frame = pending_frames.front();
+
+			pending_frames.pop_front();
+			lock.unlock();
+
+			// After a failure the frames are only given back, so the renderer never waits for a view.
+
+			if (!failed)
+			{
+				const Color_Buffer& image = frame.view->get_color_buffer();
+
+				if (format == Y4M_STREAM)
+				{
+					failed = !write_y4m_frame(stream, image);
+				}
+				else
+				{
+					char number[16];
+
+					std::snprintf(number, sizeof(number), "%05u.ppm", frame.number);
+
+					failed = !write_ppm(path + number, image);
+				}
+			}
+
+			lock.lock();
+
+			free_views.push_back(frame.view);
+			view_freed.notify_one();
+		}
+	}
+
+	Matrix44 Sequence_Renderer::sample_view_matrix(float time) const
+	{
+		auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float time, const Camera_Keyframe& keyframe) { return time < keyframe.time; });
+
+		Vector3f position, rotation;
+
+		if (next == keyframes.begin() || next == keyframes.end())
+		{
+			const Camera_Keyframe& keyframe = next == keyframes.end() ? keyframes.back() : keyframes.front();
+
+			position = keyframe.position;
+			rotation = keyframe.rotation;
+		}
+		else
+		{
+			const Camera_Keyframe& from = *(next - 1);
+			const Camera_Keyframe& to = *next;
+
+			float t = (time - from.time) / (to.time - from.time);
+
+			position = from.position + (to.position - from.position) * t;
+			rotation = from.rotation + (to.rotation - from.rotation) * t;
+		}
+
+		// Same view matrix as the one of the camera node with this pose.
+
+		Transform transform;
+
+		transform.set_position(position.x, position.y, position.z);
+		transform.set_rotation(rotation.x, rotation.y, rotation.z);
+
+		return inverse(transform.get_transform_matrix());
+	}
+
+	bool Sequence_Renderer::write_ppm(const std::string& path, const Color_Buffer& frame)
+	{
+		static_assert(sizeof(Scene_View::Color) == 3, "The pixels are written as they are, three bytes each in RGB order");
+
+		std::ofstream file(path, std::ios::binary);
+
+		file << "P6\n" << frame.get_width() << ' ' << frame.get_height() << "\n255\n";
+
+		file.write(reinterpret_cast<const char*>(frame.pixels()), std::streamsize(frame.get_size()) * 3);
+
+		return bool(file);
+	}
+
+	bool Sequence_Renderer::write_y4m_frame(std::ofstream& stream, const Color_Buffer& frame)
+	{
+		unsigned frame_width = frame.get_width();
+		unsigned frame_height = frame.get_height();
+		unsigned chroma_width = (frame_width + 1) / 2;
+		unsigned chroma_height = (frame_height + 1) / 2;
+
+		planes.resize(size_t(frame_width) * frame_height + 2 * size_t(chroma_width) * chroma_height);
+
+		uint8_t* luma = planes.data();
+		uint8_t* blue = luma + size_t(frame_width) * frame_height;
+		uint8_t* red = blue + size_t(chroma_width) * chroma_height;
+
+		const Scene_View::Color* pixels = frame.pixels();
+
+		// Full range BT.601 in 16 bit fixed point, the same weights JPEG uses.
+
+		for (size_t index = 0, size = frame.get_size(); index < size; index++)
+		{
+			int r = pixels[index].red(), g = pixels[index].green(), b = pixels[index].blue();
+
+			luma[index] = uint8_t((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+		}
+
+		// Each chroma sample is taken from the average of a block of 2x2 pixels, repeating the last row or column of odd sizes.
+
+		for (unsigned y = 0; y < chroma_height; y++)
+		{
+			unsigned row_0 = 2 * y;
+			unsigned row_1 = std::min(row_0 + 1, frame_height - 1);
+
+			for (unsigned x = 0; x < chroma_width; x++)
+			{
+				unsigned column_0 = 2 * x;
+				unsigned column_1 = std::min(column_0 + 1, frame_width - 1);
+
+				const Scene_View::Color* block[] =
+				{
+					&pixels[row_0 * frame_width + column_0], &pixels[row_0 * frame_width + column_1],
+					&pixels[row_1 * frame_width + column_0], &pixels[row_1 * frame_width + column_1],
+				};
+
+				int r = 0, g = 0, b = 0;
+
+				for (const Scene_View::Color* pixel : block)
+				{
+					r += pixel->red();
+					g += pixel->green();
+					b += pixel->blue();
+				}
+
+				// The sums are 4 times the average, so the weights are shifted 2 bits more. Adding 128 << 18 before the shift keeps
+				// the value positive, so it rounds the same way on both sides of the neutral chroma.
+
+				int cb = (-11056 * r - 21712 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18;
+				int cr = ( 32768 * r - 27440 * g -  5328 * b + (128 << 18) + (1 << 17)) >> 18;
+
+				blue[y * chroma_width + x] = uint8_t(std::min(std::max(cb, 0), 255));
+				red [y * chroma_width + x] = uint8_t(std::min(std::max(cr, 0), 255));
+			}
+		}
+
+		stream << "FRAME\n";
+
+		stream.write(reinterpret_cast<const char*>(planes.data()), std::streamsize(planes.size()));
+
+		return bool(stream);
+	}
+}
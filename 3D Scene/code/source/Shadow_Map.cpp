@@ -0,0 +1,221 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Shadow_Map.hpp"
+#include "../header/Light.hpp"
+#include "../header/Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace MScenary
+{
+	Shadow_Map::Shadow_Map(unsigned resolution)
+		:
+		target(resolution, resolution),
+		rasterizer(target),
+		light_matrix(1),
+		cached_key(0),
+		has_casters(false),
+		pcf(false),
+		depth_bias(0.002f)
+	{
+	}
+
+	bool Shadow_Map::update(const Light& light, const vector<Shadow_Caster>& casters)
+	{
+		uint64_t key = calculate_key(light, casters);
+
+		bool rendered = key != cached_key;
+
+		if (rendered)
+		{
+			cached_key = key;
+			has_casters = !casters.empty();
+
+			rasterizer.clear();
+
+			if (has_casters)
+			{
+				// Sphere around the bounding spheres of every caster in scene coordinates, the projection is fitted to it.
+
+				Point3f bounds_min(std::numeric_limits<float>::max());
+				Point3f bounds_max(-std::numeric_limits<float>::max());
+
+				for (const Shadow_Caster& caster : casters)
+				{
+					Point3f center(caster.model_matrix * Point4f(caster.mesh->get_bounding_center(), 1.f));
+					float radius = caster.mesh->get_bounding_radius() * extract_max_scale(caster.model_matrix);
+
+					bounds_min = glm::min(bounds_min, center - Vector3f(radius));
+					bounds_max = glm::max(bounds_max, center + Vector3f(radius));
+				}
+
+				Point3f center = (bounds_min + bounds_max) * 0.5f;
+				float radius = 0.f;
+
+				for (const Shadow_Caster& caster : casters)
+				{
+					Point3f caster_center(caster.model_matrix * Point4f(caster.mesh->get_bounding_center(), 1.f));
+					float caster_radius = caster.mesh->get_bounding_radius() * extract_max_scale(caster.model_matrix);
+
+					radius = std::max(radius, glm::length(caster_center - center) + caster_radius);
+				}
+
+				radius = std::max(radius, 0.001f);
+
+				bool directional = light.get_type() == Light::DIRECTIONAL;
+
+				Vector3f forward;
+				Point3f eye;
+				Matrix44 projection_matrix;
+
+				if (directional)
+				{
+					forward = light.get_direction();
+					eye = center - forward * (radius * 2.f);
+					projection_matrix = glm::ortho(-radius, radius, -radius, radius, radius, radius * 3.f);
+				}
+				else
+				{
+					eye = light.get_world_position();
+
+					Vector3f to_center = center - eye;
+					float distance = glm::length(to_center);
+
+					forward = distance > 0.f ? to_center / distance : Vector3f(0.f, 1.f, 0.f);
+
+					// A light outside the sphere sees it through the narrowest cone that holds it. A light among the casters can't see
+					// all of them at once, so it gets the widest angle allowed and whatever falls out of it is taken as lit.
+
+					if (distance > radius * 1.01f)
+					{
+						projection_matrix = perspective(2.f * std::asin(radius / distance), distance - radius, distance + radius, 1.f);
+					}
+					else
+					{
+						projection_matrix = perspective(max_field_of_view, radius * 0.01f, distance + radius, 1.f);
+					}
+				}
+
+				Vector3f up = std::abs(forward.y) > 0.99f ? Vector3f(0.f, 0.f, 1.f) : Vector3f(0.f, 1.f, 0.f);
+
+				Matrix44 light_view_matrix = glm::lookAt(eye, eye + forward, up);
+
+				light_matrix = projection_matrix * light_view_matrix;
+
+				for (const Shadow_Caster& caster : casters)
+				{
+					caster.mesh->render_depth(rasterizer, light_matrix * caster.model_matrix, light_view_matrix * caster.model_matrix, directional);
+				}
+			}
+		}
+
+		return rendered;
+	}
+
+	Matrix44 Shadow_Map::get_lookup_matrix(const Matrix44& view_matrix) const
+	{
+		return Mesh::get_display_transformation(target.get_width(), target.get_height()) * light_matrix * inverse(view_matrix);
+	}
+
+	void Shadow_Map::calculate_visibility(const Matrix44& lookup_matrix, const float* x, const float* y, const float* z, float* visibility, size_t count) const
+	{
+		if (!has_casters)
+		{
+			std::fill(visibility, visibility + count, 1.f);
+			return;
+		}
+
+		int width = int(target.get_width());
+		int height = int(target.get_height());
+		int radius = pcf ? 1 : 0;
+
+		// Same scale as the depth written by the rasterizer.
+
+		float bias = depth_bias * 100000000.f;
+
+		const int* depth = rasterizer.get_z_buffer().data();
+
+		for (size_t index = 0; index < count; index++)
+		{
+			Point4f point = lookup_matrix * Point4f(x[index], y[index], z[index], 1.f);
+
+			// Behind the light, so it can't be in the map.
+
+			if (point.w <= 0.f)
+			{
+				visibility[index] = 1.f;
+				continue;
+			}
+
+			float inverse_w = 1.f / point.w;
+
+			int texel_x = int(std::floor(point.x * inverse_w));
+			int texel_y = int(std::floor(point.y * inverse_w));
+			float point_depth = point.z * inverse_w - bias;
+
+			int lit = 0, samples = 0;
+
+			for (int offset_y = -radius; offset_y <= radius; offset_y++)
+			{
+				for (int offset_x = -radius; offset_x <= radius; offset_x++)
+				{
+					int sample_x = texel_x + offset_x;
+					int sample_y = texel_y + offset_y;
+
+					samples++;
+
+					// Out of the map nothing casts shadows.
+
+					if (sample_x < 0 || sample_y < 0 || sample_x >= width || sample_y >= height || point_depth <= float(depth[sample_y * width + sample_x]))
+					{
+						lit++;
+					}
+				}
+			}
+
+			visibility[index] = float(lit) / float(samples);
+		}
+	}
+
+	uint64_t Shadow_Map::calculate_key(const Light& light, const vector<Shadow_Caster>& casters)
+	{
+		// FNV-1a over the parameters of the light and the meshes and matrices of the casters.
+
+		uint64_t hash = 14695981039346656037ull;
+
+		auto add = [&hash](const void* data, size_t size)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+			for (size_t index = 0; index < size; index++)
+			{
+				hash = (hash ^ bytes[index]) * 1099511628211ull;
+			}
+		};
+
+		Light::Type type = light.get_type();
+		float range = light.get_range();
+
+		add(&type, sizeof(type));
+		add(&range, sizeof(range));
+		add(&light.get_world_position(), sizeof(Vector3f));
+		add(&light.get_direction(), sizeof(Vector3f));
+
+		for (const Shadow_Caster& caster : casters)
+		{
+			add(&caster.mesh, sizeof(caster.mesh));
+			add(&caster.model_matrix, sizeof(caster.model_matrix));
+		}
+
+		// 0 is kept for a map that has never been rendered.
+
+		return hash != 0 ? hash : 1;
+	}
+}
@@ -0,0 +1,137 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Thread_Pool.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+
+namespace MScenary
+{
+	Thread_Pool::Thread_Pool(unsigned thread_count)
+		:
+		job_function(nullptr),
+		job_context(nullptr),
+		job_items(0),
+		next_item(0),
+		job_number(0),
+		busy_threads(0),
+		job_vectorized(false),
+		running(false),
+		closing(false)
+	{
+		if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+		for (unsigned index = 1; index < thread_count; index++)
+		{
+			threads.emplace_back([this]() { wait_for_jobs(); });
+		}
+	}
+
+	Thread_Pool::~Thread_Pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			closing = true;
+		}
+
+		job_ready.notify_all();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	void Thread_Pool::run(unsigned item_count, Job_Function function, void* context)
+	{
+		// A single item isn't worth waking anybody, and a job inside another one can't wait for threads that may be busy with
+		// the outer one.
+
+		if (item_count <= 1 || threads.empty() || running.exchange(true))
+		{
+			for (unsigned item = 0; item < item_count; item++)
+			{
+				function(context, item);
+			}
+
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			job_function = function;
+			job_context = context;
+			job_items = item_count;
+			job_vectorized = simd::enabled();
+			next_item = 0;
+			job_number++;
+		}
+
+		job_ready.notify_all();
+
+		work(function, context, item_count);
+
+		// The job is only taken down once no thread of the pool is in it, the ones that wake up later find no job at all.
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			job_done.wait(lock, [this]() { return busy_threads == 0; });
+
+			job_function = nullptr;
+			job_context = nullptr;
+		}
+
+		running = false;
+	}
+
+	void Thread_Pool::work(Job_Function function, void* context, unsigned item_count)
+	{
+		for (unsigned item; (item = next_item++) < item_count; )
+		{
+			function(context, item);
+		}
+	}
+
+	void Thread_Pool::wait_for_jobs()
+	{
+		uint64_t last_job = 0;
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		for (;;)
+		{
+			job_ready.wait(lock, [&]() { return closing || job_number != last_job; });
+
+			if (closing) return;
+
+			last_job = job_number;
+
+			if (!job_function) continue;
+
+			Job_Function function = job_function;
+			void*        context = job_context;
+			unsigned     item_count = job_items;
+			bool         vectorized = job_vectorized;
+
+			busy_threads++;
+			lock.unlock();
+
+			{
+				simd::Override kernels(vectorized);
+
+				work(function, context, item_count);
+			}
+
+			lock.lock();
+
+			if (--busy_threads == 0) job_done.notify_one();
+		}
+	}
+}
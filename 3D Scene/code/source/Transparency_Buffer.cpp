@@ -0,0 +1,250 @@
+/**
+  * @author    Martin Pérez Villabrille
+  * @copyright Copyright (c) 2023+ Martin Pérez Villabrille.
+  *            All rights reserved
+  */
+
+#include "../header/Transparency_Buffer.hpp"
+#include "../header/simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace MScenary
+{
+	namespace
+	{
+		const float depth_scale = 1e-8f;	// From the depth of the display coordinates back to projection coordinates.
+
+		/**
+		 * @brief Weight of a translucent pixel, so the nearest surfaces dominate the average color where several overlap.
+		 *
+		 * @param alpha The opacity of the pixel.
+		 * @param z The depth of the pixel in display coordinates.
+		 * @return The weight.
+		 */
+		inline float calculate_weight(float alpha, float z)
+		{
+			float depth = std::min(std::max((z * depth_scale + 1.f) * 0.5f, 0.f), 1.f);
+			float nearness = 1.f - depth;
+
+			return alpha * std::max(3e3f * nearness * nearness * nearness, 1e-2f);
+		}
+	}
+
+	Transparency_Buffer::Transparency_Buffer(unsigned width, unsigned height)
+		:
+		width(width),
+		height(height),
+		accumulated_red(size_t(width) * height, 0.f),
+		accumulated_green(size_t(width) * height, 0.f),
+		accumulated_blue(size_t(width) * height, 0.f),
+		accumulated_alpha(size_t(width) * height, 0.f),
+		revealage(size_t(width) * height, 1.f),
+		dirty_begin(height),
+		dirty_end(0)
+	{
+		reset_scissor();
+	}
+
+	void Transparency_Buffer::set_scissor(int left, int top, int right, int bottom)
+	{
+		scissor_left = std::max(left, 0);
+		scissor_top = std::max(top, 0);
+		scissor_right = std::min(right, int(width));
+		scissor_bottom = std::min(bottom, int(height));
+	}
+
+	void Transparency_Buffer::clear()
+	{
+		if (dirty_begin >= dirty_end) return;
+
+		size_t begin = size_t(dirty_begin) * width;
+		size_t end = size_t(dirty_end) * width;
+
+		std::fill(accumulated_red.begin() + begin, accumulated_red.begin() + end, 0.f);
+		std::fill(accumulated_green.begin() + begin, accumulated_green.begin() + end, 0.f);
+		std::fill(accumulated_blue.begin() + begin, accumulated_blue.begin() + end, 0.f);
+		std::fill(accumulated_alpha.begin() + begin, accumulated_alpha.begin() + end, 0.f);
+		std::fill(revealage.begin() + begin, revealage.begin() + end, 1.f);
+
+		dirty_begin = height;
+		dirty_end = 0;
+	}
+
+	void Transparency_Buffer::fill_triangle(const Point4i* vertices, const int* indices, const Rgb888& color, float alpha, const vector<int>& z_buffer)
+	{
+		const Point4i* corners[3] = { vertices + indices[0], vertices + indices[1], vertices + indices[2] };
+
+		int64_t area = int64_t(corners[1]->x - corners[0]->x) * (corners[2]->y - corners[0]->y) - int64_t(corners[1]->y - corners[0]->y) * (corners[2]->x - corners[0]->x);
+
+		if (area == 0 || alpha <= 0.f) return;
+
+		// The edges are built for a positive area, so the other winding is reversed first.
+
+		if (area < 0)
+		{
+			std::swap(corners[1], corners[2]);
+			area = -area;
+		}
+
+		const Point4i& a = *corners[0];
+		const Point4i& b = *corners[1];
+		const Point4i& c = *corners[2];
+
+		// Every edge as A * x + B * y + C, positive inside. The pixels exactly on an edge only belong to the triangle if the edge
+		// is a left or top one, so the pixels on the edges shared by two triangles aren't accumulated twice.
+
+		int64_t edge_a[3], edge_b[3], edge_c[3];
+
+		for (unsigned index = 0; index < 3; index++)
+		{
+			const Point4i& start = *corners[index];
+			const Point4i& end = *corners[(index + 1) % 3];
+
+			edge_a[index] = int64_t(start.y) - end.y;
+			edge_b[index] = int64_t(end.x) - start.x;
+			edge_c[index] = -(edge_a[index] * start.x + edge_b[index] * start.y);
+
+			if (!(edge_a[index] > 0 || (edge_a[index] == 0 && edge_b[index] < 0))) edge_c[index] -= 1;
+		}
+
+		// Depth as a plane over the screen.
+
+		float z_dx = float((double(b.z - a.z) * (c.y - a.y) - double(c.z - a.z) * (b.y - a.y)) / double(area));
+		float z_dy = float((double(c.z - a.z) * (b.x - a.x) - double(b.z - a.z) * (c.x - a.x)) / double(area));
+
+		int x_min = std::max(std::min(std::min(a.x, b.x), c.x), scissor_left);
+		int x_max = std::min(std::max(std::max(a.x, b.x), c.x), scissor_right - 1);
+		int y_min = std::max(std::min(std::min(a.y, b.y), c.y), scissor_top);
+		int y_max = std::min(std::max(std::max(a.y, b.y), c.y), scissor_bottom - 1);
+
+		if (x_min > x_max || y_min > y_max) return;
+
+		float red = color.red() * alpha;
+		float green = color.green() * alpha;
+		float blue = color.blue() * alpha;
+		float transparency = 1.f - std::min(alpha, 1.f);
+
+		dirty_begin = std::min(dirty_begin, unsigned(y_min));
+		dirty_end = std::max(dirty_end, unsigned(y_max) + 1);
+
+		for (int y = y_min; y <= y_max; y++)
+		{
+			int64_t e0 = edge_a[0] * x_min + edge_b[0] * y + edge_c[0];
+			int64_t e1 = edge_a[1] * x_min + edge_b[1] * y + edge_c[1];
+			int64_t e2 = edge_a[2] * x_min + edge_b[2] * y + edge_c[2];
+
+			float z = float(a.z) + z_dx * float(x_min - a.x) + z_dy * float(y - a.y);
+
+			size_t offset = size_t(y) * width + x_min;
+			bool   inside = false;
+
+			for (int x = x_min; x <= x_max; x++, offset++, e0 += edge_a[0], e1 += edge_a[1], e2 += edge_a[2], z += z_dx)
+			{
+				if ((e0 | e1 | e2) < 0)
+				{
+					// A triangle is convex, so once its span on the row is left there's nothing else.
+
+					if (inside) break;
+
+					continue;
+				}
+
+				inside = true;
+
+				if (z >= float(z_buffer[offset])) continue;
+
+				float weight = calculate_weight(alpha, z);
+
+				accumulated_red[offset] += red * weight;
+				accumulated_green[offset] += green * weight;
+				accumulated_blue[offset] += blue * weight;
+				accumulated_alpha[offset] += alpha * weight;
+				revealage[offset] *= transparency;
+			}
+		}
+	}
+
+	void Transparency_Buffer::composite(argb::Color_Buffer<Rgb888>& color_buffer) const
+	{
+		Rgb888* pixels = color_buffer.pixels();
+
+		size_t index = size_t(dirty_begin) * width;
+		size_t end = dirty_begin < dirty_end ? size_t(dirty_end) * width : index;
+
+	#if MSCENARY_SSE2
+
+		// Four pixels at a time, skipping the groups nothing translucent was drawn on.
+
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 minimum_weight = _mm_set1_ps(1e-5f);
+		const bool   vectorized = simd::enabled();
+
+		for (; vectorized && index + 4 <= end; index += 4)
+		{
+			__m128 revealed = _mm_loadu_ps(revealage.data() + index);
+
+			if (_mm_movemask_ps(_mm_cmplt_ps(revealed, one)) == 0) continue;
+
+			__m128 inverse_weight = _mm_div_ps(one, _mm_max_ps(_mm_loadu_ps(accumulated_alpha.data() + index), minimum_weight));
+			__m128 coverage = _mm_sub_ps(one, revealed);
+
+			Rgb888* group = pixels + index;
+
+			__m128 red = _mm_add_ps
+			(
+				_mm_mul_ps(_mm_setr_ps(group[0].red(), group[1].red(), group[2].red(), group[3].red()), revealed),
+				_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(accumulated_red.data() + index), inverse_weight), coverage)
+			);
+			__m128 green = _mm_add_ps
+			(
+				_mm_mul_ps(_mm_setr_ps(group[0].green(), group[1].green(), group[2].green(), group[3].green()), revealed),
+				_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(accumulated_green.data() + index), inverse_weight), coverage)
+			);
+			__m128 blue = _mm_add_ps
+			(
+				_mm_mul_ps(_mm_setr_ps(group[0].blue(), group[1].blue(), group[2].blue(), group[3].blue()), revealed),
+				_mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(accumulated_blue.data() + index), inverse_weight), coverage)
+			);
+
+			// The three channels are rounded and packed to bytes together, red in the first four, green in the next and blue after them.
+			// Adding a half and truncating rounds them like the plain loop below, not to the nearest even as the conversion would.
+
+			__m128i blue_levels = _mm_cvttps_epi32(_mm_add_ps(blue, half));
+			__m128i red_green = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(red, half)), _mm_cvttps_epi32(_mm_add_ps(green, half)));
+			__m128i blue_blue = _mm_packs_epi32(blue_levels, blue_levels);
+
+			alignas(16) uint8_t bytes[16];
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(bytes), _mm_packus_epi16(red_green, blue_blue));
+
+			for (unsigned lane = 0; lane < 4; lane++)
+			{
+				group[lane].red() = bytes[lane];
+				group[lane].green() = bytes[lane + 4];
+				group[lane].blue() = bytes[lane + 8];
+			}
+		}
+
+	#endif
+
+		for (; index < end; index++)
+		{
+			float revealed = revealage[index];
+
+			if (revealed >= 1.f) continue;
+
+			float inverse_weight = 1.f / std::max(accumulated_alpha[index], 1e-5f);
+			float coverage = 1.f - revealed;
+
+			Rgb888& pixel = pixels[index];
+
+			pixel.red() = uint8_t(std::min(pixel.red() * revealed + accumulated_red[index] * inverse_weight * coverage + 0.5f, 255.f));
+			pixel.green() = uint8_t(std::min(pixel.green() * revealed + accumulated_green[index] * inverse_weight * coverage + 0.5f, 255.f));
+			pixel.blue() = uint8_t(std::min(pixel.blue() * revealed + accumulated_blue[index] * inverse_weight * coverage + 0.5f, 255.f));
+		}
+	}
+}
@@ -11,20 +11,90 @@
   |*      Q/E - Zoom Out/In           |
   |*      Arrows - Rotation           |
   |*      R - Reset Camera            |
+  |*      M - Dump Memory             |
+  |*      N - Anti-aliasing On/Off    |
+  |*      I - Incremental On/Off      |
   |*								  |
   /----------------------------------*/
 
+  /* Given a path, a turn around the scene is rendered offline instead, into a Y4M stream if the path ends in ".y4m" or into
+     numbered PPM images starting with the path otherwise.
+
+     Given --cross-check, the turn is drawn without a window through the optimized paths and through the reference ones, and
+     every frame that doesn't match is reported. The frames that don't are also written as difference images starting with
+     the path after it, if any. It returns 1 if any frame didn't match.
+
+     Given --fxaa before anything else, the frames of the window or of the turn are anti-aliased with FXAA. */
+
 #include "../header/Scene.hpp"
+#include "../header/Sequence_Renderer.hpp"
+#include "../header/Cross_Check.hpp"
+#include "../header/Fxaa.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
 
 using namespace MScenary;
 
-int main()
+int main(int argc, char* argv[])
 {
 	constexpr auto window_width = 800u;
 	constexpr auto window_height = 800u;
 
+	bool fxaa = argc > 1 && std::string(argv[1]) == "--fxaa";
+
+	if (fxaa)
+	{
+		argv++;
+		argc--;
+	}
+
+	if (argc > 1)
+	{
+		std::string path = argv[1];
+		bool        stream = path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+		bool        cross_check = path == "--cross-check";
+
+		Scene scene(window_width, window_height, true);
+
+		Sequence_Renderer sequence(scene, window_width, window_height, 30);
+
+		sequence.set_fxaa(fxaa);
+
+		// Ten seconds turning the camera once around from its starting pose.
+
+		for (int step = 0; step <= 8; step++)
+		{
+			sequence.add_keyframe(float(step) * 1.25f, Vector3f(0.f, -3.f, 0.f), Vector3f(0.5f, float(step) * 0.785398f, 0.f));
+		}
+
+		if (cross_check)
+		{
+			// The plain loops round like the vectorized ones, so the colors and the depth have to be exact.
+
+			auto check = std::make_shared<Cross_Check>(0, 0);
+
+			check->set_log(&std::cout);
+
+			if (argc > 2) check->set_difference_path(argv[2]);
+
+			scene.set_cross_check(check);
+
+			sequence.render(std::string(), Sequence_Renderer::NO_OUTPUT);
+
+			std::cout << check->get_images_failed() << " of " << check->get_images_checked() << " frames didn't match\n";
+
+			return check->get_images_failed() == 0 ? 0 : 1;
+		}
+
+		return sequence.render(path, stream ? Sequence_Renderer::Y4M_STREAM : Sequence_Renderer::PPM_IMAGES) ? 0 : 1;
+	}
+
 	Scene scene(window_width, window_height);
 
+	if (fxaa) scene.add_post_process(std::make_unique<Fxaa>());
+
 	scene.run();
 
 	return 1;